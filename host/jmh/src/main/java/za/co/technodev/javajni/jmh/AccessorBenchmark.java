@@ -0,0 +1,186 @@
+package za.co.technodev.javajni.jmh;
+
+import java.util.concurrent.TimeUnit;
+
+import org.openjdk.jmh.annotations.Benchmark;
+import org.openjdk.jmh.annotations.BenchmarkMode;
+import org.openjdk.jmh.annotations.Fork;
+import org.openjdk.jmh.annotations.Level;
+import org.openjdk.jmh.annotations.Measurement;
+import org.openjdk.jmh.annotations.Mode;
+import org.openjdk.jmh.annotations.OutputTimeUnit;
+import org.openjdk.jmh.annotations.Param;
+import org.openjdk.jmh.annotations.Scope;
+import org.openjdk.jmh.annotations.Setup;
+import org.openjdk.jmh.annotations.State;
+import org.openjdk.jmh.annotations.TearDown;
+import org.openjdk.jmh.annotations.Warmup;
+import org.openjdk.jmh.infra.BenchmarkParams;
+
+import za.co.technodev.exception.InvalidTypeException;
+import za.co.technodev.exception.NotExistingKeyException;
+import za.co.technodev.javajni.Color;
+import za.co.technodev.javajni.Store;
+
+/*
+ * Get and set of each StoreType, by key or by handle, cycling over KEY_COUNT keys of that type.
+ * Setters alternate between two values from one round over the keys to the next, so that each
+ * write changes the value. Arrays hold ARRAY_LENGTH elements, see ArraySizeBenchmark for other
+ * lengths.
+ */
+
+@BenchmarkMode(Mode.AverageTime)
+@OutputTimeUnit(TimeUnit.NANOSECONDS)
+@Warmup(iterations = 3, time = 1)
+@Measurement(iterations = 5, time = 1)
+@Fork(1)
+@State(Scope.Benchmark)
+public class AccessorBenchmark {
+	private static final int KEY_COUNT = 1024;
+	private static final int ARRAY_LENGTH = 16;
+
+	@Param({ "key", "handle" })
+	public String mAccess;
+
+	private Store mStore;
+	private String[] mKeys;
+	private long[] mHandles;
+	private boolean mByHandle;
+	private int mIndex;
+	//Incremented each time mIndex wraps around
+	private int mRound;
+	private String[] mStrings;
+	private Color[] mColors;
+	private int[][] mIntegerArrays;
+	private Color[][] mColorArrays;
+
+	/*
+	 * The keys hold the type of the benchmark, named after its method, before it is measured.
+	 */
+	@Setup(Level.Trial)
+	public void setUp(BenchmarkParams pParams) {
+		mStore = BenchmarkStores.createStore();
+		mKeys = BenchmarkStores.makeKeys("bench.accessor.", KEY_COUNT);
+		mHandles = BenchmarkStores.resolveKeys(mStore, mKeys);
+		mByHandle = mAccess.equals("handle");
+		mStrings = new String[] { "bench.accessor.value.0", "bench.accessor.value.1" };
+		mColors = new Color[] { new Color(0xFF336699), new Color(0xFF996633) };
+		mIntegerArrays = new int[][] { new int[ARRAY_LENGTH], new int[ARRAY_LENGTH] };
+		mIntegerArrays[1][0] = 1;
+		mColorArrays = new Color[][] { BenchmarkStores.makeColors(ARRAY_LENGTH), BenchmarkStores.makeColors(ARRAY_LENGTH) };
+		mColorArrays[1][0] = mColors[1];
+		String lMethod = pParams.getBenchmark();
+		fill(lMethod.substring(lMethod.lastIndexOf('.') + 4));
+		//The first call starts the first round, which writes other values than fill()
+		mIndex = KEY_COUNT - 1;
+	}
+
+	@TearDown(Level.Trial)
+	public void tearDown() {
+		mStore.finalizeStore();
+	}
+
+	private int nextIndex() {
+		mIndex = (mIndex + 1) & (KEY_COUNT - 1);
+		if (mIndex == 0) {
+			++mRound;
+		}
+		return mIndex;
+	}
+
+	private void fill(String pType) {
+		for (int i = 0; i < KEY_COUNT; ++i) {
+			if (pType.equals("Integer")) {
+				mStore.setInteger(mKeys[i], i);
+			} else if (pType.equals("String")) {
+				mStore.setString(mKeys[i], mStrings[0]);
+			} else if (pType.equals("Color")) {
+				mStore.setColor(mKeys[i], mColors[0]);
+			} else if (pType.equals("IntegerArray")) {
+				mStore.setIntegerArray(mKeys[i], mIntegerArrays[0]);
+			} else {
+				mStore.setColorArray(mKeys[i], mColorArrays[0]);
+			}
+		}
+	}
+
+	@Benchmark
+	public int getInteger() throws NotExistingKeyException, InvalidTypeException {
+		int i = nextIndex();
+		return mByHandle ? mStore.getInteger(mHandles[i]) : mStore.getInteger(mKeys[i]);
+	}
+
+	@Benchmark
+	public void setInteger() throws NotExistingKeyException {
+		int i = nextIndex();
+		if (mByHandle) {
+			mStore.setInteger(mHandles[i], mRound);
+		} else {
+			mStore.setInteger(mKeys[i], mRound);
+		}
+	}
+
+	@Benchmark
+	public String getString() throws NotExistingKeyException, InvalidTypeException {
+		int i = nextIndex();
+		return mByHandle ? mStore.getString(mHandles[i]) : mStore.getString(mKeys[i]);
+	}
+
+	@Benchmark
+	public void setString() throws NotExistingKeyException {
+		int i = nextIndex();
+		if (mByHandle) {
+			mStore.setString(mHandles[i], mStrings[mRound & 1]);
+		} else {
+			mStore.setString(mKeys[i], mStrings[mRound & 1]);
+		}
+	}
+
+	@Benchmark
+	public Color getColor() throws NotExistingKeyException, InvalidTypeException {
+		int i = nextIndex();
+		return mByHandle ? mStore.getColor(mHandles[i]) : mStore.getColor(mKeys[i]);
+	}
+
+	@Benchmark
+	public void setColor() throws NotExistingKeyException {
+		int i = nextIndex();
+		if (mByHandle) {
+			mStore.setColor(mHandles[i], mColors[mRound & 1]);
+		} else {
+			mStore.setColor(mKeys[i], mColors[mRound & 1]);
+		}
+	}
+
+	@Benchmark
+	public int[] getIntegerArray() throws NotExistingKeyException {
+		int i = nextIndex();
+		return mByHandle ? mStore.getIntegerArray(mHandles[i]) : mStore.getIntegerArray(mKeys[i]);
+	}
+
+	@Benchmark
+	public void setIntegerArray() throws NotExistingKeyException {
+		int i = nextIndex();
+		if (mByHandle) {
+			mStore.setIntegerArray(mHandles[i], mIntegerArrays[mRound & 1]);
+		} else {
+			mStore.setIntegerArray(mKeys[i], mIntegerArrays[mRound & 1]);
+		}
+	}
+
+	@Benchmark
+	public Color[] getColorArray() throws NotExistingKeyException {
+		int i = nextIndex();
+		return mByHandle ? mStore.getColorArray(mHandles[i]) : mStore.getColorArray(mKeys[i]);
+	}
+
+	@Benchmark
+	public void setColorArray() throws NotExistingKeyException {
+		int i = nextIndex();
+		if (mByHandle) {
+			mStore.setColorArray(mHandles[i], mColorArrays[mRound & 1]);
+		} else {
+			mStore.setColorArray(mKeys[i], mColorArrays[mRound & 1]);
+		}
+	}
+}
@@ -0,0 +1,88 @@
+package za.co.technodev.javajni.jmh;
+
+import java.util.concurrent.TimeUnit;
+
+import org.openjdk.jmh.annotations.Benchmark;
+import org.openjdk.jmh.annotations.BenchmarkMode;
+import org.openjdk.jmh.annotations.Fork;
+import org.openjdk.jmh.annotations.Level;
+import org.openjdk.jmh.annotations.Measurement;
+import org.openjdk.jmh.annotations.Mode;
+import org.openjdk.jmh.annotations.OutputTimeUnit;
+import org.openjdk.jmh.annotations.Param;
+import org.openjdk.jmh.annotations.Scope;
+import org.openjdk.jmh.annotations.Setup;
+import org.openjdk.jmh.annotations.State;
+import org.openjdk.jmh.annotations.TearDown;
+import org.openjdk.jmh.annotations.Warmup;
+
+import za.co.technodev.exception.InvalidTypeException;
+import za.co.technodev.exception.NotExistingKeyException;
+import za.co.technodev.javajni.Color;
+import za.co.technodev.javajni.Store;
+
+/*
+ * Array accessors on a single entry of mLength elements, from 1 to 1M. Copies in and out of Java
+ * should grow linearly with mLength past the fixed cost of the call, the native sum without
+ * copying out.
+ */
+
+@BenchmarkMode(Mode.AverageTime)
+@OutputTimeUnit(TimeUnit.MICROSECONDS)
+@Warmup(iterations = 3, time = 1)
+@Measurement(iterations = 5, time = 1)
+@Fork(1)
+@State(Scope.Benchmark)
+public class ArraySizeBenchmark {
+	private static final String INTEGER_ARRAY_KEY = "bench.array.integers";
+	private static final String COLOR_ARRAY_KEY = "bench.array.colors";
+
+	@Param({ "1", "10", "100", "1000", "10000", "100000", "1000000" })
+	public int mLength;
+
+	private Store mStore;
+	private int[] mIntegerArray;
+	private Color[] mColorArray;
+
+	@Setup(Level.Trial)
+	public void setUp() {
+		mStore = BenchmarkStores.createStore();
+		mIntegerArray = new int[mLength];
+		for (int i = 0; i < mLength; ++i) {
+			mIntegerArray[i] = i;
+		}
+		mColorArray = BenchmarkStores.makeColors(mLength);
+		mStore.setIntegerArray(INTEGER_ARRAY_KEY, mIntegerArray);
+		mStore.setColorArray(COLOR_ARRAY_KEY, mColorArray);
+	}
+
+	@TearDown(Level.Trial)
+	public void tearDown() {
+		mStore.finalizeStore();
+	}
+
+	@Benchmark
+	public int[] getIntegerArray() throws NotExistingKeyException {
+		return mStore.getIntegerArray(INTEGER_ARRAY_KEY);
+	}
+
+	@Benchmark
+	public void setIntegerArray() {
+		mStore.setIntegerArray(INTEGER_ARRAY_KEY, mIntegerArray);
+	}
+
+	@Benchmark
+	public long sumIntegerArray() throws NotExistingKeyException, InvalidTypeException {
+		return mStore.sumIntegerArray(INTEGER_ARRAY_KEY);
+	}
+
+	@Benchmark
+	public Color[] getColorArray() throws NotExistingKeyException {
+		return mStore.getColorArray(COLOR_ARRAY_KEY);
+	}
+
+	@Benchmark
+	public void setColorArray() {
+		mStore.setColorArray(COLOR_ARRAY_KEY, mColorArray);
+	}
+}
@@ -0,0 +1,78 @@
+package za.co.technodev.javajni.jmh;
+
+import za.co.technodev.javajni.Color;
+import za.co.technodev.javajni.Store;
+import za.co.technodev.javajni.StoreListener;
+
+/*
+ * Stores and keys shared by the benchmarks. Stores live in memory, on a single shard, with the
+ * watcher scanning at its default interval and no rule set: alerts never fire.
+ */
+
+final class BenchmarkStores {
+	//Writes are batched when populating, as setIntegers() takes the shard lock once per batch
+	static final int BATCH_SIZE = 4096;
+
+	private BenchmarkStores() {
+	}
+
+	static Store createStore() {
+		Store lStore = new Store(new StoreListener() {
+			public void onAlert(int pValue) {
+			}
+
+			public void onAlert(String pValue) {
+			}
+
+			public void onAlert(Color pValue) {
+			}
+		});
+		lStore.initializeStore();
+		return lStore;
+	}
+
+	static String[] makeKeys(String pPrefix, int pCount) {
+		String[] lKeys = new String[pCount];
+		for (int i = 0; i < pCount; ++i) {
+			lKeys[i] = pPrefix + i;
+		}
+		return lKeys;
+	}
+
+	static long[] resolveKeys(Store pStore, String[] pKeys) {
+		long[] lHandles = new long[pKeys.length];
+		for (int i = 0; i < pKeys.length; ++i) {
+			lHandles[i] = pStore.resolveKey(pKeys[i]);
+		}
+		return lHandles;
+	}
+
+	/*
+	 * Sets every key to an Integer, returns how many were stored before the store got full.
+	 */
+	static int populateIntegers(Store pStore, String[] pKeys) {
+		int lStored = 0;
+		int[] lValues = new int[BATCH_SIZE];
+		int[] lStatus = new int[BATCH_SIZE];
+		for (int i = 0; i < pKeys.length; i += BATCH_SIZE) {
+			int lLength = Math.min(BATCH_SIZE, pKeys.length - i);
+			String[] lBatch = new String[lLength];
+			System.arraycopy(pKeys, i, lBatch, 0, lLength);
+			pStore.setIntegers(lBatch, lValues, lStatus);
+			for (int j = 0; j < lLength; ++j) {
+				if (lStatus[j] == Store.STATUS_OK) {
+					++lStored;
+				}
+			}
+		}
+		return lStored;
+	}
+
+	static Color[] makeColors(int pLength) {
+		Color[] lColors = new Color[pLength];
+		for (int i = 0; i < pLength; ++i) {
+			lColors[i] = new Color(0xFF000000 | i);
+		}
+		return lColors;
+	}
+}
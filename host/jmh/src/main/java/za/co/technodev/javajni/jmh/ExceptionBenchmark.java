@@ -0,0 +1,88 @@
+package za.co.technodev.javajni.jmh;
+
+import java.util.concurrent.TimeUnit;
+
+import org.openjdk.jmh.annotations.Benchmark;
+import org.openjdk.jmh.annotations.BenchmarkMode;
+import org.openjdk.jmh.annotations.Fork;
+import org.openjdk.jmh.annotations.Level;
+import org.openjdk.jmh.annotations.Measurement;
+import org.openjdk.jmh.annotations.Mode;
+import org.openjdk.jmh.annotations.OutputTimeUnit;
+import org.openjdk.jmh.annotations.Scope;
+import org.openjdk.jmh.annotations.Setup;
+import org.openjdk.jmh.annotations.State;
+import org.openjdk.jmh.annotations.TearDown;
+import org.openjdk.jmh.annotations.Warmup;
+
+import za.co.technodev.exception.InvalidTypeException;
+import za.co.technodev.exception.NotExistingKeyException;
+import za.co.technodev.javajni.Store;
+
+/*
+ * Cost of the error paths: a getter throwing for a missing key or a wrong type, against the same
+ * getter succeeding and against the batch getter reporting a missing key through its status.
+ */
+
+@BenchmarkMode(Mode.AverageTime)
+@OutputTimeUnit(TimeUnit.NANOSECONDS)
+@Warmup(iterations = 3, time = 1)
+@Measurement(iterations = 5, time = 1)
+@Fork(1)
+@State(Scope.Benchmark)
+public class ExceptionBenchmark {
+	private static final String INTEGER_KEY = "bench.exception.integer";
+	private static final String STRING_KEY = "bench.exception.string";
+	private static final String MISSING_KEY = "bench.exception.missing";
+
+	private Store mStore;
+	private String[] mMissingKeys;
+	private int[] mValues;
+	private int[] mStatus;
+
+	@Setup(Level.Trial)
+	public void setUp() {
+		mStore = BenchmarkStores.createStore();
+		mStore.setInteger(INTEGER_KEY, 1);
+		mStore.setString(STRING_KEY, STRING_KEY);
+		mMissingKeys = new String[] { MISSING_KEY };
+		mValues = new int[1];
+		mStatus = new int[1];
+	}
+
+	@TearDown(Level.Trial)
+	public void tearDown() {
+		mStore.finalizeStore();
+	}
+
+	@Benchmark
+	public int getInteger() throws NotExistingKeyException, InvalidTypeException {
+		return mStore.getInteger(INTEGER_KEY);
+	}
+
+	@Benchmark
+	public Exception getIntegerMissingKey() throws InvalidTypeException {
+		try {
+			mStore.getInteger(MISSING_KEY);
+		} catch (NotExistingKeyException eNotExistingKeyException) {
+			return eNotExistingKeyException;
+		}
+		throw new IllegalStateException("Missing key found");
+	}
+
+	@Benchmark
+	public Exception getIntegerWrongType() throws NotExistingKeyException {
+		try {
+			mStore.getInteger(STRING_KEY);
+		} catch (InvalidTypeException eInvalidTypeException) {
+			return eInvalidTypeException;
+		}
+		throw new IllegalStateException("String read as an Integer");
+	}
+
+	@Benchmark
+	public int getIntegersMissingKeyStatus() {
+		mStore.getIntegers(mMissingKeys, mValues, mStatus);
+		return mStatus[0];
+	}
+}
@@ -0,0 +1,85 @@
+package za.co.technodev.javajni.jmh;
+
+import java.util.Random;
+import java.util.concurrent.TimeUnit;
+
+import org.openjdk.jmh.annotations.Benchmark;
+import org.openjdk.jmh.annotations.BenchmarkMode;
+import org.openjdk.jmh.annotations.Fork;
+import org.openjdk.jmh.annotations.Level;
+import org.openjdk.jmh.annotations.Measurement;
+import org.openjdk.jmh.annotations.Mode;
+import org.openjdk.jmh.annotations.OutputTimeUnit;
+import org.openjdk.jmh.annotations.Param;
+import org.openjdk.jmh.annotations.Scope;
+import org.openjdk.jmh.annotations.Setup;
+import org.openjdk.jmh.annotations.State;
+import org.openjdk.jmh.annotations.TearDown;
+import org.openjdk.jmh.annotations.Warmup;
+
+import za.co.technodev.exception.InvalidTypeException;
+import za.co.technodev.exception.NotExistingKeyException;
+import za.co.technodev.javajni.Store;
+
+/*
+ * Integer get and set by key, on stores of mKeyCount keys, in random key order so that lookups do
+ * not benefit from the caches more than in an app. The key order is drawn once, with a fixed seed.
+ * Lookups should stay flat as the store grows.
+ */
+
+@BenchmarkMode(Mode.AverageTime)
+@OutputTimeUnit(TimeUnit.NANOSECONDS)
+@Warmup(iterations = 3, time = 1)
+@Measurement(iterations = 5, time = 1)
+@Fork(1)
+@State(Scope.Benchmark)
+public class KeyScalingBenchmark {
+	private static final int ORDER_LENGTH = 1 << 16;
+
+	@Param({ "100", "1000", "10000", "100000", "1000000" })
+	public int mKeyCount;
+
+	private Store mStore;
+	private String[] mKeys;
+	private int[] mOrder;
+	private int mIndex;
+
+	@Setup(Level.Trial)
+	public void setUp() {
+		mStore = BenchmarkStores.createStore();
+		mKeys = BenchmarkStores.makeKeys("bench.scaling.", mKeyCount);
+		if (BenchmarkStores.populateIntegers(mStore, mKeys) != mKeyCount) {
+			throw new IllegalStateException("Store full before " + mKeyCount + " keys");
+		}
+		Random lRandom = new Random(42);
+		mOrder = new int[ORDER_LENGTH];
+		for (int i = 0; i < ORDER_LENGTH; ++i) {
+			mOrder[i] = lRandom.nextInt(mKeyCount);
+		}
+	}
+
+	@TearDown(Level.Trial)
+	public void tearDown() {
+		mStore.finalizeStore();
+	}
+
+	private String nextKey() {
+		mIndex = (mIndex + 1) & (ORDER_LENGTH - 1);
+		return mKeys[mOrder[mIndex]];
+	}
+
+	@Benchmark
+	public int getInteger() throws NotExistingKeyException, InvalidTypeException {
+		return mStore.getInteger(nextKey());
+	}
+
+	@Benchmark
+	public void setInteger() {
+		mStore.setInteger(nextKey(), mIndex);
+	}
+
+	@Benchmark
+	public long resolveKey() {
+		return mStore.resolveKey(nextKey());
+	}
+}
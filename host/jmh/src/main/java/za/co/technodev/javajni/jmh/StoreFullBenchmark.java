@@ -0,0 +1,137 @@
+package za.co.technodev.javajni.jmh;
+
+import java.util.ArrayList;
+import java.util.concurrent.TimeUnit;
+
+import org.openjdk.jmh.annotations.Benchmark;
+import org.openjdk.jmh.annotations.BenchmarkMode;
+import org.openjdk.jmh.annotations.Fork;
+import org.openjdk.jmh.annotations.Level;
+import org.openjdk.jmh.annotations.Measurement;
+import org.openjdk.jmh.annotations.Mode;
+import org.openjdk.jmh.annotations.OutputTimeUnit;
+import org.openjdk.jmh.annotations.Scope;
+import org.openjdk.jmh.annotations.Setup;
+import org.openjdk.jmh.annotations.State;
+import org.openjdk.jmh.annotations.TearDown;
+import org.openjdk.jmh.annotations.Warmup;
+
+import za.co.technodev.exception.InvalidTypeException;
+import za.co.technodev.exception.NotExistingKeyException;
+import za.co.technodev.exception.StoreFullException;
+import za.co.technodev.javajni.Store;
+
+/*
+ * Behavior of a store which holds as many keys as it can: new keys are rejected, single writes
+ * with StoreFullException and batched ones through their status, while existing keys stay
+ * readable and writable. Filling the store is measured apart, from empty, as a single shot.
+ */
+
+@BenchmarkMode(Mode.AverageTime)
+@OutputTimeUnit(TimeUnit.NANOSECONDS)
+@Warmup(iterations = 3, time = 1)
+@Measurement(iterations = 5, time = 1)
+@Fork(1)
+@State(Scope.Benchmark)
+public class StoreFullBenchmark {
+	private Store mStore;
+	private String[] mKeys;
+	private String[] mRejectedKeys;
+	private int[] mValues;
+	private int[] mStatus;
+	private int mIndex;
+
+	/*
+	 * Keys are added by batches until one is rejected.
+	 */
+	static String[] fill(Store pStore) {
+		ArrayList<String> lKeys = new ArrayList<String>();
+		int[] lValues = new int[BenchmarkStores.BATCH_SIZE];
+		int[] lStatus = new int[BenchmarkStores.BATCH_SIZE];
+		boolean lFull = false;
+		while (!lFull) {
+			String[] lBatch = BenchmarkStores.makeKeys("bench.full." + lKeys.size() + ".", BenchmarkStores.BATCH_SIZE);
+			pStore.setIntegers(lBatch, lValues, lStatus);
+			for (int i = 0; i < lBatch.length; ++i) {
+				if (lStatus[i] == Store.STATUS_OK) {
+					lKeys.add(lBatch[i]);
+				} else {
+					lFull = true;
+				}
+			}
+		}
+		return lKeys.toArray(new String[lKeys.size()]);
+	}
+
+	@Setup(Level.Trial)
+	public void setUp() {
+		mStore = BenchmarkStores.createStore();
+		mKeys = fill(mStore);
+		mRejectedKeys = BenchmarkStores.makeKeys("bench.full.rejected.", BenchmarkStores.BATCH_SIZE);
+		mValues = new int[BenchmarkStores.BATCH_SIZE];
+		mStatus = new int[BenchmarkStores.BATCH_SIZE];
+	}
+
+	@TearDown(Level.Trial)
+	public void tearDown() {
+		mStore.finalizeStore();
+	}
+
+	@Benchmark
+	public Exception setIntegerNewKey() {
+		try {
+			mStore.setInteger("bench.full.rejected", 0);
+		} catch (StoreFullException eStoreFullException) {
+			return eStoreFullException;
+		}
+		throw new IllegalStateException("Full store took a new key");
+	}
+
+	/*
+	 * One operation is a whole batch of BATCH_SIZE rejected keys.
+	 */
+	@Benchmark
+	public int[] setIntegersNewKeys() {
+		mStore.setIntegers(mRejectedKeys, mValues, mStatus);
+		return mStatus;
+	}
+
+	@Benchmark
+	public void setIntegerExistingKey() {
+		mIndex = (mIndex + 1) % mKeys.length;
+		mStore.setInteger(mKeys[mIndex], mIndex);
+	}
+
+	@Benchmark
+	public int getIntegerExistingKey() throws NotExistingKeyException, InvalidTypeException {
+		mIndex = (mIndex + 1) % mKeys.length;
+		return mStore.getInteger(mKeys[mIndex]);
+	}
+
+	/*
+	 * A fresh store for each fill, outside of the measurement.
+	 */
+	@State(Scope.Benchmark)
+	public static class EmptyStore {
+		Store mStore;
+
+		@Setup(Level.Iteration)
+		public void setUp() {
+			mStore = BenchmarkStores.createStore();
+		}
+
+		@TearDown(Level.Iteration)
+		public void tearDown() {
+			mStore.finalizeStore();
+		}
+	}
+
+	@Benchmark
+	@BenchmarkMode(Mode.SingleShotTime)
+	@OutputTimeUnit(TimeUnit.MILLISECONDS)
+	@Warmup(iterations = 1)
+	@Measurement(iterations = 5)
+	public String[] fillUntilFull(EmptyStore pEmptyStore) {
+		return fill(pEmptyStore.mStore);
+	}
+}
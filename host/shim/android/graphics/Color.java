@@ -0,0 +1,17 @@
+package android.graphics;
+
+/*
+ * Stand-in for the Android Color in the host build, see host/Makefile. Only parseColor() is
+ * provided, for the #RRGGBB and #AARRGGBB forms.
+ */
+
+public class Color {
+	public static int parseColor(String pColor) {
+		if ((pColor.length() == 7) && (pColor.charAt(0) == '#')) {
+			return 0xFF000000 | (int) Long.parseLong(pColor.substring(1), 16);
+		} else if ((pColor.length() == 9) && (pColor.charAt(0) == '#')) {
+			return (int) Long.parseLong(pColor.substring(1), 16);
+		}
+		throw new IllegalArgumentException("Unknown color");
+	}
+}
@@ -0,0 +1,40 @@
+package android.os;
+
+import java.util.concurrent.LinkedBlockingQueue;
+import java.util.concurrent.RejectedExecutionException;
+import java.util.concurrent.ThreadFactory;
+import java.util.concurrent.ThreadPoolExecutor;
+import java.util.concurrent.TimeUnit;
+
+/*
+ * Stand-in for the Android Handler in the host build, see host/Makefile. A desktop JVM has no
+ * Looper: Runnables posted to a handler run in order on a daemon thread of its own, as they would
+ * on the thread of its Looper. The thread exits once idle, so that handlers of finalized stores do
+ * not keep one each. Only what Store uses is provided.
+ */
+
+public class Handler {
+	private static final long IDLE_TIMEOUT = 1000;
+
+	private final ThreadPoolExecutor mExecutor = new ThreadPoolExecutor(1, 1, IDLE_TIMEOUT, TimeUnit.MILLISECONDS,
+			new LinkedBlockingQueue<Runnable>(), new ThreadFactory() {
+				public Thread newThread(Runnable pRunnable) {
+					Thread lThread = new Thread(pRunnable, "Handler");
+					lThread.setDaemon(true);
+					return lThread;
+				}
+			});
+
+	public Handler() {
+		mExecutor.allowCoreThreadTimeOut(true);
+	}
+
+	public final boolean post(Runnable pRunnable) {
+		try {
+			mExecutor.execute(pRunnable);
+			return true;
+		} catch (RejectedExecutionException eRejectedExecutionException) {
+			return false;
+		}
+	}
+}
@@ -3,7 +3,12 @@ LOCAL_PATH := $(call my-dir)
 include $(CLEAR_VARS)
 
 LOCAL_CFLAGS	:= -DHAVE_INTTYPES_H
+#Native instrumentation returned by Store.getStats(), off unless built with STORE_STATS=1
+STORE_STATS	?= 0
+ifeq ($(STORE_STATS),1)
+LOCAL_CFLAGS	+= -DSTORE_STATS
+endif
 LOCAL_MODULE	:= store
-LOCAL_SRC_FILES	:= StoreWatcher.c za_co_technodev_javajni_Store.c Store.c
+LOCAL_SRC_FILES	:= StoreWatcher.c za_co_technodev_javajni_Store.c Store.c StoreArena.c StoreCache.c StoreImage.c StoreInstance.c StoreAggregate.c StoreStats.c StoreRules.c StoreExport.c StoreIndex.c StoreAlerts.c StoreSnapshot.c StoreHistory.c
 
 include $(BUILD_SHARED_LIBRARY)
\ No newline at end of file
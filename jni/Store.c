@@ -1,126 +1,636 @@
 #include "Store.h"
+#include "StoreCache.h"
+#include "StoreHistory.h"
+#include <stdlib.h>
 #include <string.h>
+#include <sys/mman.h>
+
+int32_t findSlot(Store* pStore, const char* pKey, uint32_t pHash);
+void insertSlot(Store* pStore, uint32_t pHash, int32_t pIndex);
+int32_t growSlots(Store* pStore, int32_t pSlotCount);
+int32_t removeEntry(JNIEnv* pEnv, Store* pStore, int32_t pIndex);
 
 int32_t isEntryValid(JNIEnv* pEnv, StoreEntry* pEntry, StoreType pType) {
-	if (pEntry == NULL) {
+	switch (checkEntry(pEntry, pType)) {
+	case STORE_STATUS_NOT_EXISTING_KEY:
 		throwNotExistingKeyException(pEnv);
-	} else if (pEntry->mType != pType) {
+		break;
+	case STORE_STATUS_INVALID_TYPE:
 		throwInvalidTypeException(pEnv);
-	} else {
+		break;
+	default:
 		return 1;
 	}
 	return 0;
 }
 
-/* Good practice to check that GetStringUTFChars() does not return a NULL value
- *
- */
+int32_t checkEntry(StoreEntry* pEntry, StoreType pType) {
+	if ((pEntry == NULL) || (pEntry->mType == StoreType_None) || (pEntry->mType == StoreType_Removed)) {
+		return STORE_STATUS_NOT_EXISTING_KEY;
+	} else if (pEntry->mType != pType) {
+		return STORE_STATUS_INVALID_TYPE;
+	} else {
+		return STORE_STATUS_OK;
+	}
+}
 
-StoreEntry* findEntry(JNIEnv* pEnv, Store* pStore, jstring pKey, int32_t* pError) {
-	StoreEntry* lEntry = pStore->mEntries;
-	StoreEntry* lEntryEnd = lEntry + pStore->mLength;
+int32_t lookupIndex(Store* pStore, const char* pKey, uint32_t pHash) {
+	int32_t lSlot = findSlot(pStore, pKey, pHash);
+	return (lSlot != STORE_EMPTY_SLOT) ? pStore->mSlots[lSlot].mIndex : STORE_EMPTY_SLOT;
+}
 
-	const char* lKeyTmp = (*pEnv)->GetStringUTFChars(pEnv, pKey, NULL);
+/* Probe the slot table starting at the key hash. The cached hash is compared first so that
+ * strcmp() only runs on real candidates, tombstones are stepped over. The table, tombstones
+ * included, is never more than 3/4 full, which guarantees that probing ends on an empty slot.
+ */
 
-	if (lKeyTmp == NULL) {
-		if (pError != NULL) {
-			*pError = 1;
+int32_t findSlot(Store* pStore, const char* pKey, uint32_t pHash) {
+	if (pStore->mSlots == NULL) {
+		return STORE_EMPTY_SLOT;
+	}
+
+	uint32_t lMask = (uint32_t) pStore->mSlotCount - 1;
+	uint32_t lSlot = pHash & lMask;
+	int32_t lFound = STORE_EMPTY_SLOT;
+	int32_t lProbes = 1;
+	while (pStore->mSlots[lSlot].mIndex != STORE_EMPTY_SLOT) {
+		if ((pStore->mSlots[lSlot].mHash == pHash) && (pStore->mSlots[lSlot].mIndex != STORE_TOMBSTONE_SLOT)
+		 && (strcmp(getEntry(pStore, pStore->mSlots[lSlot].mIndex)->mKey, pKey) == 0)) {
+			lFound = (int32_t) lSlot;
+			break;
 		}
-		return;
+		lSlot = (lSlot + 1) & lMask;
+		++lProbes;
 	}
+	STATS_VALUE(pStore->mStats, StoreStat_LookupProbes, lProbes);
+	return lFound;
+}
+
+/* Entries are never moved nor freed before the store is released, so an index stays valid until
+ * then and resolving it costs a bound check. A removed entry resolves to nothing, but the index may
+ * name another key later on: callers holding an index across a removal check the entry generation.
+ */
 
-	while ((lEntry < lEntryEnd) && (strcmp(lEntry->mKey, lKeyTmp) != 0)) {
-		++lEntry;
+StoreEntry* findIndexEntry(Store* pStore, int32_t pIndex) {
+	if ((pIndex < 0) || (pIndex >= pStore->mLength)) {
+		return NULL;
 	}
-	(*pEnv)->ReleaseStringUTFChars(pEnv, pKey, lKeyTmp);
+	StoreEntry* lEntry = getEntry(pStore, pIndex);
+	return (lEntry->mType != StoreType_Removed) ? lEntry : NULL;
+}
 
-	return (lEntry == lEntryEnd) ? NULL : lEntry;
+StoreEntry* getEntry(Store* pStore, int32_t pIndex) {
+	return pStore->mChunks[pIndex >> STORE_CHUNK_SHIFT] + (pIndex & (STORE_CHUNK_SIZE - 1));
 }
 
-/* Raw JNI objects live for the time of a method and cannot be kept outside its scope
- * Convert key to C string kept in memory outside method scope
+/* FNV-1a, cheap and good enough to spread short textual keys over the slot table
  *
  */
 
-StoreEntry* allocateEntry(JNIEnv* pEnv, Store* pStore, jstring pKey) {
-	int32_t lError = 0;
-	StoreEntry* lEntry = findEntry(pEnv, pStore, pKey, &lError);
-	if (lEntry != NULL) {
-		releaseEntryValue(pEnv, lEntry);
-	} else if (!lError) {
-		if (pStore->mLength >= STORE_MAX_CAPACITY) {
-			throwStoreFullException(pEnv);
+uint32_t hashKey(const char* pKey) {
+	uint32_t lHash = 2166136261u;
+	while (*pKey != '\0') {
+		lHash ^= (uint8_t) *pKey++;
+		lHash *= 16777619u;
+	}
+	return lHash;
+}
+
+/* The key must not be in the store already, so the first tombstone met can be reused.
+ *
+ */
+
+void insertSlot(Store* pStore, uint32_t pHash, int32_t pIndex) {
+	uint32_t lMask = (uint32_t) pStore->mSlotCount - 1;
+	uint32_t lSlot = pHash & lMask;
+	while (pStore->mSlots[lSlot].mIndex >= 0) {
+		lSlot = (lSlot + 1) & lMask;
+	}
+	if (pStore->mSlots[lSlot].mIndex == STORE_TOMBSTONE_SLOT) {
+		--pStore->mTombstones;
+	}
+	pStore->mSlots[lSlot].mHash = pHash;
+	pStore->mSlots[lSlot].mIndex = pIndex;
+}
+
+/* Only the slot table is rebuilt when the store grows, entries themselves stay in place.
+ * Cached hashes avoid hashing every key again. Removed entries are left out, which purges
+ * tombstones.
+ */
+
+int32_t growSlots(Store* pStore, int32_t pSlotCount) {
+	StoreSlot* lSlots = (StoreSlot*) malloc(pSlotCount * sizeof(StoreSlot));
+	if (lSlots == NULL) {
+		return 0;
+	}
+	int32_t i;
+	for (i = 0; i < pSlotCount; ++i) {
+		lSlots[i].mIndex = STORE_EMPTY_SLOT;
+	}
+
+	free(pStore->mSlots);
+	pStore->mSlots = lSlots;
+	pStore->mSlotCount = pSlotCount;
+	pStore->mTombstones = 0;
+	for (i = 0; i < pStore->mLength; ++i) {
+		StoreEntry* lEntry = getEntry(pStore, i);
+		if (lEntry->mType != StoreType_Removed) {
+			insertSlot(pStore, lEntry->mHash, i);
+		}
+	}
+	return 1;
+}
+
+/* Returns room for entry mLength, allocating a new chunk if needed, with its mIndex set. The caller
+ * fills the entry then increments mLength.
+ */
+
+StoreEntry* appendEntry(Store* pStore) {
+	int32_t lChunk = pStore->mLength >> STORE_CHUNK_SHIFT;
+	if (lChunk == pStore->mChunkCount) {
+		StoreEntry** lChunks = (StoreEntry**) realloc(pStore->mChunks, (lChunk + 1) * sizeof(StoreEntry*));
+		if (lChunks == NULL) {
+			return NULL;
+		}
+		pStore->mChunks = lChunks;
+		StoreEntry** lDirty = (StoreEntry**) realloc(pStore->mDirty, (lChunk + 1) * STORE_CHUNK_SIZE * sizeof(StoreEntry*));
+		if (lDirty == NULL) {
 			return NULL;
 		}
+		pStore->mDirty = lDirty;
 
-		//Return last array element
-		lEntry = pStore->mEntries + pStore->mLength;
+		lChunks[lChunk] = (StoreEntry*) calloc(STORE_CHUNK_SIZE, sizeof(StoreEntry));
+		if (lChunks[lChunk] == NULL) {
+			return NULL;
+		}
+		++pStore->mChunkCount;
+	}
+	StoreEntry* lEntry = getEntry(pStore, pStore->mLength);
+	lEntry->mIndex = pStore->mLength;
+	return lEntry;
+}
 
-		//Converting jstring to native c string
-		const char* lKeyTmp = (*pEnv)->GetStringUTFChars(pEnv, pKey, NULL);
+/* Called after each write, with the store locked for writing. The entry is queued for the watcher
+ * once until the watcher picks it up, so the dirty list never holds more entries than the store and
+ * queuing never allocates. The watcher also queues entries itself, with the store locked for
+ * reading: writers are excluded and readers never look at the list. The new value is recorded in
+ * the version history of the instance, for snapshots.
+ */
+
+void touchEntry(Store* pStore, StoreEntry* pEntry) {
+	++pEntry->mVersion;
+	markEntryDirty(pStore, pEntry);
+	if (pStore->mHistory != NULL) {
+		publishEntry(pStore->mHistory, pEntry, 0);
+	}
+}
+
+/* Same as touchEntry() after an IntegerArray was appended to from pFrom, so that the history only
+ * copies the elements appended.
+ */
+
+void touchAppendedEntry(Store* pStore, StoreEntry* pEntry, int32_t pFrom) {
+	++pEntry->mVersion;
+	markEntryDirty(pStore, pEntry);
+	if (pStore->mHistory != NULL) {
+		publishEntry(pStore->mHistory, pEntry, pFrom);
+	}
+}
+
+void markEntryDirty(Store* pStore, StoreEntry* pEntry) {
+	if (!pEntry->mDirty) {
+		pEntry->mDirty = 1;
+		pStore->mDirty[pStore->mDirtyLength++] = pEntry;
+	}
+}
 
-		if (lKeyTmp == NULL) {
-			return;
+/* Returns the index of the entry for pKey, created with no value if the key is not in the store yet,
+ * or STORE_EMPTY_SLOT if the store is full. pHash is hashKey(pKey). Raises no Java exception.
+ *
+ * A new key takes the last removed entry if any. When tombstones would push the slot table over its
+ * load factor, the table is rebuilt at the same size if live keys fit in half of it, which amortizes
+ * the purge over the removals which caused it.
+ */
+
+int32_t reserveKey(Store* pStore, const char* pKey, uint32_t pHash) {
+	int32_t lIndex = lookupIndex(pStore, pKey, pHash);
+	if (lIndex != STORE_EMPTY_SLOT) {
+		return lIndex;
+	}
+
+	StoreEntry* lEntry;
+	int32_t lLiveCount = pStore->mLength - pStore->mFreeCount;
+	if ((pStore->mFreeEntry == STORE_EMPTY_SLOT) && (pStore->mLength >= STORE_MAX_CAPACITY)) {
+		return STORE_EMPTY_SLOT;
+	}
+	//Keep load factor under 3/4
+	if (((lLiveCount + pStore->mTombstones + 1) * 4 > pStore->mSlotCount * 3)
+	 && !growSlots(pStore, (pStore->mSlotCount == 0) ? STORE_MIN_SLOTS
+	  : ((lLiveCount + 1) * 2 > pStore->mSlotCount) ? pStore->mSlotCount * 2 : pStore->mSlotCount)) {
+		return STORE_EMPTY_SLOT;
+	}
+
+	StoreIndexNode* lNode = createIndexNode(&pStore->mKeyIndex);
+	if (lNode == NULL) {
+		return STORE_EMPTY_SLOT;
+	}
+	if (pStore->mFreeEntry != STORE_EMPTY_SLOT) {
+		lIndex = pStore->mFreeEntry;
+		lEntry = getEntry(pStore, lIndex);
+		if ((lEntry->mKey = allocateString(pStore, pKey)) == NULL) {
+			free(lNode);
+			return STORE_EMPTY_SLOT;
 		}
+		pStore->mFreeEntry = lEntry->mValue.mInteger;
+		--pStore->mFreeCount;
+		//The watcher binds the entry to the rule of its new key
+		lEntry->mRule = STORE_UNBOUND_RULE;
+		markEntryDirty(pStore, lEntry);
+	} else {
+		if (((lEntry = appendEntry(pStore)) == NULL)
+		 || ((lEntry->mKey = allocateString(pStore, pKey)) == NULL)) {
+			free(lNode);
+			return STORE_EMPTY_SLOT;
+		}
+		lIndex = pStore->mLength++;
+	}
 
-		//Allocating memory
-		lEntry->mKey = (char*) malloc(strlen(lKeyTmp));
+	lEntry->mHash = pHash;
+	lEntry->mType = StoreType_None;
+	insertSlot(pStore, pHash, lIndex);
+	lNode->mKey = lEntry->mKey;
+	lNode->mEntry = lIndex;
+	insertIndexNode(&pStore->mKeyIndex, lNode);
+	return lIndex;
+}
+
+/* Make room at once for pCount more keys and pSize bytes of keys and strings before a bulk
+ * insertion: the slot table is rebuilt once, to the size it will need, and the arena gets a single
+ * block. Keys already in the store are counted as new, so the table may end up larger than needed.
+ * Returns 0 if out of memory, in which case keys can still be added one by one.
+ */
+
+int32_t reserveStore(Store* pStore, int32_t pCount, size_t pSize) {
+	int32_t lLiveCount = pStore->mLength - pStore->mFreeCount + pCount;
+	if (lLiveCount > STORE_MAX_CAPACITY) {
+		lLiveCount = STORE_MAX_CAPACITY;
+	}
+	int32_t lSlotCount = (pStore->mSlotCount > 0) ? pStore->mSlotCount : STORE_MIN_SLOTS;
+	while ((lLiveCount + 1) * 4 > lSlotCount * 3) {
+		lSlotCount *= 2;
+	}
+	if ((lSlotCount != pStore->mSlotCount) && !growSlots(pStore, lSlotCount)) {
+		return 0;
+	}
 
-		//copy c string into mKey location
-		strcpy(lEntry->mKey, lKeyTmp);
+	if (isArenaFragmented(&pStore->mArena)) {
+		compactStore(pStore);
+	}
+	return reserveArena(&pStore->mArena, pSize);
+}
 
-		(*pEnv)->ReleaseStringUTFChars(pEnv, pKey, lKeyTmp);
+/* Reserve pKey and release its previous value, ready to be set. Raises StoreFullException and
+ * returns NULL if the key cannot be added.
+ */
 
-		++pStore->mLength;
+StoreEntry* allocateKeyEntry(JNIEnv* pEnv, Store* pStore, const char* pKey, uint32_t pHash) {
+	int32_t lIndex = reserveKey(pStore, pKey, pHash);
+	if (lIndex == STORE_EMPTY_SLOT) {
+		throwStoreFullException(pEnv);
+		return NULL;
 	}
+
+	StoreEntry* lEntry = getEntry(pStore, lIndex);
+	releaseEntryValue(pEnv, pStore, lEntry);
 	return lEntry;
 }
 
-/* Free memory allocated for a value
- *
+/* Release the value and the key of pKey, if in the store, and leave a tombstone in its slot. Its
+ * entry goes to the free list with a new generation. Returns whether the key had a value, a key only
+ * reserved through a handle being removed too.
  */
 
-void releaseEntryValue(JNIEnv* pEnv, StoreEntry* pEntry) {
+int32_t removeKey(JNIEnv* pEnv, Store* pStore, const char* pKey, uint32_t pHash) {
+	int32_t lSlot = findSlot(pStore, pKey, pHash);
+	if (lSlot == STORE_EMPTY_SLOT) {
+		return 0;
+	}
+	int32_t lRemoved = removeEntry(pEnv, pStore, pStore->mSlots[lSlot].mIndex);
+	pStore->mSlots[lSlot].mIndex = STORE_TOMBSTONE_SLOT;
+	++pStore->mTombstones;
+	return lRemoved;
+}
+
+/* The key is only accounted as dead in the arena, as string values. The entry is written one last
+ * time, so that the watcher drops it from its timed entries.
+ */
+
+int32_t removeEntry(JNIEnv* pEnv, Store* pStore, int32_t pIndex) {
+	StoreEntry* lEntry = getEntry(pStore, pIndex);
+	int32_t lRemoved = (lEntry->mType != StoreType_None);
+	releaseEntryValue(pEnv, pStore, lEntry);
+	removeIndexKey(&pStore->mKeyIndex, lEntry->mKey);
+	if (!isMapped(pStore, lEntry->mKey)) {
+		freeArenaString(&pStore->mArena, lEntry->mKey);
+	}
+	lEntry->mKey = NULL;
+	lEntry->mType = StoreType_Removed;
+	lEntry->mValue.mInteger = pStore->mFreeEntry;
+	lEntry->mLength = 0;
+	lEntry->mCapacity = 0;
+	lEntry->mGeneration = (lEntry->mGeneration + 1) & STORE_MAX_GENERATION;
+	lEntry->mAlerted = 0;
+	touchEntry(pStore, lEntry);
+	pStore->mFreeEntry = pIndex;
+	++pStore->mFreeCount;
+	return lRemoved;
+}
+
+/* Remove every key. Entries all go to the free list, so that no handle resolves anymore, and the
+ * slot table keeps its size. Nothing is left in the arena nor in the image mapping, which are
+ * released as by releaseStore().
+ */
+
+void clearStore(JNIEnv* pEnv, Store* pStore) {
 	int32_t i;
+	//Emptied at once rather than key by key
+	releaseIndex(&pStore->mKeyIndex);
+	//Backwards, so that entries are reused in order
+	for (i = pStore->mLength - 1; i >= 0; --i) {
+		if (getEntry(pStore, i)->mType != StoreType_Removed) {
+			removeEntry(pEnv, pStore, i);
+		}
+	}
+	for (i = 0; i < pStore->mSlotCount; ++i) {
+		pStore->mSlots[i].mIndex = STORE_EMPTY_SLOT;
+	}
+	pStore->mTombstones = 0;
+	releaseArena(&pStore->mArena);
+	if (pStore->mMapping != NULL) {
+		munmap(pStore->mMapping, pStore->mMappingSize);
+		pStore->mMapping = NULL;
+		pStore->mMappingSize = 0;
+	}
+}
+
+/* Copy a key or a string value into the store arena. The arena is compacted first if most of it
+ * is dead, so callers must not hold any string of the store across this call.
+ */
+
+char* allocateString(Store* pStore, const char* pString) {
+	if (isArenaFragmented(&pStore->mArena)) {
+		compactStore(pStore);
+	}
+	return copyArenaString(&pStore->mArena, pString);
+}
+
+/* Room for a UTF-16 value of pLength characters, filled by the caller. As for allocateString(), the
+ * arena may be compacted first.
+ */
+
+jchar* allocateChars(Store* pStore, int32_t pLength) {
+	if (isArenaFragmented(&pStore->mArena)) {
+		compactStore(pStore);
+	}
+	return (jchar*) allocateArena(&pStore->mArena, pLength * sizeof(jchar));
+}
+
+/* Java string for a String entry, with the store locked. The last string read or written is
+ * remembered through a weak reference and returned again until the VM collects it, so reading a
+ * value repeatedly does not allocate. Since readers share the store, the reference is only touched
+ * under mStringLock, but the string is built outside of it. Returns a local reference, or NULL with
+ * an exception pending if out of memory.
+ */
+
+jstring newEntryString(JNIEnv* pEnv, Store* pStore, StoreEntry* pEntry) {
+	jstring lString = NULL;
+	pthread_mutex_lock(&pStore->mStringLock);
+	if (pEntry->mJavaString != NULL) {
+		lString = (jstring) (*pEnv)->NewLocalRef(pEnv, pEntry->mJavaString);
+	}
+	pthread_mutex_unlock(&pStore->mStringLock);
+	if (lString != NULL) {
+		return lString;
+	}
+
+	lString = (*pEnv)->NewString(pEnv, pEntry->mValue.mString, pEntry->mLength);
+	if (lString != NULL) {
+		jweak lJavaString = (*pEnv)->NewWeakGlobalRef(pEnv, lString);
+		pthread_mutex_lock(&pStore->mStringLock);
+		releaseEntryString(pEnv, pEntry);
+		pEntry->mJavaString = lJavaString;
+		pthread_mutex_unlock(&pStore->mStringLock);
+	}
+	return lString;
+}
+
+/* Forget the Java string of an entry, with the store locked for writing or mStringLock held.
+ * Entries loaded from an image never have one, which is why pEnv may be NULL.
+ */
+
+void releaseEntryString(JNIEnv* pEnv, StoreEntry* pEntry) {
+	if (pEntry->mJavaString != NULL) {
+		(*pEnv)->DeleteWeakGlobalRef(pEnv, pEntry->mJavaString);
+		pEntry->mJavaString = NULL;
+	}
+}
+
+/* Copy every live key and string into a single block of a new arena and move entries onto it, then
+ * the key index onto their keys. Room is reserved upfront so that nothing can fail once entries
+ * start being updated. Must run under the write lock since every key and string pointer changes.
+ */
+
+void compactStore(Store* pStore) {
+	StoreArena lArena = { 0 };
+	if (!reserveArena(&lArena, pStore->mArena.mLiveBytes)) {
+		return;
+	}
+
+	int32_t i;
+	for (i = 0; i < pStore->mLength; ++i) {
+		StoreEntry* lEntry = getEntry(pStore, i);
+		if (lEntry->mType == StoreType_Removed) {
+			continue;
+		}
+		if (!isMapped(pStore, lEntry->mKey)) {
+			lEntry->mKey = copyArenaString(&lArena, lEntry->mKey);
+		}
+		if ((lEntry->mType == StoreType_String) && !isMapped(pStore, lEntry->mValue.mString)) {
+			lEntry->mValue.mString = (jchar*) copyArenaData(&lArena, lEntry->mValue.mString, lEntry->mLength * sizeof(jchar));
+		}
+	}
+	StoreIndexNode* lNode;
+	for (lNode = pStore->mKeyIndex.mHead[0]; lNode != NULL; lNode = lNode->mNext[0]) {
+		lNode->mKey = getEntry(pStore, lNode->mEntry)->mKey;
+	}
+	lArena.mCompactions = pStore->mArena.mCompactions + 1;
+	releaseArena(&pStore->mArena);
+	pStore->mArena = lArena;
+}
+
+/* Free memory allocated for a value. Strings are only accounted as dead, their bytes are
+ * reclaimed by the next compaction, and their Java string is forgotten. Values still in the store
+ * image belong to the mapping.
+ */
+
+void releaseEntryValue(JNIEnv* pEnv, Store* pStore, StoreEntry* pEntry) {
 	switch (pEntry->mType) {
 	case StoreType_String:
-		free(pEntry->mValue.mString);
-		break;
-	case StoreType_Color:
-		(*pEnv)->DeleteGlobalRef(pEnv, pEntry->mValue.mColor);
+		if (!isMapped(pStore, pEntry->mValue.mString)) {
+			freeArenaData(&pStore->mArena, pEntry->mLength * sizeof(jchar));
+		}
+		releaseEntryString(pEnv, pEntry);
 		break;
 	case StoreType_IntegerArray:
-		free(pEntry->mValue.mIntegerArray);
+		if (!isMapped(pStore, pEntry->mValue.mIntegerArray)) {
+			free(pEntry->mValue.mIntegerArray);
+		}
 		break;
 	case StoreType_ColorArray:
-		for (i = 0; i< pEntry->mLength; i++) {
-			(*pEnv)->DeleteGlobalRef(pEnv, pEntry->mValue.mColorArray[i]);
+		if (!isMapped(pStore, pEntry->mValue.mColorArray)) {
+			free(pEntry->mValue.mColorArray);
 		}
-		free(pEntry->mValue.mColorArray);
+		break;
+	default:
 		break;
 	}
 }
 
-void throwNotExistingKeyException(JNIEnv* pEnv) {
-	jclass lClass = (*pEnv)->FindClass(pEnv, "za/co/technodev/exception/NotExistingKeyException");
-	if (lClass != NULL) {
-		(*pEnv)->ThrowNew(pEnv, lClass, "Key does not exist");
+/* Shards are allocated dynamically, so their locks are initialized here rather than with
+ * STORE_INITIALIZER. Returns NULL if out of memory.
+ */
+
+Store* createStores(int32_t pCount) {
+	Store* lStores = (Store*) calloc(pCount, sizeof(Store));
+	if (lStores == NULL) {
+		return NULL;
+	}
+	int32_t i;
+	for (i = 0; i < pCount; ++i) {
+		lStores[i].mFreeEntry = STORE_EMPTY_SLOT;
+		pthread_rwlock_init(&lStores[i].mLock, NULL);
+		pthread_mutex_init(&lStores[i].mStringLock, NULL);
 	}
-	(*pEnv)->DeleteLocalRef(pEnv, lClass);
+	return lStores;
 }
 
-void throwInvalidTypeException(JNIEnv* pEnv) {
-	jclass lClass = (*pEnv)->FindClass(pEnv, "za/co/technodev/exception/InvalidTypeException");
-	if (lClass != NULL) {
-		(*pEnv)->ThrowNew(pEnv, lClass, "Invalid type");
+void destroyStores(JNIEnv* pEnv, Store* pStores, int32_t pCount) {
+	int32_t i;
+	for (i = 0; i < pCount; ++i) {
+		releaseStore(pEnv, &pStores[i]);
+		pthread_rwlock_destroy(&pStores[i].mLock);
+		pthread_mutex_destroy(&pStores[i].mStringLock);
 	}
-	(*pEnv)->DeleteLocalRef(pEnv, lClass);
+	free(pStores);
 }
 
-void throwStoreFullException(JNIEnv* pEnv) {
-	jclass lClass = (*pEnv)->FindClass(pEnv, "za/co/technodev/exception/StoreFullException");
-	if (lClass != NULL) {
-		(*pEnv)->ThrowNew(pEnv, lClass, "Store is full");
+/* Release array values and Java strings, then the chunks, the slot table, the key index and all
+ * keys and strings at once with the arena and the image mapping. The store is left empty and can be
+ * reused right away. The locks and the compaction count are kept as is.
+ */
+
+void releaseStore(JNIEnv* pEnv, Store* pStore) {
+	int32_t i;
+	for (i = 0; i < pStore->mLength; ++i) {
+		StoreEntry* lEntry = getEntry(pStore, i);
+		if (lEntry->mType != StoreType_String) {
+			releaseEntryValue(pEnv, pStore, lEntry);
+		} else {
+			releaseEntryString(pEnv, lEntry);
+		}
+	}
+	releaseIndex(&pStore->mKeyIndex);
+	releaseArena(&pStore->mArena);
+	if (pStore->mMapping != NULL) {
+		munmap(pStore->mMapping, pStore->mMappingSize);
+		pStore->mMapping = NULL;
+		pStore->mMappingSize = 0;
+	}
+	for (i = 0; i < pStore->mChunkCount; ++i) {
+		free(pStore->mChunks[i]);
 	}
-	(*pEnv)->DeleteLocalRef(pEnv, lClass);
+	free(pStore->mChunks);
+	free(pStore->mSlots);
+	free(pStore->mDirty);
+	pStore->mChunks = NULL;
+	pStore->mDirty = NULL;
+	pStore->mDirtyLength = 0;
+	pStore->mChunkCount = 0;
+	pStore->mSlots = NULL;
+	pStore->mSlotCount = 0;
+	pStore->mLength = 0;
+	pStore->mFreeEntry = STORE_EMPTY_SLOT;
+	pStore->mFreeCount = 0;
+	pStore->mTombstones = 0;
+}
+
+int32_t isMapped(Store* pStore, const void* pValue) {
+	return ((const char*) pValue >= (const char*) pStore->mMapping)
+		&& ((const char*) pValue < (const char*) pStore->mMapping + pStore->mMappingSize);
+}
+
+/*
+ * Moves a mapped array to the heap, so that it can be written in place or viewed: the mapping is
+ * read-only, and goes away on clear, import or finalize. Returns 0 if out of memory.
+ */
+
+int32_t detachEntryArray(Store* pStore, StoreEntry* pEntry) {
+	if (!isMapped(pStore, pEntry->mValue.mIntegerArray)) {
+		return 1;
+	}
+	int32_t* lArray = NULL;
+	if (pEntry->mLength > 0) {
+		lArray = (int32_t*) malloc(pEntry->mLength * sizeof(int32_t));
+		if (lArray == NULL) {
+			return 0;
+		}
+		memcpy(lArray, pEntry->mValue.mIntegerArray, pEntry->mLength * sizeof(int32_t));
+	}
+	pEntry->mValue.mIntegerArray = lArray;
+	pEntry->mCapacity = pEntry->mLength;
+	return 1;
+}
+
+/* Locking happens in native code rather than with synchronized Java methods, so that concurrent
+ * readers, including the watcher, do not serialize on the Store monitor.
+ */
+
+void lockStoreRead(Store* pStore) {
+	pthread_rwlock_rdlock(&pStore->mLock);
+}
+
+void lockStoreWrite(Store* pStore) {
+	pthread_rwlock_wrlock(&pStore->mLock);
+}
+
+void unlockStore(Store* pStore) {
+	pthread_rwlock_unlock(&pStore->mLock);
+}
+
+/* Exception classes are cached when the library is loaded, throwing does not look them up.
+ *
+ */
+
+void throwNotExistingKeyException(JNIEnv* pEnv) {
+	(*pEnv)->ThrowNew(pEnv, gStoreCache.ClassNotExistingKeyException, "Key does not exist");
+}
+
+void throwInvalidTypeException(JNIEnv* pEnv) {
+	(*pEnv)->ThrowNew(pEnv, gStoreCache.ClassInvalidTypeException, "Invalid type");
+}
+
+void throwStoreFullException(JNIEnv* pEnv) {
+	(*pEnv)->ThrowNew(pEnv, gStoreCache.ClassStoreFullException, "Store is full");
+}
+
+void throwIOException(JNIEnv* pEnv) {
+	(*pEnv)->ThrowNew(pEnv, gStoreCache.ClassIOException, "Cannot write store image");
+}
+
+void throwIndexOutOfBoundsException(JNIEnv* pEnv) {
+	(*pEnv)->ThrowNew(pEnv, gStoreCache.ClassIndexOutOfBoundsException, "Region out of array bounds");
+}
+
+void throwIllegalStateException(JNIEnv* pEnv, const char* pMessage) {
+	(*pEnv)->ThrowNew(pEnv, gStoreCache.ClassIllegalStateException, pMessage);
 }
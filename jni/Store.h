@@ -2,40 +2,169 @@
 #define _STORE_H_
 
 #include "jni.h"
+#include "StoreArena.h"
+#include "StoreStats.h"
+#include "StoreIndex.h"
 #include <stdint.h>
+#include <pthread.h>
 
-#define STORE_MAX_CAPACITY 16
+/*
+ * Entries live in fixed-size chunks which are never moved once allocated, so a StoreEntry pointer
+ * stays valid for the lifetime of the store even when the table grows. Keys are indexed by an
+ * open-addressing hash table (linear probing) holding the cached key hash and the entry index.
+ *
+ * Removing a key leaves a tombstone in its slot, so that probing goes on past it, and puts its entry
+ * in a free list, from which the next key added takes its entry. Tombstones are purged whenever the
+ * slot table is rebuilt, which happens as soon as they would push it over its load factor.
+ *
+ * Keys are also kept in order by a StoreIndex, updated along with the slots.
+ */
+#define STORE_MAX_CAPACITY (1 << 20)
+#define STORE_CHUNK_SHIFT 8
+#define STORE_CHUNK_SIZE (1 << STORE_CHUNK_SHIFT)
+#define STORE_MIN_SLOTS 32
+#define STORE_EMPTY_SLOT -1
+#define STORE_TOMBSTONE_SLOT -2
+//Generations wrap around within the 31 bits a handle has for them
+#define STORE_MAX_GENERATION 0x7FFFFFFF
+//Rule of an entry which took a new key since the watcher last saw it
+#define STORE_UNBOUND_RULE -2
+//Initial capacity of an IntegerArray created by an append, doubled each time it is exceeded
+#define STORE_MIN_ARRAY_CAPACITY 16
+#define STORE_MAX_ARRAY_LENGTH (INT32_MAX / (int32_t) sizeof(int32_t))
+
+/*
+ * Per-key status reported by batched accessors instead of an exception. Values mirror the
+ * STATUS_* constants of Store.java.
+ */
+#define STORE_STATUS_OK 0
+#define STORE_STATUS_NOT_EXISTING_KEY 1
+#define STORE_STATUS_INVALID_TYPE 2
+#define STORE_STATUS_STORE_FULL 3
+#define STORE_STATUS_ERROR 4
 
 typedef enum {
 	StoreType_Integer, StoreType_String, StoreType_Color,
-	StoreType_IntegerArray, StoreType_ColorArray
+	StoreType_IntegerArray, StoreType_ColorArray,
+	//Key reserved through a handle but not set yet
+	StoreType_None,
+	//Key removed, entry in the free list of the store
+	StoreType_Removed
 } StoreType;
 
 typedef union {
 	int32_t mInteger;
-	char* mString;
-	jobject mColor;
+	//UTF-16, as Java strings, mLength characters without terminator
+	jchar* mString;
+	//Colors are packed ARGB values, as in Color.mColor
+	int32_t mColor;
 	int32_t* mIntegerArray;
-	jobject* mColorArray;
+	int32_t* mColorArray;
 } StoreValue;
 
+struct StoreHistory;
+struct StoreHistoryKey;
+
 typedef struct {
 	char* mKey;
+	uint32_t mHash;
 	StoreType mType;
 	StoreValue mValue;
 	int32_t mLength;
+	//Elements allocated for mIntegerArray, which grows geometrically when appended to
+	int32_t mCapacity;
+	//Modification counter, incremented each time the value is written
+	int32_t mVersion;
+	//Incremented each time the key is removed, so that handles on it do not resolve to the next key
+	//taking the entry
+	int32_t mGeneration;
+	//Position of the entry in the store, which never changes once appended
+	int32_t mIndex;
+	//Last Java string read or written for a String entry, weak so that it does not keep the string
+	//alive. Accessed under mStringLock when the store is only locked for reading
+	jweak mJavaString;
+	//Queued in the dirty list of the store, see touchEntry()
+	int32_t mDirty;
+	//Owned by the watcher: rule bound to the entry, whether entry is in alert and when it was last reported
+	int32_t mRule;
+	int32_t mAlerted;
+	int64_t mAlertTime;
+	//Key of the entry in the version history, once recorded there and until removed
+	struct StoreHistoryKey* mHistoryKey;
 } StoreEntry;
 
 typedef struct {
-	StoreEntry mEntries[STORE_MAX_CAPACITY];
+	uint32_t mHash;
+	int32_t mIndex;
+} StoreSlot;
+
+typedef struct {
+	StoreEntry** mChunks;
+	int32_t mChunkCount;
+	StoreSlot* mSlots;
+	int32_t mSlotCount;
 	int32_t mLength;
+	//First entry of the free list, chained through mValue.mInteger, or STORE_EMPTY_SLOT
+	int32_t mFreeEntry;
+	int32_t mFreeCount;
+	int32_t mTombstones;
+	//Keys and string values
+	StoreArena mArena;
+	//Keys in order, with or without a value
+	StoreIndex mKeyIndex;
+	//Entries written since the watcher last looked at them, one slot per allocated entry
+	StoreEntry** mDirty;
+	int32_t mDirtyLength;
+	//Image the store was loaded from, if any. Keys, strings and arrays may point inside it
+	void* mMapping;
+	size_t mMappingSize;
+	//Readers share the store, writers own it exclusively
+	pthread_rwlock_t mLock;
+	//Guards mJavaString of entries between readers
+	pthread_mutex_t mStringLock;
+	//Shared by the shards of an instance, NULL for a standalone store
+	struct StoreHistory* mHistory;
+#ifdef STORE_STATS
+	//Shared by the shards of an instance, NULL for a standalone store
+	StoreStats* mStats;
+#endif
 } Store;
 
+#define STORE_INITIALIZER { .mFreeEntry = STORE_EMPTY_SLOT, .mLock = PTHREAD_RWLOCK_INITIALIZER, .mStringLock = PTHREAD_MUTEX_INITIALIZER }
+
 int32_t isEntryValid(JNIEnv* pEnv, StoreEntry* pEntry, StoreType pType);
-StoreEntry* allocateEntry(JNIEnv* pEnv, Store* pStore, jstring pKey);
-StoreEntry* findEntry(JNIEnv* pEnv, Store* pStore, jstring pKey, int32_t* pError);
-void releaseEntryValue(JNIEnv* pEnv, StoreEntry* pEntry);
+int32_t checkEntry(StoreEntry* pEntry, StoreType pType);
+int32_t lookupIndex(Store* pStore, const char* pKey, uint32_t pHash);
+int32_t reserveKey(Store* pStore, const char* pKey, uint32_t pHash);
+int32_t reserveStore(Store* pStore, int32_t pCount, size_t pSize);
+StoreEntry* allocateKeyEntry(JNIEnv* pEnv, Store* pStore, const char* pKey, uint32_t pHash);
+int32_t removeKey(JNIEnv* pEnv, Store* pStore, const char* pKey, uint32_t pHash);
+void clearStore(JNIEnv* pEnv, Store* pStore);
+StoreEntry* findIndexEntry(Store* pStore, int32_t pIndex);
+StoreEntry* getEntry(Store* pStore, int32_t pIndex);
+StoreEntry* appendEntry(Store* pStore);
+void touchEntry(Store* pStore, StoreEntry* pEntry);
+void touchAppendedEntry(Store* pStore, StoreEntry* pEntry, int32_t pFrom);
+void markEntryDirty(Store* pStore, StoreEntry* pEntry);
+int32_t isMapped(Store* pStore, const void* pValue);
+int32_t detachEntryArray(Store* pStore, StoreEntry* pEntry);
+char* allocateString(Store* pStore, const char* pString);
+jchar* allocateChars(Store* pStore, int32_t pLength);
+jstring newEntryString(JNIEnv* pEnv, Store* pStore, StoreEntry* pEntry);
+void releaseEntryString(JNIEnv* pEnv, StoreEntry* pEntry);
+void compactStore(Store* pStore);
+void releaseEntryValue(JNIEnv* pEnv, Store* pStore, StoreEntry* pEntry);
+void releaseStore(JNIEnv* pEnv, Store* pStore);
+Store* createStores(int32_t pCount);
+void destroyStores(JNIEnv* pEnv, Store* pStores, int32_t pCount);
+void lockStoreRead(Store* pStore);
+void lockStoreWrite(Store* pStore);
+void unlockStore(Store* pStore);
+uint32_t hashKey(const char* pKey);
 void throwInvalidTypeException(JNIEnv* pEnv);
 void throwNotExistingKeyException(JNIEnv* pEnv);
 void throwStoreFullException(JNIEnv* pEnv);
+void throwIOException(JNIEnv* pEnv);
+void throwIndexOutOfBoundsException(JNIEnv* pEnv);
+void throwIllegalStateException(JNIEnv* pEnv, const char* pMessage);
 #endif
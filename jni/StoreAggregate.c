@@ -0,0 +1,266 @@
+#include "StoreAggregate.h"
+#include <limits.h>
+#include <string.h>
+
+#if defined(STORE_AGGREGATE_AVX2)
+#include <immintrin.h>
+#elif defined(STORE_AGGREGATE_SSE2)
+#include <emmintrin.h>
+#elif defined(STORE_AGGREGATE_NEON)
+#include <arm_neon.h>
+#endif
+
+/*
+ * Each kernel processes as many full vectors as possible and finishes the remaining elements one
+ * by one. Vector accumulators are reduced by spilling their lanes, which only happens once per
+ * call.
+ */
+
+#if defined(STORE_AGGREGATE_SSE2)
+/*
+ * SSE2 has no signed 32-bit min/max (SSE4.1 has), select lanes through a comparison mask.
+ */
+static inline __m128i selectLanes(__m128i pMask, __m128i pIfSet, __m128i pIfClear) {
+	return _mm_or_si128(_mm_and_si128(pMask, pIfSet), _mm_andnot_si128(pMask, pIfClear));
+}
+#endif
+
+#if defined(STORE_AGGREGATE_NEON)
+static inline uint32_t anyLane(uint32x4_t pMask) {
+#if defined(__aarch64__)
+	return vmaxvq_u32(pMask);
+#else
+	uint32x2_t lMax = vpmax_u32(vget_low_u32(pMask), vget_high_u32(pMask));
+	return vget_lane_u32(vpmax_u32(lMax, lMax), 0);
+#endif
+}
+#endif
+
+/*
+ * Lanes are widened to 64 bits before being added, the sum cannot overflow.
+ */
+
+int64_t sumIntegers(const int32_t* pArray, int32_t pLength) {
+	int64_t lSum = 0;
+	int32_t i = 0;
+#if defined(STORE_AGGREGATE_AVX2)
+	__m256i lVectorSum = _mm256_setzero_si256();
+	for (; i + 8 <= pLength; i += 8) {
+		lVectorSum = _mm256_add_epi64(lVectorSum, _mm256_cvtepi32_epi64(_mm_loadu_si128((const __m128i*) (pArray + i))));
+		lVectorSum = _mm256_add_epi64(lVectorSum, _mm256_cvtepi32_epi64(_mm_loadu_si128((const __m128i*) (pArray + i + 4))));
+	}
+	int64_t lLanes[4];
+	_mm256_storeu_si256((__m256i*) lLanes, lVectorSum);
+	lSum = lLanes[0] + lLanes[1] + lLanes[2] + lLanes[3];
+#elif defined(STORE_AGGREGATE_SSE2)
+	//SSE2 cannot sign-extend: lanes are added as unsigned and 2^32 removed for each negative one
+	__m128i lZero = _mm_setzero_si128();
+	__m128i lVectorSum = lZero;
+	__m128i lNegatives = lZero;
+	for (; i + 4 <= pLength; i += 4) {
+		__m128i lValues = _mm_loadu_si128((const __m128i*) (pArray + i));
+		lVectorSum = _mm_add_epi64(lVectorSum, _mm_unpacklo_epi32(lValues, lZero));
+		lVectorSum = _mm_add_epi64(lVectorSum, _mm_unpackhi_epi32(lValues, lZero));
+		lNegatives = _mm_add_epi32(lNegatives, _mm_srli_epi32(lValues, 31));
+	}
+	int64_t lLanes[2];
+	int32_t lNegativeLanes[4];
+	_mm_storeu_si128((__m128i*) lLanes, lVectorSum);
+	_mm_storeu_si128((__m128i*) lNegativeLanes, lNegatives);
+	int64_t lNegativeCount = (int64_t) lNegativeLanes[0] + lNegativeLanes[1] + lNegativeLanes[2] + lNegativeLanes[3];
+	lSum = lLanes[0] + lLanes[1] - (lNegativeCount << 32);
+#elif defined(STORE_AGGREGATE_NEON)
+	int64x2_t lVectorSum = vdupq_n_s64(0);
+	for (; i + 4 <= pLength; i += 4) {
+		lVectorSum = vpadalq_s32(lVectorSum, vld1q_s32(pArray + i));
+	}
+	lSum = vgetq_lane_s64(lVectorSum, 0) + vgetq_lane_s64(lVectorSum, 1);
+#endif
+	for (; i < pLength; ++i) {
+		lSum += pArray[i];
+	}
+	return lSum;
+}
+
+/*
+ * An empty array has INT_MAX as minimum and INT_MIN as maximum.
+ */
+
+int32_t minIntegers(const int32_t* pArray, int32_t pLength) {
+	int32_t lMin = INT_MAX;
+	int32_t i = 0;
+#if defined(STORE_AGGREGATE_AVX2)
+	__m256i lVectorMin = _mm256_set1_epi32(INT_MAX);
+	for (; i + 8 <= pLength; i += 8) {
+		lVectorMin = _mm256_min_epi32(lVectorMin, _mm256_loadu_si256((const __m256i*) (pArray + i)));
+	}
+	int32_t lLanes[8];
+	_mm256_storeu_si256((__m256i*) lLanes, lVectorMin);
+#elif defined(STORE_AGGREGATE_SSE2)
+	__m128i lVectorMin = _mm_set1_epi32(INT_MAX);
+	for (; i + 4 <= pLength; i += 4) {
+		__m128i lValues = _mm_loadu_si128((const __m128i*) (pArray + i));
+		lVectorMin = selectLanes(_mm_cmplt_epi32(lValues, lVectorMin), lValues, lVectorMin);
+	}
+	int32_t lLanes[4];
+	_mm_storeu_si128((__m128i*) lLanes, lVectorMin);
+#elif defined(STORE_AGGREGATE_NEON)
+	int32x4_t lVectorMin = vdupq_n_s32(INT_MAX);
+	for (; i + 4 <= pLength; i += 4) {
+		lVectorMin = vminq_s32(lVectorMin, vld1q_s32(pArray + i));
+	}
+	int32_t lLanes[4];
+	vst1q_s32(lLanes, lVectorMin);
+#else
+	int32_t lLanes[1] = { INT_MAX };
+#endif
+	int32_t j;
+	for (j = 0; j < (int32_t) (sizeof(lLanes) / sizeof(int32_t)); ++j) {
+		lMin = (lLanes[j] < lMin) ? lLanes[j] : lMin;
+	}
+	for (; i < pLength; ++i) {
+		lMin = (pArray[i] < lMin) ? pArray[i] : lMin;
+	}
+	return lMin;
+}
+
+int32_t maxIntegers(const int32_t* pArray, int32_t pLength) {
+	int32_t lMax = INT_MIN;
+	int32_t i = 0;
+#if defined(STORE_AGGREGATE_AVX2)
+	__m256i lVectorMax = _mm256_set1_epi32(INT_MIN);
+	for (; i + 8 <= pLength; i += 8) {
+		lVectorMax = _mm256_max_epi32(lVectorMax, _mm256_loadu_si256((const __m256i*) (pArray + i)));
+	}
+	int32_t lLanes[8];
+	_mm256_storeu_si256((__m256i*) lLanes, lVectorMax);
+#elif defined(STORE_AGGREGATE_SSE2)
+	__m128i lVectorMax = _mm_set1_epi32(INT_MIN);
+	for (; i + 4 <= pLength; i += 4) {
+		__m128i lValues = _mm_loadu_si128((const __m128i*) (pArray + i));
+		lVectorMax = selectLanes(_mm_cmpgt_epi32(lValues, lVectorMax), lValues, lVectorMax);
+	}
+	int32_t lLanes[4];
+	_mm_storeu_si128((__m128i*) lLanes, lVectorMax);
+#elif defined(STORE_AGGREGATE_NEON)
+	int32x4_t lVectorMax = vdupq_n_s32(INT_MIN);
+	for (; i + 4 <= pLength; i += 4) {
+		lVectorMax = vmaxq_s32(lVectorMax, vld1q_s32(pArray + i));
+	}
+	int32_t lLanes[4];
+	vst1q_s32(lLanes, lVectorMax);
+#else
+	int32_t lLanes[1] = { INT_MIN };
+#endif
+	int32_t j;
+	for (j = 0; j < (int32_t) (sizeof(lLanes) / sizeof(int32_t)); ++j) {
+		lMax = (lLanes[j] > lMax) ? lLanes[j] : lMax;
+	}
+	for (; i < pLength; ++i) {
+		lMax = (pArray[i] > lMax) ? pArray[i] : lMax;
+	}
+	return lMax;
+}
+
+/*
+ * Counts values between pLow and pHigh, both included. Comparison masks are all ones (-1) on
+ * matching lanes, subtracting them counts matches without branching.
+ */
+
+int32_t countIntegers(const int32_t* pArray, int32_t pLength, int32_t pLow, int32_t pHigh) {
+	int32_t lCount = 0;
+	int32_t i = 0;
+#if defined(STORE_AGGREGATE_AVX2)
+	__m256i lLow = _mm256_set1_epi32(pLow);
+	__m256i lHigh = _mm256_set1_epi32(pHigh);
+	__m256i lOutside = _mm256_setzero_si256();
+	for (; i + 8 <= pLength; i += 8) {
+		__m256i lValues = _mm256_loadu_si256((const __m256i*) (pArray + i));
+		lOutside = _mm256_sub_epi32(lOutside, _mm256_or_si256(_mm256_cmpgt_epi32(lLow, lValues), _mm256_cmpgt_epi32(lValues, lHigh)));
+	}
+	int32_t lLanes[8];
+	_mm256_storeu_si256((__m256i*) lLanes, lOutside);
+	lCount = i - (lLanes[0] + lLanes[1] + lLanes[2] + lLanes[3] + lLanes[4] + lLanes[5] + lLanes[6] + lLanes[7]);
+#elif defined(STORE_AGGREGATE_SSE2)
+	__m128i lLow = _mm_set1_epi32(pLow);
+	__m128i lHigh = _mm_set1_epi32(pHigh);
+	__m128i lOutside = _mm_setzero_si128();
+	for (; i + 4 <= pLength; i += 4) {
+		__m128i lValues = _mm_loadu_si128((const __m128i*) (pArray + i));
+		lOutside = _mm_sub_epi32(lOutside, _mm_or_si128(_mm_cmplt_epi32(lValues, lLow), _mm_cmpgt_epi32(lValues, lHigh)));
+	}
+	int32_t lLanes[4];
+	_mm_storeu_si128((__m128i*) lLanes, lOutside);
+	lCount = i - (lLanes[0] + lLanes[1] + lLanes[2] + lLanes[3]);
+#elif defined(STORE_AGGREGATE_NEON)
+	int32x4_t lLow = vdupq_n_s32(pLow);
+	int32x4_t lHigh = vdupq_n_s32(pHigh);
+	uint32x4_t lInside = vdupq_n_u32(0);
+	for (; i + 4 <= pLength; i += 4) {
+		int32x4_t lValues = vld1q_s32(pArray + i);
+		lInside = vsubq_u32(lInside, vandq_u32(vcgeq_s32(lValues, lLow), vcleq_s32(lValues, lHigh)));
+	}
+	uint32_t lLanes[4];
+	vst1q_u32(lLanes, lInside);
+	lCount = (int32_t) (lLanes[0] + lLanes[1] + lLanes[2] + lLanes[3]);
+#endif
+	for (; i < pLength; ++i) {
+		lCount += (pArray[i] >= pLow) && (pArray[i] <= pHigh);
+	}
+	return lCount;
+}
+
+/*
+ * Returns the index of the first occurrence of pValue, -1 if none.
+ */
+
+int32_t indexOfInteger(const int32_t* pArray, int32_t pLength, int32_t pValue) {
+	int32_t i = 0;
+#if defined(STORE_AGGREGATE_AVX2)
+	__m256i lValue = _mm256_set1_epi32(pValue);
+	for (; i + 8 <= pLength; i += 8) {
+		int32_t lMask = _mm256_movemask_epi8(_mm256_cmpeq_epi32(_mm256_loadu_si256((const __m256i*) (pArray + i)), lValue));
+		if (lMask != 0) {
+			return i + (__builtin_ctz(lMask) >> 2);
+		}
+	}
+#elif defined(STORE_AGGREGATE_SSE2)
+	__m128i lValue = _mm_set1_epi32(pValue);
+	for (; i + 4 <= pLength; i += 4) {
+		int32_t lMask = _mm_movemask_epi8(_mm_cmpeq_epi32(_mm_loadu_si128((const __m128i*) (pArray + i)), lValue));
+		if (lMask != 0) {
+			return i + (__builtin_ctz(lMask) >> 2);
+		}
+	}
+#elif defined(STORE_AGGREGATE_NEON)
+	int32x4_t lValue = vdupq_n_s32(pValue);
+	for (; i + 4 <= pLength; i += 4) {
+		if (anyLane(vceqq_s32(vld1q_s32(pArray + i), lValue))) {
+			break;
+		}
+	}
+#endif
+	for (; i < pLength; ++i) {
+		if (pArray[i] == pValue) {
+			return i;
+		}
+	}
+	return -1;
+}
+
+/*
+ * Splits [pLow, pHigh] into pBucketCount buckets of equal width and counts values falling in
+ * each of them, values outside are ignored. Buckets are incremented at data-dependent addresses,
+ * which vector units cannot do, so this kernel stays scalar.
+ */
+
+void histogramIntegers(const int32_t* pArray, int32_t pLength, int32_t pLow, int32_t pHigh, int32_t* pBuckets, int32_t pBucketCount) {
+	memset(pBuckets, 0, pBucketCount * sizeof(int32_t));
+	int64_t lRange = (int64_t) pHigh - pLow + 1;
+	int32_t i;
+	for (i = 0; i < pLength; ++i) {
+		if ((pArray[i] >= pLow) && (pArray[i] <= pHigh)) {
+			++pBuckets[((int64_t) pArray[i] - pLow) * pBucketCount / lRange];
+		}
+	}
+}
@@ -0,0 +1,26 @@
+#ifndef _STOREAGGREGATE_H_
+#define _STOREAGGREGATE_H_
+
+#include <stdint.h>
+
+/*
+ * Reductions and searches run directly over the content of IntegerArray entries. Kernels are
+ * vectorized with whichever instruction set the library is compiled for (AVX2, SSE2 or NEON) and
+ * fall back to plain C otherwise. Vector loads are unaligned: arrays loaded from a store image
+ * are only aligned on 4 bytes.
+ */
+#if defined(__AVX2__)
+#define STORE_AGGREGATE_AVX2
+#elif defined(__SSE2__)
+#define STORE_AGGREGATE_SSE2
+#elif defined(__ARM_NEON__) || defined(__ARM_NEON)
+#define STORE_AGGREGATE_NEON
+#endif
+
+int64_t sumIntegers(const int32_t* pArray, int32_t pLength);
+int32_t minIntegers(const int32_t* pArray, int32_t pLength);
+int32_t maxIntegers(const int32_t* pArray, int32_t pLength);
+int32_t countIntegers(const int32_t* pArray, int32_t pLength, int32_t pLow, int32_t pHigh);
+int32_t indexOfInteger(const int32_t* pArray, int32_t pLength, int32_t pValue);
+void histogramIntegers(const int32_t* pArray, int32_t pLength, int32_t pLow, int32_t pHigh, int32_t* pBuckets, int32_t pBucketCount);
+#endif
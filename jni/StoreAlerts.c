@@ -0,0 +1,129 @@
+#include "StoreAlerts.h"
+#include <errno.h>
+#include <stdlib.h>
+#include <time.h>
+
+/*
+ * pCapacity must be a power of two. Returns 0 if out of memory.
+ */
+
+int32_t initializeAlertRing(StoreAlertRing* pRing, int32_t pCapacity) {
+	pRing->mBuffer = (StoreAlertBuffer*) calloc(1, sizeof(StoreAlertBuffer) + pCapacity * sizeof(StoreAlertRecord));
+	if (pRing->mBuffer == NULL) {
+		return 0;
+	}
+	pRing->mBuffer->mCapacity = pCapacity;
+	pRing->mPublished = 0;
+	pRing->mStopped = 0;
+	pthread_mutex_init(&pRing->mMutex, NULL);
+	pthread_cond_init(&pRing->mCondition, NULL);
+	return 1;
+}
+
+/*
+ * Called by the watcher only, possibly with a shard locked. The head is released once the record is
+ * written, and a slot is only reused once the consumer released the tail past it. Returns 0,
+ * and counts the alert as dropped, if the ring is full.
+ */
+
+int32_t pushAlert(StoreAlertRing* pRing, int64_t pHandle, int32_t pType, int32_t pValue) {
+	StoreAlertBuffer* lBuffer = pRing->mBuffer;
+	uint32_t lHead = (uint32_t) __atomic_load_n(&lBuffer->mHead, __ATOMIC_RELAXED);
+	uint32_t lTail = (uint32_t) __atomic_load_n(&lBuffer->mTail, __ATOMIC_ACQUIRE);
+	if (lHead - lTail >= (uint32_t) lBuffer->mCapacity) {
+		__atomic_store_n(&lBuffer->mDropped, lBuffer->mDropped + 1, __ATOMIC_RELAXED);
+		return 0;
+	}
+
+	StoreAlertRecord* lRecord = &lBuffer->mRecords[lHead & (lBuffer->mCapacity - 1)];
+	lRecord->mHandle = pHandle;
+	lRecord->mType = pType;
+	lRecord->mValue = pValue;
+	__atomic_store_n(&lBuffer->mHead, (int32_t) (lHead + 1), __ATOMIC_RELEASE);
+	return 1;
+}
+
+/*
+ * Wakes the consumer up if records were pushed since last time. Called by the watcher once it
+ * released the shard locks, after a whole scan, so that the consumer gets the scan in one batch.
+ */
+
+void publishAlerts(StoreAlertRing* pRing) {
+	int32_t lHead = __atomic_load_n(&pRing->mBuffer->mHead, __ATOMIC_RELAXED);
+	if (lHead == pRing->mPublished) {
+		return;
+	}
+	pRing->mPublished = lHead;
+	pthread_mutex_lock(&pRing->mMutex);
+	pthread_cond_signal(&pRing->mCondition);
+	pthread_mutex_unlock(&pRing->mMutex);
+}
+
+/*
+ * Called by the consumer, which read every record before pTail and gives their slots back. Blocks
+ * until records follow pTail or pTimeout milliseconds elapse. Returns the number of records from
+ * pTail on, possibly 0, or -1 once the ring is stopped.
+ */
+
+int32_t waitAlerts(StoreAlertRing* pRing, int32_t pTail, int32_t pTimeout) {
+	StoreAlertBuffer* lBuffer = pRing->mBuffer;
+	struct timespec lDeadline;
+	clock_gettime(CLOCK_REALTIME, &lDeadline);
+	lDeadline.tv_sec += pTimeout / 1000;
+	lDeadline.tv_nsec += (pTimeout % 1000) * 1000000L;
+	if (lDeadline.tv_nsec >= 1000000000L) {
+		++lDeadline.tv_sec;
+		lDeadline.tv_nsec -= 1000000000L;
+	}
+
+	pthread_mutex_lock(&pRing->mMutex);
+	__atomic_store_n(&lBuffer->mTail, pTail, __ATOMIC_RELEASE);
+	int lError = 0;
+	while (!pRing->mStopped && (__atomic_load_n(&lBuffer->mHead, __ATOMIC_ACQUIRE) == pTail) && (lError != ETIMEDOUT)) {
+		lError = pthread_cond_timedwait(&pRing->mCondition, &pRing->mMutex, &lDeadline);
+	}
+	int32_t lCount = pRing->mStopped ? -1
+		: (int32_t) ((uint32_t) __atomic_load_n(&lBuffer->mHead, __ATOMIC_ACQUIRE) - (uint32_t) pTail);
+	pthread_mutex_unlock(&pRing->mMutex);
+	return lCount;
+}
+
+/*
+ * Wakes the consumer up for good: waitAlerts() returns -1 from now on.
+ */
+
+void stopAlertRing(StoreAlertRing* pRing) {
+	if (pRing->mBuffer == NULL) {
+		return;
+	}
+	pthread_mutex_lock(&pRing->mMutex);
+	pRing->mStopped = 1;
+	pthread_cond_broadcast(&pRing->mCondition);
+	pthread_mutex_unlock(&pRing->mMutex);
+}
+
+/*
+ * Neither the watcher nor the consumer may use the ring anymore.
+ */
+
+void releaseAlertRing(StoreAlertRing* pRing) {
+	if (pRing->mBuffer == NULL) {
+		return;
+	}
+	free(pRing->mBuffer);
+	pRing->mBuffer = NULL;
+	pthread_cond_destroy(&pRing->mCondition);
+	pthread_mutex_destroy(&pRing->mMutex);
+}
+
+/*
+ * Direct buffer over the whole ring, or NULL if the ring could not be allocated.
+ */
+
+jobject newAlertBuffer(JNIEnv* pEnv, StoreAlertRing* pRing) {
+	if (pRing->mBuffer == NULL) {
+		return NULL;
+	}
+	return (*pEnv)->NewDirectByteBuffer(pEnv, pRing->mBuffer,
+		sizeof(StoreAlertBuffer) + pRing->mBuffer->mCapacity * sizeof(StoreAlertRecord));
+}
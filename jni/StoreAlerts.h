@@ -0,0 +1,56 @@
+#ifndef _STOREALERTS_H_
+#define _STOREALERTS_H_
+
+#include "jni.h"
+#include <stdint.h>
+#include <pthread.h>
+
+/*
+ * Alerts go from the watcher to Java through a single-producer single-consumer ring in native
+ * memory, which Java reads through a direct ByteBuffer. The watcher appends records without
+ * blocking and without calling into Java, dropping alerts when the ring is full. Java drains the
+ * ring in batches: waitAlerts() hands back the records Java read, then blocks until new ones are
+ * published. The mutex only serves to sleep and wake the consumer, records never wait on it.
+ *
+ * The layout is shared with Store.java: a StoreAlertBuffer header of four int32, then mCapacity
+ * records of 16 bytes, all in native byte order.
+ */
+#define STORE_ALERT_CAPACITY 1024
+
+typedef struct {
+	//Handle of the entry, as resolveKey() returns it
+	int64_t mHandle;
+	//StoreType of the value
+	int32_t mType;
+	//Integer or color value, entry version for a string
+	int32_t mValue;
+} StoreAlertRecord;
+
+typedef struct {
+	//Records ever written and read, free-running, the ring holding mHead - mTail records
+	volatile int32_t mHead;
+	volatile int32_t mTail;
+	//Power of two
+	int32_t mCapacity;
+	//Alerts dropped because the ring was full
+	volatile int32_t mDropped;
+	StoreAlertRecord mRecords[];
+} StoreAlertBuffer;
+
+typedef struct {
+	StoreAlertBuffer* mBuffer;
+	//Head when the consumer was last woken up
+	int32_t mPublished;
+	int32_t mStopped;
+	pthread_mutex_t mMutex;
+	pthread_cond_t mCondition;
+} StoreAlertRing;
+
+int32_t initializeAlertRing(StoreAlertRing* pRing, int32_t pCapacity);
+int32_t pushAlert(StoreAlertRing* pRing, int64_t pHandle, int32_t pType, int32_t pValue);
+void publishAlerts(StoreAlertRing* pRing);
+int32_t waitAlerts(StoreAlertRing* pRing, int32_t pTail, int32_t pTimeout);
+void stopAlertRing(StoreAlertRing* pRing);
+void releaseAlertRing(StoreAlertRing* pRing);
+jobject newAlertBuffer(JNIEnv* pEnv, StoreAlertRing* pRing);
+#endif
@@ -0,0 +1,90 @@
+#include "StoreArena.h"
+#include <stdlib.h>
+#include <string.h>
+
+size_t alignArenaSize(size_t pSize);
+
+/* Make sure the current block has room for pSize more bytes, otherwise start a new block. The
+ * remaining space of the previous block is simply lost until next compaction.
+ */
+
+int32_t reserveArena(StoreArena* pArena, size_t pSize) {
+	StoreArenaBlock* lBlock = pArena->mBlocks;
+	if ((lBlock != NULL) && (lBlock->mSize - lBlock->mUsed >= pSize)) {
+		return 1;
+	}
+
+	size_t lSize = (pSize > STORE_ARENA_BLOCK_SIZE) ? pSize : STORE_ARENA_BLOCK_SIZE;
+	lBlock = (StoreArenaBlock*) malloc(sizeof(StoreArenaBlock) + lSize);
+	if (lBlock == NULL) {
+		return 0;
+	}
+	lBlock->mNext = pArena->mBlocks;
+	lBlock->mSize = lSize;
+	lBlock->mUsed = 0;
+	pArena->mBlocks = lBlock;
+	pArena->mReservedBytes += lSize;
+	return 1;
+}
+
+size_t alignArenaSize(size_t pSize) {
+	return (pSize + STORE_ARENA_ALIGNMENT - 1) & ~(size_t) (STORE_ARENA_ALIGNMENT - 1);
+}
+
+void* allocateArena(StoreArena* pArena, size_t pSize) {
+	size_t lSize = alignArenaSize(pSize);
+	if (!reserveArena(pArena, lSize)) {
+		return NULL;
+	}
+
+	StoreArenaBlock* lBlock = pArena->mBlocks;
+	void* lData = lBlock->mData + lBlock->mUsed;
+	lBlock->mUsed += lSize;
+	pArena->mUsedBytes += lSize;
+	pArena->mLiveBytes += lSize;
+	return lData;
+}
+
+void* copyArenaData(StoreArena* pArena, const void* pData, size_t pSize) {
+	void* lData = allocateArena(pArena, pSize);
+	if (lData != NULL) {
+		memcpy(lData, pData, pSize);
+	}
+	return lData;
+}
+
+char* copyArenaString(StoreArena* pArena, const char* pString) {
+	return (char*) copyArenaData(pArena, pString, strlen(pString) + 1);
+}
+
+void freeArenaData(StoreArena* pArena, size_t pSize) {
+	pArena->mLiveBytes -= alignArenaSize(pSize);
+}
+
+void freeArenaString(StoreArena* pArena, const char* pString) {
+	if (pString != NULL) {
+		freeArenaData(pArena, strlen(pString) + 1);
+	}
+}
+
+int32_t isArenaFragmented(StoreArena* pArena) {
+	return (pArena->mUsedBytes >= STORE_ARENA_COMPACT_MIN)
+		&& (pArena->mLiveBytes * STORE_ARENA_COMPACT_RATIO < pArena->mUsedBytes);
+}
+
+/* All strings go away at once, whatever their number.
+ *
+ */
+
+void releaseArena(StoreArena* pArena) {
+	StoreArenaBlock* lBlock = pArena->mBlocks;
+	while (lBlock != NULL) {
+		StoreArenaBlock* lNext = lBlock->mNext;
+		free(lBlock);
+		lBlock = lNext;
+	}
+	pArena->mBlocks = NULL;
+	pArena->mLiveBytes = 0;
+	pArena->mUsedBytes = 0;
+	pArena->mReservedBytes = 0;
+}
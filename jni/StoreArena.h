@@ -0,0 +1,47 @@
+#ifndef _STOREARENA_H_
+#define _STOREARENA_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+ * Bump allocator for keys and string values. Memory is carved out of large blocks and never freed
+ * individually: releasing a string only decreases the count of live bytes. Once too much of the
+ * used memory is dead, the owner compacts the arena by copying live strings into a fresh one.
+ *
+ * Sizes are rounded up to STORE_ARENA_ALIGNMENT so that UTF-16 values stay aligned.
+ */
+#define STORE_ARENA_ALIGNMENT 2
+#define STORE_ARENA_BLOCK_SIZE 16384
+//Compaction is considered once that much memory has been used...
+#define STORE_ARENA_COMPACT_MIN (4 * STORE_ARENA_BLOCK_SIZE)
+//...and happens when less than 1/STORE_ARENA_COMPACT_RATIO of it is live
+#define STORE_ARENA_COMPACT_RATIO 2
+
+typedef struct StoreArenaBlock {
+	struct StoreArenaBlock* mNext;
+	size_t mSize;
+	size_t mUsed;
+	char mData[];
+} StoreArenaBlock;
+
+typedef struct {
+	StoreArenaBlock* mBlocks;
+	//Bytes held by live strings
+	size_t mLiveBytes;
+	//Bytes handed out since last compaction, live or dead
+	size_t mUsedBytes;
+	//Bytes allocated for blocks
+	size_t mReservedBytes;
+	int32_t mCompactions;
+} StoreArena;
+
+int32_t reserveArena(StoreArena* pArena, size_t pSize);
+void* allocateArena(StoreArena* pArena, size_t pSize);
+void* copyArenaData(StoreArena* pArena, const void* pData, size_t pSize);
+char* copyArenaString(StoreArena* pArena, const char* pString);
+void freeArenaData(StoreArena* pArena, size_t pSize);
+void freeArenaString(StoreArena* pArena, const char* pString);
+int32_t isArenaFragmented(StoreArena* pArena);
+void releaseArena(StoreArena* pArena);
+#endif
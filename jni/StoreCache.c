@@ -0,0 +1,82 @@
+#include "StoreCache.h"
+#include <string.h>
+
+StoreCache gStoreCache;
+
+int32_t cacheClass(JNIEnv* pEnv, const char* pName, jclass* pClass);
+void deleteClass(JNIEnv* pEnv, jclass* pClass);
+
+/*
+ * Called from JNI_OnLoad(), on the thread running System.loadLibrary(). That thread sees the
+ * application class loader, so FindClass() resolves application classes here, which it would not
+ * do from a native thread attached later on. Error path and getters then never pay a lookup.
+ */
+
+int32_t initializeCache(JNIEnv* pEnv) {
+	memset(&gStoreCache, 0, sizeof(StoreCache));
+
+	//Cache classes
+	if (!cacheClass(pEnv, "za/co/technodev/javajni/Store", &gStoreCache.ClassStore)
+	 || !cacheClass(pEnv, "za/co/technodev/javajni/Color", &gStoreCache.ClassColor)
+	 || !cacheClass(pEnv, "java/lang/String", &gStoreCache.ClassString)
+	 || !cacheClass(pEnv, "za/co/technodev/exception/InvalidTypeException", &gStoreCache.ClassInvalidTypeException)
+	 || !cacheClass(pEnv, "za/co/technodev/exception/NotExistingKeyException", &gStoreCache.ClassNotExistingKeyException)
+	 || !cacheClass(pEnv, "za/co/technodev/exception/StoreFullException", &gStoreCache.ClassStoreFullException)
+	 || !cacheClass(pEnv, "java/io/IOException", &gStoreCache.ClassIOException)
+	 || !cacheClass(pEnv, "java/lang/IllegalStateException", &gStoreCache.ClassIllegalStateException)
+	 || !cacheClass(pEnv, "java/lang/ArrayIndexOutOfBoundsException", &gStoreCache.ClassIndexOutOfBoundsException)) {
+		goto ERROR;
+	}
+
+	//Cache Java methods
+	gStoreCache.ConstructorColor = (*pEnv)->GetMethodID(pEnv, gStoreCache.ClassColor, "<init>", "(I)V");
+	if (gStoreCache.ConstructorColor == NULL) {
+		goto ERROR;
+	}
+
+	//Cache Java fields
+	gStoreCache.FieldColor = (*pEnv)->GetFieldID(pEnv, gStoreCache.ClassColor, "mColor", "I");
+	if (gStoreCache.FieldColor == NULL) {
+		goto ERROR;
+	}
+
+	gStoreCache.FieldNativeStore = (*pEnv)->GetFieldID(pEnv, gStoreCache.ClassStore, "mNativeStore", "J");
+	if (gStoreCache.FieldNativeStore == NULL) {
+		goto ERROR;
+	}
+	return 1;
+
+ERROR:
+	releaseCache(pEnv);
+	return 0;
+}
+
+void releaseCache(JNIEnv* pEnv) {
+	deleteClass(pEnv, &gStoreCache.ClassStore);
+	deleteClass(pEnv, &gStoreCache.ClassColor);
+	deleteClass(pEnv, &gStoreCache.ClassString);
+	deleteClass(pEnv, &gStoreCache.ClassInvalidTypeException);
+	deleteClass(pEnv, &gStoreCache.ClassNotExistingKeyException);
+	deleteClass(pEnv, &gStoreCache.ClassStoreFullException);
+	deleteClass(pEnv, &gStoreCache.ClassIOException);
+	deleteClass(pEnv, &gStoreCache.ClassIllegalStateException);
+	deleteClass(pEnv, &gStoreCache.ClassIndexOutOfBoundsException);
+	memset(&gStoreCache, 0, sizeof(StoreCache));
+}
+
+int32_t cacheClass(JNIEnv* pEnv, const char* pName, jclass* pClass) {
+	jclass lClass = (*pEnv)->FindClass(pEnv, pName);
+	if (lClass == NULL) {
+		return 0;
+	}
+	*pClass = (jclass) (*pEnv)->NewGlobalRef(pEnv, lClass);
+	(*pEnv)->DeleteLocalRef(pEnv, lClass);
+	return (*pClass != NULL);
+}
+
+void deleteClass(JNIEnv* pEnv, jclass* pClass) {
+	if (*pClass != NULL) {
+		(*pEnv)->DeleteGlobalRef(pEnv, *pClass);
+		*pClass = NULL;
+	}
+}
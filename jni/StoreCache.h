@@ -0,0 +1,34 @@
+#ifndef _STORECACHE_H_
+#define _STORECACHE_H_
+
+#include "jni.h"
+#include <stdint.h>
+
+/*
+ * Classes, methods and fields used by native code, looked up once when the library is loaded.
+ * Classes are global references, method and field IDs remain valid as long as their class is
+ * loaded, which the global references guarantee.
+ */
+typedef struct {
+	//Classes
+	jclass ClassStore;
+	jclass ClassColor;
+	jclass ClassString;
+	jclass ClassInvalidTypeException;
+	jclass ClassNotExistingKeyException;
+	jclass ClassStoreFullException;
+	jclass ClassIOException;
+	jclass ClassIllegalStateException;
+	jclass ClassIndexOutOfBoundsException;
+	//Methods
+	jmethodID ConstructorColor;
+	//Fields
+	jfieldID FieldColor;
+	jfieldID FieldNativeStore;
+} StoreCache;
+
+extern StoreCache gStoreCache;
+
+int32_t initializeCache(JNIEnv* pEnv);
+void releaseCache(JNIEnv* pEnv);
+#endif
@@ -0,0 +1,306 @@
+#include "StoreExport.h"
+#include <stdlib.h>
+#include <string.h>
+
+typedef struct {
+	const char* mKey;
+	int32_t mKeyLength;
+	StoreType mType;
+	//Integer or color value, length of a string or an array otherwise
+	int32_t mValue;
+	//Characters or elements, in the export
+	const char* mData;
+} StoreExportRecord;
+
+int64_t measureStoreExport(Store* pStore, int32_t* pCount);
+char* exportStore(Store* pStore, char* pData);
+char* writeExportInt(char* pData, int32_t pValue);
+const char* readExportInt(const char* pData, const char* pEnd, int32_t* pValue);
+const char* readExportRecord(const char* pData, const char* pEnd, StoreExportRecord* pRecord);
+int32_t importRecord(JNIEnv* pEnv, Store* pStore, const StoreExportRecord* pRecord, uint32_t pHash);
+
+/*
+ * Size an export of the store would have now, header included. Each shard is measured under its
+ * read lock, but not all shards at once.
+ */
+
+int64_t measureExport(StoreInstance* pInstance) {
+	int64_t lSize = sizeof(StoreExportHeader);
+	int32_t lCount;
+	int32_t i;
+	for (i = 0; i < pInstance->mShardCount; ++i) {
+		lockStoreRead(&pInstance->mShards[i]);
+		lSize += measureStoreExport(&pInstance->mShards[i], &lCount);
+		unlockStore(&pInstance->mShards[i]);
+	}
+	return lSize;
+}
+
+/*
+ * All shards are read locked for the whole export, which is therefore consistent across shards,
+ * and the store is measured again under the locks. Returns the size of the export, which is only
+ * written if it fits in pCapacity bytes.
+ */
+
+int64_t exportInstance(StoreInstance* pInstance, char* pData, int64_t pCapacity) {
+	lockInstance(pInstance, 0);
+	StoreExportHeader lHeader;
+	int64_t lSize = sizeof(StoreExportHeader);
+	lHeader.mCount = 0;
+	int32_t i;
+	for (i = 0; i < pInstance->mShardCount; ++i) {
+		int32_t lCount;
+		lSize += measureStoreExport(&pInstance->mShards[i], &lCount);
+		lHeader.mCount += lCount;
+	}
+
+	if ((lSize <= pCapacity) && (lSize <= UINT32_MAX)) {
+		lHeader.mMagic = STORE_EXPORT_MAGIC;
+		lHeader.mVersion = STORE_EXPORT_VERSION;
+		lHeader.mSize = (uint32_t) lSize;
+		memcpy(pData, &lHeader, sizeof(StoreExportHeader));
+		char* lData = pData + sizeof(StoreExportHeader);
+		for (i = 0; i < pInstance->mShardCount; ++i) {
+			lData = exportStore(&pInstance->mShards[i], lData);
+		}
+	}
+	unlockInstance(pInstance);
+	return lSize;
+}
+
+int64_t measureStoreExport(Store* pStore, int32_t* pCount) {
+	int64_t lSize = 0;
+	*pCount = 0;
+	int32_t i;
+	for (i = 0; i < pStore->mLength; ++i) {
+		StoreEntry* lEntry = getEntry(pStore, i);
+		switch (lEntry->mType) {
+		case StoreType_Integer:
+		case StoreType_Color:
+			break;
+		case StoreType_String:
+			lSize += (int64_t) lEntry->mLength * sizeof(jchar);
+			break;
+		case StoreType_IntegerArray:
+		case StoreType_ColorArray:
+			lSize += (int64_t) lEntry->mLength * sizeof(int32_t);
+			break;
+		default:
+			continue;
+		}
+		//Key length, key and its NUL, type, then value or length
+		lSize += 3 * sizeof(int32_t) + strlen(lEntry->mKey) + 1;
+		++*pCount;
+	}
+	return lSize;
+}
+
+char* exportStore(Store* pStore, char* pData) {
+	int32_t i;
+	for (i = 0; i < pStore->mLength; ++i) {
+		StoreEntry* lEntry = getEntry(pStore, i);
+		if ((lEntry->mType == StoreType_None) || (lEntry->mType == StoreType_Removed)) {
+			continue;
+		}
+
+		size_t lKeyLength = strlen(lEntry->mKey);
+		pData = writeExportInt(pData, (int32_t) lKeyLength);
+		memcpy(pData, lEntry->mKey, lKeyLength + 1);
+		pData += lKeyLength + 1;
+		pData = writeExportInt(pData, lEntry->mType);
+		switch (lEntry->mType) {
+		case StoreType_Integer:
+			pData = writeExportInt(pData, lEntry->mValue.mInteger);
+			break;
+		case StoreType_Color:
+			pData = writeExportInt(pData, lEntry->mValue.mColor);
+			break;
+		case StoreType_String:
+			pData = writeExportInt(pData, lEntry->mLength);
+			memcpy(pData, lEntry->mValue.mString, lEntry->mLength * sizeof(jchar));
+			pData += lEntry->mLength * sizeof(jchar);
+			break;
+		case StoreType_IntegerArray:
+		case StoreType_ColorArray:
+			pData = writeExportInt(pData, lEntry->mLength);
+			memcpy(pData, lEntry->mValue.mIntegerArray, lEntry->mLength * sizeof(int32_t));
+			pData += lEntry->mLength * sizeof(int32_t);
+			break;
+		default:
+			break;
+		}
+	}
+	return pData;
+}
+
+/*
+ * Records are not aligned, integers are copied rather than dereferenced.
+ */
+
+char* writeExportInt(char* pData, int32_t pValue) {
+	memcpy(pData, &pValue, sizeof(int32_t));
+	return pData + sizeof(int32_t);
+}
+
+const char* readExportInt(const char* pData, const char* pEnd, int32_t* pValue) {
+	if ((pData == NULL) || (pEnd - pData < (ptrdiff_t) sizeof(int32_t))) {
+		return NULL;
+	}
+	memcpy(pValue, pData, sizeof(int32_t));
+	return pData + sizeof(int32_t);
+}
+
+/*
+ * Keys of an export are set, or overwritten, in the store. Other keys are kept. The whole export is
+ * checked first, so that a malformed one changes nothing, and keys are counted per shard. Then all
+ * shards are locked for writing and sized once for their new keys before they are inserted. Returns
+ * the size of the export, or -1 if the data is not a valid export. pStatus is STORE_STATUS_OK, or
+ * STORE_STATUS_STORE_FULL if the store got full, in which case keys imported until then are kept.
+ */
+
+int64_t importInstance(JNIEnv* pEnv, StoreInstance* pInstance, const char* pData, int64_t pSize, int32_t* pStatus) {
+	StoreExportHeader lHeader;
+	if (pSize < (int64_t) sizeof(StoreExportHeader)) {
+		return -1;
+	}
+	memcpy(&lHeader, pData, sizeof(StoreExportHeader));
+	if ((lHeader.mMagic != STORE_EXPORT_MAGIC) || (lHeader.mVersion != STORE_EXPORT_VERSION)
+	 || (lHeader.mCount < 0) || (lHeader.mSize < sizeof(StoreExportHeader)) || (lHeader.mSize > pSize)) {
+		return -1;
+	}
+
+	const char* lEnd = pData + lHeader.mSize;
+	int32_t lCounts[STORE_MAX_SHARDS] = { 0 };
+	size_t lSizes[STORE_MAX_SHARDS] = { 0 };
+	StoreExportRecord lRecord;
+	const char* lRecordData = pData + sizeof(StoreExportHeader);
+	int32_t i;
+	for (i = 0; i < lHeader.mCount; ++i) {
+		lRecordData = readExportRecord(lRecordData, lEnd, &lRecord);
+		if (lRecordData == NULL) {
+			return -1;
+		}
+		int32_t lShard = getKeyShard(pInstance, hashKey(lRecord.mKey)) - pInstance->mShards;
+		++lCounts[lShard];
+		//Arena rounds each allocation up to 2 bytes
+		lSizes[lShard] += lRecord.mKeyLength + 2;
+		if (lRecord.mType == StoreType_String) {
+			lSizes[lShard] += lRecord.mValue * sizeof(jchar);
+		}
+	}
+	if (lRecordData != lEnd) {
+		return -1;
+	}
+
+	lockInstance(pInstance, 1);
+	for (i = 0; i < pInstance->mShardCount; ++i) {
+		if (lCounts[i] > 0) {
+			reserveStore(&pInstance->mShards[i], lCounts[i], lSizes[i]);
+		}
+	}
+	*pStatus = STORE_STATUS_OK;
+	lRecordData = pData + sizeof(StoreExportHeader);
+	for (i = 0; i < lHeader.mCount; ++i) {
+		lRecordData = readExportRecord(lRecordData, lEnd, &lRecord);
+		uint32_t lHash = hashKey(lRecord.mKey);
+		if (!importRecord(pEnv, getKeyShard(pInstance, lHash), &lRecord, lHash)) {
+			*pStatus = STORE_STATUS_STORE_FULL;
+			break;
+		}
+	}
+	unlockInstance(pInstance);
+	return lHeader.mSize;
+}
+
+/*
+ * Returns the next record, or NULL if the record does not fit before pEnd or is not valid. Keys
+ * must be NUL-terminated right at their length, so that they can be used in place.
+ */
+
+const char* readExportRecord(const char* pData, const char* pEnd, StoreExportRecord* pRecord) {
+	int32_t lType;
+	pData = readExportInt(pData, pEnd, &pRecord->mKeyLength);
+	if ((pData == NULL) || (pRecord->mKeyLength < 0) || (pEnd - pData <= pRecord->mKeyLength)
+	 || (pData[pRecord->mKeyLength] != '\0') || (memchr(pData, '\0', pRecord->mKeyLength) != NULL)) {
+		return NULL;
+	}
+	pRecord->mKey = pData;
+	pData = readExportInt(pData + pRecord->mKeyLength + 1, pEnd, &lType);
+	pData = readExportInt(pData, pEnd, &pRecord->mValue);
+	if (pData == NULL) {
+		return NULL;
+	}
+	pRecord->mType = (StoreType) lType;
+	pRecord->mData = pData;
+
+	switch (lType) {
+	case StoreType_Integer:
+	case StoreType_Color:
+		return pData;
+	case StoreType_String:
+		if ((pRecord->mValue < 0) || ((int64_t) (pEnd - pData) < (int64_t) pRecord->mValue * (int64_t) sizeof(jchar))) {
+			return NULL;
+		}
+		return pData + pRecord->mValue * sizeof(jchar);
+	case StoreType_IntegerArray:
+	case StoreType_ColorArray:
+		if ((pRecord->mValue < 0) || (pRecord->mValue > STORE_MAX_ARRAY_LENGTH)
+		 || ((int64_t) (pEnd - pData) < (int64_t) pRecord->mValue * (int64_t) sizeof(int32_t))) {
+			return NULL;
+		}
+		return pData + pRecord->mValue * sizeof(int32_t);
+	default:
+		return NULL;
+	}
+}
+
+/*
+ * Same as a setter, with the shard locked for writing. Returns 0 if the store is full or out of
+ * memory.
+ */
+
+int32_t importRecord(JNIEnv* pEnv, Store* pStore, const StoreExportRecord* pRecord, uint32_t pHash) {
+	int32_t lIndex = reserveKey(pStore, pRecord->mKey, pHash);
+	if (lIndex == STORE_EMPTY_SLOT) {
+		return 0;
+	}
+	StoreEntry* lEntry = getEntry(pStore, lIndex);
+	releaseEntryValue(pEnv, pStore, lEntry);
+	//Previous value is dead already, it must not be copied if the arena gets compacted
+	lEntry->mType = StoreType_None;
+	lEntry->mLength = 0;
+	lEntry->mCapacity = 0;
+
+	switch (pRecord->mType) {
+	case StoreType_Integer:
+		lEntry->mValue.mInteger = pRecord->mValue;
+		break;
+	case StoreType_Color:
+		lEntry->mValue.mColor = pRecord->mValue;
+		break;
+	case StoreType_String:
+		lEntry->mValue.mString = allocateChars(pStore, pRecord->mValue);
+		if (lEntry->mValue.mString == NULL) {
+			touchEntry(pStore, lEntry);
+			return 0;
+		}
+		memcpy(lEntry->mValue.mString, pRecord->mData, pRecord->mValue * sizeof(jchar));
+		lEntry->mLength = pRecord->mValue;
+		lEntry->mCapacity = pRecord->mValue;
+		break;
+	default:
+		lEntry->mValue.mIntegerArray = (int32_t*) malloc(pRecord->mValue * sizeof(int32_t));
+		if ((lEntry->mValue.mIntegerArray == NULL) && (pRecord->mValue > 0)) {
+			touchEntry(pStore, lEntry);
+			return 0;
+		}
+		memcpy(lEntry->mValue.mIntegerArray, pRecord->mData, pRecord->mValue * sizeof(int32_t));
+		lEntry->mLength = pRecord->mValue;
+		lEntry->mCapacity = pRecord->mValue;
+		break;
+	}
+	lEntry->mType = pRecord->mType;
+	//Once the value is complete, for the version history to record it
+	touchEntry(pStore, lEntry);
+	return 1;
+}
@@ -0,0 +1,32 @@
+#ifndef _STOREEXPORT_H_
+#define _STOREEXPORT_H_
+
+#include "jni.h"
+#include "StoreInstance.h"
+#include <stdint.h>
+
+/*
+ * An export holds every key of a store with its value, in native byte order and without padding:
+ * - a header,
+ * - one record per key: key length in bytes, key in modified UTF-8 followed by a NUL, type (see
+ *   StoreType), then an integer or color value, or the length of a string in characters followed
+ *   by its UTF-16 characters, or the length of an array followed by its elements.
+ *
+ * Unlike a store image, an export does not depend on the shard count nor on the layout of the
+ * store, so it can be imported into any store. Keys reserved without a value are not exported.
+ */
+#define STORE_EXPORT_MAGIC 0x4A535458u
+#define STORE_EXPORT_VERSION 1
+
+typedef struct {
+	uint32_t mMagic;
+	uint32_t mVersion;
+	int32_t mCount;
+	//Whole export, header included
+	uint32_t mSize;
+} StoreExportHeader;
+
+int64_t measureExport(StoreInstance* pInstance);
+int64_t exportInstance(StoreInstance* pInstance, char* pData, int64_t pCapacity);
+int64_t importInstance(JNIEnv* pEnv, StoreInstance* pInstance, const char* pData, int64_t pSize, int32_t* pStatus);
+#endif
@@ -0,0 +1,499 @@
+#include "StoreHistory.h"
+#include <sched.h>
+#include <stdlib.h>
+#include <string.h>
+
+StoreHistoryTable* createHistoryTable(int32_t pCapacity);
+int32_t findHistorySlot(StoreHistoryTable* pTable, const char* pKey, uint32_t pHash);
+StoreHistoryKey* addHistoryKey(StoreHistory* pHistory, StoreEntry* pEntry);
+int32_t rebuildHistoryTable(StoreHistory* pHistory);
+int32_t isHistoryKeyDropped(StoreHistoryKey* pKey, int64_t pOldest);
+void reclaimRetired(StoreHistory* pHistory);
+void releaseRetired(StoreHistoryRetired* pRetired);
+void releaseHistoryKey(StoreHistoryKey* pKey);
+StoreVersion* createVersion(StoreVersion* pHead, StoreEntry* pEntry, int32_t pKept);
+StoreVersionArray* shareVersionArray(StoreVersion* pHead, StoreEntry* pEntry, int32_t pKept);
+void pushVersion(StoreHistory* pHistory, StoreHistoryKey* pKey, StoreVersion* pVersion);
+void trimVersions(StoreVersion* pVersion, int64_t pOldest);
+void releaseVersions(StoreVersion* pVersion);
+int64_t getOldestPin(StoreHistory* pHistory, int64_t pStamp);
+void loseHistory(StoreHistory* pHistory);
+
+StoreHistory* createHistory(void) {
+	StoreHistory* lHistory = (StoreHistory*) calloc(1, sizeof(StoreHistory));
+	if (lHistory == NULL) {
+		return NULL;
+	}
+	lHistory->mTable = createHistoryTable(STORE_HISTORY_MIN_KEYS);
+	if (lHistory->mTable == NULL) {
+		free(lHistory);
+		return NULL;
+	}
+	pthread_mutex_init(&lHistory->mTableLock, NULL);
+	lHistory->mLostStamp = INT64_MAX;
+	lHistory->mReferences = 1;
+	return lHistory;
+}
+
+void retainHistory(StoreHistory* pHistory) {
+	__sync_fetch_and_add(&pHistory->mReferences, 1);
+}
+
+/*
+ * The last reference is released by the instance or a snapshot once nothing writes nor reads the
+ * history anymore, everything is freed at once.
+ */
+
+void releaseHistory(StoreHistory* pHistory) {
+	if (__sync_sub_and_fetch(&pHistory->mReferences, 1) > 0) {
+		return;
+	}
+	int32_t i;
+	for (i = 0; i < pHistory->mTable->mCapacity; ++i) {
+		if (pHistory->mTable->mKeys[i] != NULL) {
+			releaseHistoryKey(pHistory->mTable->mKeys[i]);
+		}
+	}
+	free(pHistory->mTable);
+	while (pHistory->mRetired != NULL) {
+		StoreHistoryRetired* lRetired = pHistory->mRetired;
+		pHistory->mRetired = lRetired->mNext;
+		releaseRetired(lRetired);
+	}
+	while (pHistory->mPins != NULL) {
+		StoreHistoryPin* lPin = pHistory->mPins;
+		pHistory->mPins = lPin->mNext;
+		free(lPin);
+	}
+	pthread_mutex_destroy(&pHistory->mTableLock);
+	free(pHistory);
+}
+
+/*
+ * Records the value of pEntry, just written with the shard locked for writing, or for reading by
+ * the watcher which is then its only writer. The first pKept elements of an IntegerArray are those
+ * of the previous version, appended to. Keys are looked up once, then cached in the entry until it
+ * is removed. A key without a value which was never recorded does not need to be: snapshots do not
+ * see it either way.
+ */
+
+void publishEntry(StoreHistory* pHistory, StoreEntry* pEntry, int32_t pKept) {
+	StoreHistoryKey* lKey = pEntry->mHistoryKey;
+	StoreVersion* lVersion = NULL;
+	if (lKey != NULL) {
+		if ((lVersion = createVersion(lKey->mHead, pEntry, pKept)) != NULL) {
+			pushVersion(pHistory, lKey, lVersion);
+		}
+	} else if ((pEntry->mType == StoreType_None) || (pEntry->mType == StoreType_Removed)) {
+		return;
+	} else {
+		//Under the table lock, so that the key is not dropped by a rebuild before it is pushed to
+		pthread_mutex_lock(&pHistory->mTableLock);
+		lKey = addHistoryKey(pHistory, pEntry);
+		if ((lKey != NULL) && ((lVersion = createVersion(lKey->mHead, pEntry, 0)) != NULL)) {
+			pushVersion(pHistory, lKey, lVersion);
+			lKey->mRemoved = 0;
+			pEntry->mHistoryKey = lKey;
+		}
+		pthread_mutex_unlock(&pHistory->mTableLock);
+	}
+	if (lVersion == NULL) {
+		loseHistory(pHistory);
+	}
+
+	//The entry may be reused for another key
+	if (pEntry->mType == StoreType_Removed) {
+		pEntry->mHistoryKey = NULL;
+		if (lVersion != NULL) {
+			__atomic_store_n(&lKey->mRemoved, 1, __ATOMIC_RELEASE);
+		}
+	}
+}
+
+/*
+ * Records every value of a store just loaded, before anything else writes to it.
+ */
+
+void publishStore(StoreHistory* pHistory, Store* pStore) {
+	int32_t i;
+	for (i = 0; i < pStore->mLength; ++i) {
+		publishEntry(pHistory, getEntry(pStore, i), 0);
+	}
+}
+
+/*
+ * The pin is announced with the clock first read, then moved to the clock read again. A writer
+ * which did not see the announcement had stamped its version before the second read, so it never
+ * frees a version the snapshot reads. Free records are reused, and a new one pushed if none is
+ * left. Returns NULL if out of memory.
+ */
+
+StoreHistoryPin* pinHistory(StoreHistory* pHistory) {
+	int64_t lStamp = __atomic_load_n(&pHistory->mClock, __ATOMIC_SEQ_CST);
+	StoreHistoryPin* lPin;
+	for (lPin = __atomic_load_n(&pHistory->mPins, __ATOMIC_ACQUIRE); lPin != NULL; lPin = lPin->mNext) {
+		int64_t lFree = STORE_PENDING_STAMP;
+		if (__atomic_compare_exchange_n(&lPin->mStamp, &lFree, lStamp, 0, __ATOMIC_SEQ_CST, __ATOMIC_RELAXED)) {
+			break;
+		}
+	}
+	if (lPin == NULL) {
+		if ((lPin = (StoreHistoryPin*) malloc(sizeof(StoreHistoryPin))) == NULL) {
+			return NULL;
+		}
+		lPin->mStamp = lStamp;
+		lPin->mNext = __atomic_load_n(&pHistory->mPins, __ATOMIC_RELAXED);
+		while (!__atomic_compare_exchange_n(&pHistory->mPins, &lPin->mNext, lPin, 0, __ATOMIC_SEQ_CST, __ATOMIC_RELAXED));
+	}
+	__atomic_store_n(&lPin->mStamp, __atomic_load_n(&pHistory->mClock, __ATOMIC_SEQ_CST), __ATOMIC_SEQ_CST);
+	return lPin;
+}
+
+void unpinHistory(StoreHistoryPin* pPin) {
+	__atomic_store_n(&pPin->mStamp, STORE_PENDING_STAMP, __ATOMIC_SEQ_CST);
+}
+
+/*
+ * Whether a write which could not be recorded, for lack of memory, makes the history wrong as seen
+ * from pStamp.
+ */
+
+int32_t isHistoryLost(StoreHistory* pHistory, int64_t pStamp) {
+	return pStamp >= __atomic_load_n(&pHistory->mLostStamp, __ATOMIC_ACQUIRE);
+}
+
+void loseHistory(StoreHistory* pHistory) {
+	int64_t lStamp = __atomic_add_fetch(&pHistory->mClock, 1, __ATOMIC_SEQ_CST);
+	int64_t lLostStamp = __atomic_load_n(&pHistory->mLostStamp, __ATOMIC_RELAXED);
+	while ((lStamp < lLostStamp)
+	 && !__atomic_compare_exchange_n(&pHistory->mLostStamp, &lLostStamp, lStamp, 0, __ATOMIC_RELEASE, __ATOMIC_RELAXED));
+}
+
+/*
+ * Read without lock: slots only ever go from NULL to a key, and a replaced table is only freed once
+ * the pins which may still read it are gone. Returns NULL if pKey was never written.
+ */
+
+StoreHistoryKey* findHistoryKey(StoreHistory* pHistory, const char* pKey) {
+	uint32_t lHash = hashKey(pKey);
+	StoreHistoryTable* lTable = __atomic_load_n(&pHistory->mTable, __ATOMIC_ACQUIRE);
+	int32_t lSlot = lHash & (lTable->mCapacity - 1);
+	StoreHistoryKey* lKey;
+	while ((lKey = __atomic_load_n(&lTable->mKeys[lSlot], __ATOMIC_ACQUIRE)) != NULL) {
+		if ((lKey->mHash == lHash) && (strcmp(lKey->mKey, pKey) == 0)) {
+			return lKey;
+		}
+		lSlot = (lSlot + 1) & (lTable->mCapacity - 1);
+	}
+	return NULL;
+}
+
+/*
+ * Newest version of pKey stamped at or before pStamp, NULL if the key had no value then. A version
+ * being pushed is stamped by its writer right after, which the reader waits for since the stamp may
+ * be at or before its own.
+ */
+
+StoreVersion* findVersion(StoreHistoryKey* pKey, int64_t pStamp) {
+	StoreVersion* lVersion = __atomic_load_n(&pKey->mHead, __ATOMIC_ACQUIRE);
+	while (lVersion != NULL) {
+		int64_t lStamp;
+		while ((lStamp = __atomic_load_n(&lVersion->mStamp, __ATOMIC_ACQUIRE)) == STORE_PENDING_STAMP) {
+			sched_yield();
+		}
+		if (lStamp <= pStamp) {
+			return ((lVersion->mType == StoreType_None) || (lVersion->mType == StoreType_Removed)) ? NULL : lVersion;
+		}
+		lVersion = __atomic_load_n(&lVersion->mPrevious, __ATOMIC_ACQUIRE);
+	}
+	return NULL;
+}
+
+StoreHistoryTable* createHistoryTable(int32_t pCapacity) {
+	StoreHistoryTable* lTable = (StoreHistoryTable*) calloc(1, sizeof(StoreHistoryTable) + pCapacity * sizeof(StoreHistoryKey*));
+	if (lTable != NULL) {
+		lTable->mCapacity = pCapacity;
+	}
+	return lTable;
+}
+
+/*
+ * Slot of pKey, or the empty slot where it goes. The table is never full, its load factor being
+ * kept under 1/2.
+ */
+
+int32_t findHistorySlot(StoreHistoryTable* pTable, const char* pKey, uint32_t pHash) {
+	int32_t lSlot = pHash & (pTable->mCapacity - 1);
+	while ((pTable->mKeys[lSlot] != NULL)
+	 && ((pTable->mKeys[lSlot]->mHash != pHash) || (strcmp(pTable->mKeys[lSlot]->mKey, pKey) != 0))) {
+		lSlot = (lSlot + 1) & (pTable->mCapacity - 1);
+	}
+	return lSlot;
+}
+
+/*
+ * Finds or adds the key of pEntry, with the table lock held. Retired memory is reclaimed along.
+ * Returns NULL if out of memory.
+ */
+
+StoreHistoryKey* addHistoryKey(StoreHistory* pHistory, StoreEntry* pEntry) {
+	StoreHistoryTable* lTable = pHistory->mTable;
+	int32_t lSlot = findHistorySlot(lTable, pEntry->mKey, pEntry->mHash);
+	if (lTable->mKeys[lSlot] != NULL) {
+		return lTable->mKeys[lSlot];
+	}
+	reclaimRetired(pHistory);
+	if ((lTable->mLength + 1) * 2 > lTable->mCapacity) {
+		if (!rebuildHistoryTable(pHistory)) {
+			return NULL;
+		}
+		lTable = pHistory->mTable;
+		lSlot = findHistorySlot(lTable, pEntry->mKey, pEntry->mHash);
+	}
+
+	size_t lKeyLength = strlen(pEntry->mKey) + 1;
+	StoreHistoryKey* lKey = (StoreHistoryKey*) malloc(sizeof(StoreHistoryKey) + lKeyLength);
+	if (lKey == NULL) {
+		return NULL;
+	}
+	lKey->mHead = NULL;
+	lKey->mHash = pEntry->mHash;
+	lKey->mRemoved = 0;
+	memcpy(lKey->mKey, pEntry->mKey, lKeyLength);
+	__atomic_store_n(&lTable->mKeys[lSlot], lKey, __ATOMIC_RELEASE);
+	++lTable->mLength;
+	return lKey;
+}
+
+/*
+ * Replaces the table with one holding the keys still reachable, twice as large as needed at least,
+ * so that rebuilds are amortized over the keys added in between. The old table and the keys dropped
+ * are retired under a stamp taken once the new table is published: pins taken from then on only
+ * see the new table. Returns 0 if out of memory.
+ */
+
+int32_t rebuildHistoryTable(StoreHistory* pHistory) {
+	StoreHistoryTable* lTable = pHistory->mTable;
+	int64_t lOldest = getOldestPin(pHistory, __atomic_load_n(&pHistory->mClock, __ATOMIC_SEQ_CST));
+	int32_t lDropped = 0;
+	int32_t i;
+	for (i = 0; i < lTable->mCapacity; ++i) {
+		if ((lTable->mKeys[i] != NULL) && isHistoryKeyDropped(lTable->mKeys[i], lOldest)) {
+			++lDropped;
+		}
+	}
+	int32_t lCapacity = STORE_HISTORY_MIN_KEYS;
+	while (lCapacity < (lTable->mLength - lDropped + 1) * 4) {
+		lCapacity *= 2;
+	}
+
+	StoreHistoryTable* lNewTable = createHistoryTable(lCapacity);
+	StoreHistoryRetired* lRetired = (StoreHistoryRetired*) malloc(sizeof(StoreHistoryRetired) + lDropped * sizeof(StoreHistoryKey*));
+	if ((lNewTable == NULL) || (lRetired == NULL)) {
+		free(lNewTable);
+		free(lRetired);
+		return 0;
+	}
+	lRetired->mNext = NULL;
+	lRetired->mTable = lTable;
+	lRetired->mKeyCount = 0;
+	for (i = 0; i < lTable->mCapacity; ++i) {
+		StoreHistoryKey* lKey = lTable->mKeys[i];
+		if (lKey == NULL) {
+			continue;
+		}
+		if (isHistoryKeyDropped(lKey, lOldest)) {
+			lRetired->mKeys[lRetired->mKeyCount++] = lKey;
+		} else {
+			lNewTable->mKeys[findHistorySlot(lNewTable, lKey->mKey, lKey->mHash)] = lKey;
+			++lNewTable->mLength;
+		}
+	}
+	__atomic_store_n(&pHistory->mTable, lNewTable, __ATOMIC_RELEASE);
+	lRetired->mStamp = __atomic_add_fetch(&pHistory->mClock, 1, __ATOMIC_SEQ_CST);
+
+	if (pHistory->mLastRetired != NULL) {
+		pHistory->mLastRetired->mNext = lRetired;
+	} else {
+		pHistory->mRetired = lRetired;
+	}
+	pHistory->mLastRetired = lRetired;
+	return 1;
+}
+
+/*
+ * A key removed before the oldest pin has no value for any snapshot, present or future.
+ */
+
+int32_t isHistoryKeyDropped(StoreHistoryKey* pKey, int64_t pOldest) {
+	if (!__atomic_load_n(&pKey->mRemoved, __ATOMIC_ACQUIRE)) {
+		return 0;
+	}
+	StoreVersion* lHead = __atomic_load_n(&pKey->mHead, __ATOMIC_ACQUIRE);
+	return (lHead->mType == StoreType_Removed) && (__atomic_load_n(&lHead->mStamp, __ATOMIC_ACQUIRE) <= pOldest);
+}
+
+/*
+ * Frees the memory retired before the oldest pin, in retirement order.
+ */
+
+void reclaimRetired(StoreHistory* pHistory) {
+	if (pHistory->mRetired == NULL) {
+		return;
+	}
+	int64_t lOldest = getOldestPin(pHistory, __atomic_load_n(&pHistory->mClock, __ATOMIC_SEQ_CST));
+	while ((pHistory->mRetired != NULL) && (pHistory->mRetired->mStamp <= lOldest)) {
+		StoreHistoryRetired* lRetired = pHistory->mRetired;
+		pHistory->mRetired = lRetired->mNext;
+		releaseRetired(lRetired);
+	}
+	if (pHistory->mRetired == NULL) {
+		pHistory->mLastRetired = NULL;
+	}
+}
+
+void releaseRetired(StoreHistoryRetired* pRetired) {
+	int32_t i;
+	for (i = 0; i < pRetired->mKeyCount; ++i) {
+		releaseHistoryKey(pRetired->mKeys[i]);
+	}
+	free(pRetired->mTable);
+	free(pRetired);
+}
+
+void releaseHistoryKey(StoreHistoryKey* pKey) {
+	releaseVersions(pKey->mHead);
+	free(pKey);
+}
+
+/*
+ * Copy of the value of pEntry, strings inline. Returns NULL if out of memory.
+ */
+
+StoreVersion* createVersion(StoreVersion* pHead, StoreEntry* pEntry, int32_t pKept) {
+	size_t lSize = sizeof(StoreVersion) + ((pEntry->mType == StoreType_String) ? pEntry->mLength * sizeof(jchar) : 0);
+	StoreVersion* lVersion = (StoreVersion*) malloc(lSize);
+	if (lVersion == NULL) {
+		return NULL;
+	}
+	lVersion->mType = pEntry->mType;
+	lVersion->mLength = pEntry->mLength;
+	lVersion->mArray = NULL;
+	switch (pEntry->mType) {
+	case StoreType_Integer:
+	case StoreType_Color:
+		lVersion->mValue = pEntry->mValue;
+		break;
+	case StoreType_String:
+		memcpy(lVersion->mChars, pEntry->mValue.mString, pEntry->mLength * sizeof(jchar));
+		lVersion->mValue.mString = lVersion->mChars;
+		break;
+	case StoreType_IntegerArray:
+	case StoreType_ColorArray:
+		if ((lVersion->mArray = shareVersionArray(pHead, pEntry, pKept)) == NULL) {
+			free(lVersion);
+			return NULL;
+		}
+		lVersion->mValue.mIntegerArray = lVersion->mArray->mData;
+		break;
+	default:
+		lVersion->mValue.mInteger = 0;
+		lVersion->mLength = 0;
+		break;
+	}
+	return lVersion;
+}
+
+/*
+ * Elements past those of the head version are not read by any version, an append writes them in
+ * the buffer of the head if it has room. Other writes copy the array into a new buffer, with the
+ * capacity of the entry so that the next appends fit.
+ */
+
+StoreVersionArray* shareVersionArray(StoreVersion* pHead, StoreEntry* pEntry, int32_t pKept) {
+	StoreVersionArray* lArray = (pHead != NULL) ? pHead->mArray : NULL;
+	if ((lArray != NULL) && (pHead->mType == pEntry->mType) && (pKept > 0) && (pKept == pHead->mLength)
+	 && (lArray->mLength == pKept) && (pEntry->mLength <= lArray->mCapacity)) {
+		memcpy(lArray->mData + pKept, pEntry->mValue.mIntegerArray + pKept, (pEntry->mLength - pKept) * sizeof(int32_t));
+		lArray->mLength = pEntry->mLength;
+		++lArray->mReferences;
+		return lArray;
+	}
+
+	int32_t lCapacity = (pEntry->mCapacity > pEntry->mLength) ? pEntry->mCapacity : pEntry->mLength;
+	lArray = (StoreVersionArray*) malloc(sizeof(StoreVersionArray) + lCapacity * sizeof(int32_t));
+	if (lArray == NULL) {
+		return NULL;
+	}
+	if (pEntry->mLength > 0) {
+		memcpy(lArray->mData, pEntry->mValue.mIntegerArray, pEntry->mLength * sizeof(int32_t));
+	}
+	lArray->mReferences = 1;
+	lArray->mLength = pEntry->mLength;
+	lArray->mCapacity = lCapacity;
+	return lArray;
+}
+
+/*
+ * The version is published before it is stamped, so that a reader pinned after the stamp was taken
+ * finds it. Versions no pin can reach anymore are freed right away.
+ */
+
+void pushVersion(StoreHistory* pHistory, StoreHistoryKey* pKey, StoreVersion* pVersion) {
+	pVersion->mStamp = STORE_PENDING_STAMP;
+	pVersion->mPrevious = pKey->mHead;
+	__atomic_store_n(&pKey->mHead, pVersion, __ATOMIC_RELEASE);
+	int64_t lStamp = __atomic_add_fetch(&pHistory->mClock, 1, __ATOMIC_SEQ_CST);
+	__atomic_store_n(&pVersion->mStamp, lStamp, __ATOMIC_RELEASE);
+	trimVersions(pVersion, getOldestPin(pHistory, lStamp));
+}
+
+/*
+ * A reader pinned at pOldest or later stops at the first version stamped at or before its pin, it
+ * never goes past the first one stamped at or before pOldest.
+ */
+
+void trimVersions(StoreVersion* pVersion, int64_t pOldest) {
+	while (pVersion->mStamp > pOldest) {
+		if ((pVersion = pVersion->mPrevious) == NULL) {
+			return;
+		}
+	}
+	StoreVersion* lUnreachable = pVersion->mPrevious;
+	if (lUnreachable != NULL) {
+		__atomic_store_n(&pVersion->mPrevious, NULL, __ATOMIC_RELEASE);
+		releaseVersions(lUnreachable);
+	}
+}
+
+/*
+ * Versions of a key are only freed by its writer, or once the key is dropped, so array references
+ * need no atomics.
+ */
+
+void releaseVersions(StoreVersion* pVersion) {
+	while (pVersion != NULL) {
+		StoreVersion* lPrevious = pVersion->mPrevious;
+		if ((pVersion->mArray != NULL) && (--pVersion->mArray->mReferences == 0)) {
+			free(pVersion->mArray);
+		}
+		free(pVersion);
+		pVersion = lPrevious;
+	}
+}
+
+/*
+ * Oldest of pStamp and the pins, read after pStamp was taken.
+ */
+
+int64_t getOldestPin(StoreHistory* pHistory, int64_t pStamp) {
+	int64_t lOldest = pStamp;
+	StoreHistoryPin* lPin;
+	for (lPin = __atomic_load_n(&pHistory->mPins, __ATOMIC_SEQ_CST); lPin != NULL; lPin = lPin->mNext) {
+		int64_t lStamp = __atomic_load_n(&lPin->mStamp, __ATOMIC_SEQ_CST);
+		if (lStamp < lOldest) {
+			lOldest = lStamp;
+		}
+	}
+	return lOldest;
+}
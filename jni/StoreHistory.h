@@ -0,0 +1,105 @@
+#ifndef _STOREHISTORY_H_
+#define _STOREHISTORY_H_
+
+#include "Store.h"
+#include <pthread.h>
+#include <stdint.h>
+
+/*
+ * Multi-version history of the values of an instance, read by snapshots without any lock. Each
+ * write, made under the shard write lock as usual, pushes an immutable StoreVersion on the chain of
+ * its key, stamped with the next value of a clock shared by all shards. A snapshot pins the clock
+ * when it is taken, and reads from each chain the newest version stamped at or before its pin.
+ *
+ * Versions are copies: the store arena is compacted and arrays written in place under the shard
+ * locks, neither of which a snapshot takes. An appended IntegerArray shares the buffer of its
+ * previous version, the new elements going past those the previous version reads, so that
+ * appending stays O(appended). Other array writes copy the whole array.
+ *
+ * Writers never wait for snapshots. Pins are announced in StoreHistoryPin records, which writers
+ * scan without lock: once a version is superseded by one at or before the oldest pin, no snapshot
+ * can reach it and the writer frees it on the spot. Keys are found through an open-addressing table
+ * of StoreHistoryKey, rebuilt by the writer adding a key once half full, which drops keys removed
+ * before the oldest pin. Replaced tables and dropped keys are retired with a stamp, and freed once
+ * every pin has moved past it, snapshots still reading them having been pinned before.
+ */
+#define STORE_HISTORY_MIN_KEYS 64
+//Stamp of a version being pushed, that readers wait for, and of a free pin record
+#define STORE_PENDING_STAMP INT64_MAX
+
+typedef struct {
+	//Versions referencing the buffer
+	int32_t mReferences;
+	//Elements written, by the version which wrote the furthest
+	int32_t mLength;
+	int32_t mCapacity;
+	int32_t mData[];
+} StoreVersionArray;
+
+typedef struct StoreVersion {
+	volatile int64_t mStamp;
+	//Older version, NULL once no pin can reach it anymore
+	struct StoreVersion* volatile mPrevious;
+	//StoreType_None or StoreType_Removed when the key had no value
+	StoreType mType;
+	int32_t mLength;
+	StoreValue mValue;
+	StoreVersionArray* mArray;
+	jchar mChars[];
+} StoreVersion;
+
+typedef struct StoreHistoryKey {
+	StoreVersion* volatile mHead;
+	uint32_t mHash;
+	//Set once the removal of the key is pushed, a table rebuild may then drop the key
+	volatile int32_t mRemoved;
+	char mKey[];
+} StoreHistoryKey;
+
+typedef struct {
+	int32_t mCapacity;
+	int32_t mLength;
+	StoreHistoryKey* volatile mKeys[];
+} StoreHistoryTable;
+
+typedef struct StoreHistoryPin {
+	//STORE_PENDING_STAMP while the record is free
+	volatile int64_t mStamp;
+	struct StoreHistoryPin* mNext;
+} StoreHistoryPin;
+
+//Table replaced by a rebuild, with the keys it dropped
+typedef struct StoreHistoryRetired {
+	struct StoreHistoryRetired* mNext;
+	int64_t mStamp;
+	StoreHistoryTable* mTable;
+	int32_t mKeyCount;
+	StoreHistoryKey* mKeys[];
+} StoreHistoryRetired;
+
+typedef struct StoreHistory {
+	volatile int64_t mClock;
+	//Records are pushed once and reused, never unlinked before the history is destroyed
+	StoreHistoryPin* volatile mPins;
+	StoreHistoryTable* volatile mTable;
+	//Held by writers adding a key, never by readers
+	pthread_mutex_t mTableLock;
+	StoreHistoryRetired* mRetired;
+	StoreHistoryRetired* mLastRetired;
+	//Clock at the first write which could not be recorded, snapshots pinned since cannot be read
+	volatile int64_t mLostStamp;
+	//The instance and each snapshot hold a reference
+	volatile int32_t mReferences;
+} StoreHistory;
+
+StoreHistory* createHistory(void);
+void retainHistory(StoreHistory* pHistory);
+void releaseHistory(StoreHistory* pHistory);
+void publishEntry(StoreHistory* pHistory, StoreEntry* pEntry, int32_t pKept);
+void publishStore(StoreHistory* pHistory, Store* pStore);
+StoreHistoryPin* pinHistory(StoreHistory* pHistory);
+void unpinHistory(StoreHistoryPin* pPin);
+int32_t isHistoryLost(StoreHistory* pHistory, int64_t pStamp);
+StoreHistoryKey* findHistoryKey(StoreHistory* pHistory, const char* pKey);
+StoreVersion* findVersion(StoreHistoryKey* pKey, int64_t pStamp);
+#endif
@@ -0,0 +1,337 @@
+#include "StoreImage.h"
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+int32_t checkImageHeader(const StoreImageHeader* pHeader, size_t pSize, int32_t pShard, int32_t pShardCount);
+int32_t isImageValueValid(const StoreImageEntry* pEntry, uint64_t pDataSize);
+uint64_t measureImageData(Store* pStore);
+uint32_t writeImageString(char* pData, uint64_t* pOffset, const char* pString);
+uint32_t writeImageChars(char* pData, uint64_t* pOffset, const jchar* pChars, int32_t pLength);
+uint32_t writeImageArray(char* pData, uint64_t* pOffset, const int32_t* pArray, int32_t pLength);
+
+/*
+ * Load the image at pPath into an empty store. Returns 0 and leaves the store empty if the file
+ * does not exist or is not a valid image, in which case the store starts from scratch and the file
+ * is replaced on next save.
+ */
+
+int32_t loadStoreImage(Store* pStore, const char* pPath, int32_t pShard, int32_t pShardCount) {
+	int lFile = open(pPath, O_RDONLY);
+	if (lFile < 0) {
+		return 0;
+	}
+	struct stat lStat;
+	if ((fstat(lFile, &lStat) != 0) || ((size_t) lStat.st_size < sizeof(StoreImageHeader))) {
+		close(lFile);
+		return 0;
+	}
+	size_t lSize = (size_t) lStat.st_size;
+	char* lMapping = (char*) mmap(NULL, lSize, PROT_READ, MAP_PRIVATE, lFile, 0);
+	//The mapping keeps the file referenced
+	close(lFile);
+	if (lMapping == MAP_FAILED) {
+		return 0;
+	}
+
+	const StoreImageHeader* lHeader = (const StoreImageHeader*) lMapping;
+	if (!checkImageHeader(lHeader, lSize, pShard, pShardCount)) {
+		munmap(lMapping, lSize);
+		return 0;
+	}
+	const StoreSlot* lSlots = (const StoreSlot*) (lMapping + sizeof(StoreImageHeader));
+	const StoreImageEntry* lEntries = (const StoreImageEntry*) (lSlots + lHeader->mSlotCount);
+	char* lData = (char*) (lEntries + lHeader->mLength);
+	//From now on, releaseStore() knows which values belong to the mapping and unmaps it
+	pStore->mMapping = lMapping;
+	pStore->mMappingSize = lSize;
+
+	pStore->mSlots = (StoreSlot*) malloc(lHeader->mSlotCount * sizeof(StoreSlot));
+	if (pStore->mSlots == NULL) {
+		goto ERROR;
+	}
+	pStore->mSlotCount = lHeader->mSlotCount;
+	int32_t i;
+	for (i = 0; i < lHeader->mSlotCount; ++i) {
+		if ((lSlots[i].mIndex < STORE_TOMBSTONE_SLOT) || (lSlots[i].mIndex >= lHeader->mLength)) {
+			goto ERROR;
+		}
+		if (lSlots[i].mIndex == STORE_TOMBSTONE_SLOT) {
+			++pStore->mTombstones;
+		}
+		pStore->mSlots[i] = lSlots[i];
+	}
+
+	for (i = 0; i < lHeader->mLength; ++i) {
+		const StoreImageEntry* lImageEntry = &lEntries[i];
+		StoreEntry* lEntry = appendEntry(pStore);
+		if ((lEntry == NULL) || (lImageEntry->mKey >= lHeader->mDataSize)
+		 || !isImageValueValid(lImageEntry, lHeader->mDataSize)) {
+			goto ERROR;
+		}
+
+		lEntry->mKey = lData + lImageEntry->mKey;
+		lEntry->mHash = lImageEntry->mHash;
+		lEntry->mType = (StoreType) lImageEntry->mType;
+		lEntry->mLength = lImageEntry->mLength;
+		lEntry->mCapacity = lImageEntry->mLength;
+		lEntry->mGeneration = lImageEntry->mGeneration;
+		lEntry->mAlerted = 0;
+		lEntry->mAlertTime = 0;
+		switch (lEntry->mType) {
+		case StoreType_Integer:
+			lEntry->mValue.mInteger = (int32_t) lImageEntry->mValue;
+			break;
+		case StoreType_Color:
+			lEntry->mValue.mColor = (int32_t) lImageEntry->mValue;
+			break;
+		case StoreType_String:
+			lEntry->mValue.mString = (jchar*) (lData + lImageEntry->mValue);
+			break;
+		case StoreType_IntegerArray:
+			lEntry->mValue.mIntegerArray = (int32_t*) (lData + lImageEntry->mValue);
+			break;
+		case StoreType_ColorArray:
+			lEntry->mValue.mColorArray = (int32_t*) (lData + lImageEntry->mValue);
+			break;
+		case StoreType_None:
+			lEntry->mValue.mInteger = 0;
+			break;
+		case StoreType_Removed:
+			//Free list is rebuilt rather than trusted
+			lEntry->mKey = NULL;
+			lEntry->mValue.mInteger = pStore->mFreeEntry;
+			pStore->mFreeEntry = i;
+			++pStore->mFreeCount;
+			break;
+		}
+		++pStore->mLength;
+		if ((lEntry->mType != StoreType_Removed) && !addIndexKey(&pStore->mKeyIndex, lEntry->mKey, i)) {
+			goto ERROR;
+		}
+	}
+	//A slot leading to a removed entry would make lookups compare against its NULL key
+	for (i = 0; i < pStore->mSlotCount; ++i) {
+		if ((pStore->mSlots[i].mIndex >= 0) && (getEntry(pStore, pStore->mSlots[i].mIndex)->mType == StoreType_Removed)) {
+			goto ERROR;
+		}
+	}
+	return 1;
+
+ERROR:
+	releaseStore(NULL, pStore);
+	return 0;
+}
+
+/*
+ * The data area must end with a NUL so that no string can be read past the mapping, whatever the
+ * content of the file. Slot count must be a power of two, as expected by lookups.
+ */
+
+int32_t checkImageHeader(const StoreImageHeader* pHeader, size_t pSize, int32_t pShard, int32_t pShardCount) {
+	if ((pHeader->mMagic != STORE_IMAGE_MAGIC) || (pHeader->mVersion != STORE_IMAGE_VERSION)
+	 || (pHeader->mShard != pShard) || (pHeader->mShardCount != pShardCount)
+	 || (pHeader->mLength < 0) || (pHeader->mLength > STORE_MAX_CAPACITY)
+	 || (pHeader->mSlotCount < STORE_MIN_SLOTS) || (pHeader->mSlotCount > 2 * STORE_MAX_CAPACITY)
+	 || ((pHeader->mSlotCount & (pHeader->mSlotCount - 1)) != 0)
+	 || ((uint64_t) pHeader->mLength * 4 > (uint64_t) pHeader->mSlotCount * 3)
+	 || (pHeader->mDataSize == 0)) {
+		return 0;
+	}
+	uint64_t lSize = sizeof(StoreImageHeader) + (uint64_t) pHeader->mSlotCount * sizeof(StoreSlot)
+		+ (uint64_t) pHeader->mLength * sizeof(StoreImageEntry) + pHeader->mDataSize;
+	if (lSize != pSize) {
+		return 0;
+	}
+
+	const char* lData = (const char*) pHeader + (pSize - pHeader->mDataSize);
+	return (lData[pHeader->mDataSize - 1] == '\0');
+}
+
+int32_t isImageValueValid(const StoreImageEntry* pEntry, uint64_t pDataSize) {
+	switch (pEntry->mType) {
+	case StoreType_Integer:
+	case StoreType_Color:
+	case StoreType_None:
+	case StoreType_Removed:
+		return 1;
+	case StoreType_String:
+		return (pEntry->mLength >= 0) && ((pEntry->mValue & 1) == 0)
+			&& ((uint64_t) pEntry->mValue + (uint64_t) pEntry->mLength * sizeof(jchar) <= pDataSize);
+	case StoreType_IntegerArray:
+	case StoreType_ColorArray:
+		return (pEntry->mLength >= 0) && ((pEntry->mValue & 3) == 0)
+			&& ((uint64_t) pEntry->mValue + (uint64_t) pEntry->mLength * sizeof(int32_t) <= pDataSize);
+	default:
+		return 0;
+	}
+}
+
+/*
+ * The image is written to a temporary file next to pPath, synced, then renamed over pPath. A crash
+ * leaves either the previous image or the new one, never a partial file. A mapping of the previous
+ * image remains valid after the rename. Caller holds at least the read lock.
+ */
+
+int32_t saveStoreImage(Store* pStore, const char* pPath, int32_t pShard, int32_t pShardCount) {
+	uint64_t lDataSize = measureImageData(pStore);
+	int32_t lSlotCount = (pStore->mSlotCount > 0) ? pStore->mSlotCount : STORE_MIN_SLOTS;
+	uint64_t lSize = sizeof(StoreImageHeader) + (uint64_t) lSlotCount * sizeof(StoreSlot)
+		+ (uint64_t) pStore->mLength * sizeof(StoreImageEntry) + lDataSize;
+	if ((lDataSize > UINT32_MAX) || (lSize > SIZE_MAX)) {
+		return 0;
+	}
+
+	size_t lPathLength = strlen(pPath);
+	char* lTmpPath = (char*) malloc(lPathLength + 5);
+	if (lTmpPath == NULL) {
+		return 0;
+	}
+	memcpy(lTmpPath, pPath, lPathLength);
+	strcpy(lTmpPath + lPathLength, ".tmp");
+
+	char* lMapping = MAP_FAILED;
+	int lFile = open(lTmpPath, O_RDWR | O_CREAT | O_TRUNC, 0600);
+	if ((lFile < 0) || (ftruncate(lFile, (off_t) lSize) != 0)) {
+		goto ERROR;
+	}
+	lMapping = (char*) mmap(NULL, (size_t) lSize, PROT_READ | PROT_WRITE, MAP_SHARED, lFile, 0);
+	if (lMapping == MAP_FAILED) {
+		goto ERROR;
+	}
+
+	StoreImageHeader* lHeader = (StoreImageHeader*) lMapping;
+	StoreSlot* lSlots = (StoreSlot*) (lMapping + sizeof(StoreImageHeader));
+	StoreImageEntry* lEntries = (StoreImageEntry*) (lSlots + lSlotCount);
+	char* lData = (char*) (lEntries + pStore->mLength);
+	lHeader->mMagic = STORE_IMAGE_MAGIC;
+	lHeader->mVersion = STORE_IMAGE_VERSION;
+	lHeader->mLength = pStore->mLength;
+	lHeader->mSlotCount = lSlotCount;
+	lHeader->mShard = pShard;
+	lHeader->mShardCount = pShardCount;
+	lHeader->mDataSize = lDataSize;
+
+	int32_t i;
+	if (pStore->mSlots != NULL) {
+		memcpy(lSlots, pStore->mSlots, lSlotCount * sizeof(StoreSlot));
+	} else {
+		for (i = 0; i < lSlotCount; ++i) {
+			lSlots[i].mIndex = STORE_EMPTY_SLOT;
+		}
+	}
+
+	uint64_t lOffset = 0;
+	for (i = 0; i < pStore->mLength; ++i) {
+		StoreEntry* lEntry = getEntry(pStore, i);
+		StoreImageEntry* lImageEntry = &lEntries[i];
+		lImageEntry->mKey = writeImageString(lData, &lOffset, (lEntry->mKey != NULL) ? lEntry->mKey : "");
+		lImageEntry->mHash = lEntry->mHash;
+		lImageEntry->mType = lEntry->mType;
+		lImageEntry->mLength = lEntry->mLength;
+		lImageEntry->mGeneration = lEntry->mGeneration;
+		switch (lEntry->mType) {
+		case StoreType_Integer:
+			lImageEntry->mValue = (uint32_t) lEntry->mValue.mInteger;
+			break;
+		case StoreType_Color:
+			lImageEntry->mValue = (uint32_t) lEntry->mValue.mColor;
+			break;
+		case StoreType_String:
+			lImageEntry->mValue = writeImageChars(lData, &lOffset, lEntry->mValue.mString, lEntry->mLength);
+			break;
+		case StoreType_IntegerArray:
+			lImageEntry->mValue = writeImageArray(lData, &lOffset, lEntry->mValue.mIntegerArray, lEntry->mLength);
+			break;
+		case StoreType_ColorArray:
+			lImageEntry->mValue = writeImageArray(lData, &lOffset, lEntry->mValue.mColorArray, lEntry->mLength);
+			break;
+		default:
+			lImageEntry->mValue = 0;
+			break;
+		}
+	}
+	lData[lDataSize - 1] = '\0';
+
+	if ((msync(lMapping, (size_t) lSize, MS_SYNC) != 0) || (munmap(lMapping, (size_t) lSize) != 0)) {
+		lMapping = MAP_FAILED;
+		goto ERROR;
+	}
+	lMapping = MAP_FAILED;
+	if ((fsync(lFile) != 0) || (close(lFile) != 0)) {
+		lFile = -1;
+		goto ERROR;
+	}
+	lFile = -1;
+	if (rename(lTmpPath, pPath) != 0) {
+		goto ERROR;
+	}
+	free(lTmpPath);
+	return 1;
+
+ERROR:
+	if (lMapping != MAP_FAILED) {
+		munmap(lMapping, (size_t) lSize);
+	}
+	if (lFile >= 0) {
+		close(lFile);
+	}
+	unlink(lTmpPath);
+	free(lTmpPath);
+	return 0;
+}
+
+/*
+ * Size of the data area, with strings padded to 2 bytes, arrays to 4 bytes and a final NUL.
+ */
+
+uint64_t measureImageData(Store* pStore) {
+	uint64_t lSize = 0;
+	int32_t i;
+	for (i = 0; i < pStore->mLength; ++i) {
+		StoreEntry* lEntry = getEntry(pStore, i);
+		lSize += (lEntry->mKey != NULL) ? strlen(lEntry->mKey) + 1 : 1;
+		switch (lEntry->mType) {
+		case StoreType_String:
+			lSize = ((lSize + 1) & ~(uint64_t) 1) + (uint64_t) lEntry->mLength * sizeof(jchar);
+			break;
+		case StoreType_IntegerArray:
+		case StoreType_ColorArray:
+			lSize = ((lSize + 3) & ~(uint64_t) 3) + (uint64_t) lEntry->mLength * sizeof(int32_t);
+			break;
+		default:
+			break;
+		}
+	}
+	return lSize + 1;
+}
+
+uint32_t writeImageString(char* pData, uint64_t* pOffset, const char* pString) {
+	uint32_t lOffset = (uint32_t) *pOffset;
+	size_t lSize = strlen(pString) + 1;
+	memcpy(pData + lOffset, pString, lSize);
+	*pOffset += lSize;
+	return lOffset;
+}
+
+uint32_t writeImageChars(char* pData, uint64_t* pOffset, const jchar* pChars, int32_t pLength) {
+	uint32_t lOffset = (uint32_t) ((*pOffset + 1) & ~(uint64_t) 1);
+	if (pLength > 0) {
+		memcpy(pData + lOffset, pChars, pLength * sizeof(jchar));
+	}
+	*pOffset = lOffset + (uint64_t) pLength * sizeof(jchar);
+	return lOffset;
+}
+
+uint32_t writeImageArray(char* pData, uint64_t* pOffset, const int32_t* pArray, int32_t pLength) {
+	uint32_t lOffset = (uint32_t) ((*pOffset + 3) & ~(uint64_t) 3);
+	if (pLength > 0) {
+		memcpy(pData + lOffset, pArray, pLength * sizeof(int32_t));
+	}
+	*pOffset = lOffset + (uint64_t) pLength * sizeof(int32_t);
+	return lOffset;
+}
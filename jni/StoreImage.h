@@ -0,0 +1,49 @@
+#ifndef _STOREIMAGE_H_
+#define _STOREIMAGE_H_
+
+#include "Store.h"
+#include <stdint.h>
+
+/*
+ * A store image is a file holding, in native byte order:
+ * - a header,
+ * - the slot table as is, tombstones included,
+ * - the entry table, where keys, strings and arrays are offsets in the data area,
+ * - the data area: NUL-terminated keys, 2-byte aligned UTF-16 strings and 4-byte aligned arrays.
+ *   Strings and arrays are not terminated, the entry holds their length. Removed entries have an
+ *   empty key and are put back in the free list on load.
+ *
+ * Loading maps the file read-only and points entries straight into the mapping. Nothing is
+ * rehashed nor copied, so string and array pages are only read when their entry is accessed. An
+ * array is copied to the heap before it is written in place or viewed, see detachEntryArray().
+ *
+ * Each shard of a store is saved in its own image. An image is only loaded into the shard it was
+ * saved from, with the same shard count, since keys are spread over shards by hash.
+ */
+#define STORE_IMAGE_MAGIC 0x4A53544Fu
+#define STORE_IMAGE_VERSION 4
+
+typedef struct {
+	uint32_t mMagic;
+	uint32_t mVersion;
+	int32_t mLength;
+	int32_t mSlotCount;
+	int32_t mShard;
+	int32_t mShardCount;
+	uint64_t mDataSize;
+} StoreImageHeader;
+
+typedef struct {
+	uint32_t mKey;
+	uint32_t mHash;
+	int32_t mType;
+	int32_t mLength;
+	//Integer or color value, offset of a string or an array otherwise
+	uint32_t mValue;
+	//Kept so that handles resolved before a save do not resolve to another key after a reload
+	int32_t mGeneration;
+} StoreImageEntry;
+
+int32_t loadStoreImage(Store* pStore, const char* pPath, int32_t pShard, int32_t pShardCount);
+int32_t saveStoreImage(Store* pStore, const char* pPath, int32_t pShard, int32_t pShardCount);
+#endif
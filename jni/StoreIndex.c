@@ -0,0 +1,134 @@
+#include "StoreIndex.h"
+#include <stdlib.h>
+#include <string.h>
+
+int32_t drawIndexLevel(StoreIndex* pIndex);
+void findIndexLinks(StoreIndex* pIndex, const char* pKey, StoreIndexNode*** pLinks);
+
+/*
+ * Node with a random level, to be filled and inserted by the caller, which allocates it before
+ * changing anything so that running out of memory is easy to undo. Returns NULL if out of memory.
+ */
+
+StoreIndexNode* createIndexNode(StoreIndex* pIndex) {
+	int32_t lLevel = drawIndexLevel(pIndex);
+	StoreIndexNode* lNode = (StoreIndexNode*) malloc(sizeof(StoreIndexNode) + lLevel * sizeof(StoreIndexNode*));
+	if (lNode == NULL) {
+		return NULL;
+	}
+	lNode->mLevel = lLevel;
+	return lNode;
+}
+
+/*
+ * Xorshift, seeded on first use since stores are zero-initialized. Each pair of low bits set to zero
+ * raises the level by one.
+ */
+
+int32_t drawIndexLevel(StoreIndex* pIndex) {
+	uint32_t lBits = (pIndex->mSeed != 0) ? pIndex->mSeed : 0x9E3779B9;
+	lBits ^= lBits << 13;
+	lBits ^= lBits >> 17;
+	lBits ^= lBits << 5;
+	pIndex->mSeed = lBits;
+
+	int32_t lLevel = 1;
+	while ((lLevel < STORE_INDEX_MAX_LEVEL) && ((lBits & 3) == 0)) {
+		++lLevel;
+		lBits >>= 2;
+	}
+	return lLevel;
+}
+
+/*
+ * Insert a node whose key is not in the index yet.
+ */
+
+void insertIndexNode(StoreIndex* pIndex, StoreIndexNode* pNode) {
+	StoreIndexNode** lLinks[STORE_INDEX_MAX_LEVEL];
+	findIndexLinks(pIndex, pNode->mKey, lLinks);
+	int32_t i;
+	for (i = 0; i < pNode->mLevel; ++i) {
+		pNode->mNext[i] = *lLinks[i];
+		*lLinks[i] = pNode;
+	}
+}
+
+/*
+ * Same as createIndexNode() and insertIndexNode() at once, when there is nothing to undo. Returns 0
+ * if out of memory.
+ */
+
+int32_t addIndexKey(StoreIndex* pIndex, const char* pKey, int32_t pEntry) {
+	StoreIndexNode* lNode = createIndexNode(pIndex);
+	if (lNode == NULL) {
+		return 0;
+	}
+	lNode->mKey = pKey;
+	lNode->mEntry = pEntry;
+	insertIndexNode(pIndex, lNode);
+	return 1;
+}
+
+void removeIndexKey(StoreIndex* pIndex, const char* pKey) {
+	StoreIndexNode** lLinks[STORE_INDEX_MAX_LEVEL];
+	findIndexLinks(pIndex, pKey, lLinks);
+	StoreIndexNode* lNode = *lLinks[0];
+	if ((lNode == NULL) || (strcmp(lNode->mKey, pKey) != 0)) {
+		return;
+	}
+	int32_t i;
+	for (i = 0; i < lNode->mLevel; ++i) {
+		*lLinks[i] = lNode->mNext[i];
+	}
+	free(lNode);
+}
+
+/*
+ * First node whose key follows pKey, or is pKey itself if pInclusive. A NULL pKey is the first node.
+ * Following nodes are reached through mNext[0]. Returns NULL past the last key.
+ */
+
+StoreIndexNode* seekIndex(StoreIndex* pIndex, const char* pKey, int32_t pInclusive) {
+	if (pKey == NULL) {
+		return pIndex->mHead[0];
+	}
+	StoreIndexNode** lLinks[STORE_INDEX_MAX_LEVEL];
+	findIndexLinks(pIndex, pKey, lLinks);
+	StoreIndexNode* lNode = *lLinks[0];
+	if (!pInclusive && (lNode != NULL) && (strcmp(lNode->mKey, pKey) == 0)) {
+		lNode = lNode->mNext[0];
+	}
+	return lNode;
+}
+
+/*
+ * On each level, the link leading to the first node whose key is not lower than pKey: mHead or mNext
+ * of the node before it, which is where a node for pKey gets linked or unlinked. The head is walked
+ * as the links of a node on every level.
+ */
+
+void findIndexLinks(StoreIndex* pIndex, const char* pKey, StoreIndexNode*** pLinks) {
+	StoreIndexNode** lLinks = pIndex->mHead;
+	int32_t i;
+	for (i = STORE_INDEX_MAX_LEVEL - 1; i >= 0; --i) {
+		while ((lLinks[i] != NULL) && (strcmp(lLinks[i]->mKey, pKey) < 0)) {
+			lLinks = lLinks[i]->mNext;
+		}
+		pLinks[i] = &lLinks[i];
+	}
+}
+
+/*
+ * Free every node. The index is left empty and can be reused right away.
+ */
+
+void releaseIndex(StoreIndex* pIndex) {
+	StoreIndexNode* lNode = pIndex->mHead[0];
+	while (lNode != NULL) {
+		StoreIndexNode* lNext = lNode->mNext[0];
+		free(lNode);
+		lNode = lNext;
+	}
+	memset(pIndex->mHead, 0, sizeof(pIndex->mHead));
+}
@@ -0,0 +1,38 @@
+#ifndef _STOREINDEX_H_
+#define _STOREINDEX_H_
+
+#include <stdint.h>
+
+/*
+ * Keys of a store in strcmp() order, as a skip list. Each node points to its key, which belongs to
+ * the store, and holds the index of its entry. A node on level i is also on level i + 1 with a 1/4
+ * probability, so searches, insertions and removals take O(log n) comparisons and only relink the
+ * neighbours of a node: nothing is ever rebalanced nor rebuilt.
+ *
+ * Modified UTF-8 keys sort in the order of String.compareTo(), except for '\0' which is encoded on
+ * two bytes and sorts between '\u007F' and '\u0080'.
+ */
+#define STORE_INDEX_MAX_LEVEL 12
+
+typedef struct StoreIndexNode {
+	const char* mKey;
+	int32_t mEntry;
+	int32_t mLevel;
+	//Next node on each level of the node
+	struct StoreIndexNode* mNext[];
+} StoreIndexNode;
+
+typedef struct {
+	//First node on each level
+	StoreIndexNode* mHead[STORE_INDEX_MAX_LEVEL];
+	//State of the generator drawing node levels
+	uint32_t mSeed;
+} StoreIndex;
+
+StoreIndexNode* createIndexNode(StoreIndex* pIndex);
+void insertIndexNode(StoreIndex* pIndex, StoreIndexNode* pNode);
+int32_t addIndexKey(StoreIndex* pIndex, const char* pKey, int32_t pEntry);
+void removeIndexKey(StoreIndex* pIndex, const char* pKey);
+StoreIndexNode* seekIndex(StoreIndex* pIndex, const char* pKey, int32_t pInclusive);
+void releaseIndex(StoreIndex* pIndex);
+#endif
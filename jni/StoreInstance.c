@@ -0,0 +1,471 @@
+#include "StoreInstance.h"
+#include "StoreCache.h"
+#include "StoreImage.h"
+#include <pthread.h>
+#include <sched.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+char* getShardPath(const char* pPath, int32_t pShard);
+StoreEntry* findHandleEntry(StoreKey* pStoreKey);
+StoreInstanceSlot* getInstanceSlot(jlong pReference);
+
+//Chunks are allocated under gSlotLock and never freed, slots are read without lock
+static StoreInstanceSlot* gSlotChunks[STORE_MAX_SLOT_CHUNKS];
+static int32_t gSlotCount = 0;
+static int32_t gFreeSlot = -1;
+static pthread_mutex_t gSlotLock = PTHREAD_MUTEX_INITIALIZER;
+
+/*
+ * Shard count is rounded down to a power of two, between 1 and STORE_MAX_SHARDS.
+ */
+
+StoreInstance* createInstance(int32_t pShardCount) {
+	int32_t lShardCount = 1;
+	while ((lShardCount * 2 <= pShardCount) && (lShardCount < STORE_MAX_SHARDS)) {
+		lShardCount *= 2;
+	}
+
+	StoreInstance* lInstance = (StoreInstance*) calloc(1, sizeof(StoreInstance));
+	if (lInstance == NULL) {
+		return NULL;
+	}
+	lInstance->mShards = createStores(lShardCount);
+	if (lInstance->mShards == NULL) {
+		free(lInstance);
+		return NULL;
+	}
+	lInstance->mShardCount = lShardCount;
+	lInstance->mHistory = createHistory();
+	if (lInstance->mHistory == NULL) {
+		destroyStores(NULL, lInstance->mShards, lShardCount);
+		free(lInstance);
+		return NULL;
+	}
+	int32_t i;
+	for (i = 0; i < lShardCount; ++i) {
+		lInstance->mShards[i].mHistory = lInstance->mHistory;
+	}
+
+#ifdef STORE_STATS
+	lInstance->mStats = (StoreStats*) calloc(1, sizeof(StoreStats));
+	if (lInstance->mStats == NULL) {
+		destroyStores(NULL, lInstance->mShards, lShardCount);
+		releaseHistory(lInstance->mHistory);
+		free(lInstance);
+		return NULL;
+	}
+	for (i = 0; i < lShardCount; ++i) {
+		lInstance->mShards[i].mStats = lInstance->mStats;
+	}
+#endif
+	return lInstance;
+}
+
+/*
+ * The watcher must be stopped beforehand. The history lives on while snapshots still read it.
+ */
+
+void destroyInstance(JNIEnv* pEnv, StoreInstance* pInstance) {
+	destroyStores(pEnv, pInstance->mShards, pInstance->mShardCount);
+	releaseHistory(pInstance->mHistory);
+#ifdef STORE_STATS
+	free(pInstance->mStats);
+#endif
+	free(pInstance->mPath);
+	free(pInstance);
+}
+
+/*
+ * Returns the reference to store in mNativeStore, 0 if no slot is left. Generations start at 1 so
+ * that a reference is never 0.
+ */
+
+jlong registerInstance(StoreInstance* pInstance) {
+	pthread_mutex_lock(&gSlotLock);
+	int32_t lIndex = gFreeSlot;
+	if (lIndex >= 0) {
+		gFreeSlot = gSlotChunks[lIndex / STORE_SLOT_CHUNK][lIndex % STORE_SLOT_CHUNK].mNextFree;
+	} else if (gSlotCount < STORE_MAX_SLOT_CHUNKS * STORE_SLOT_CHUNK) {
+		if ((gSlotCount % STORE_SLOT_CHUNK) == 0) {
+			gSlotChunks[gSlotCount / STORE_SLOT_CHUNK] = (StoreInstanceSlot*) calloc(STORE_SLOT_CHUNK, sizeof(StoreInstanceSlot));
+		}
+		if (gSlotChunks[gSlotCount / STORE_SLOT_CHUNK] != NULL) {
+			lIndex = gSlotCount++;
+		}
+	}
+	if (lIndex < 0) {
+		pthread_mutex_unlock(&gSlotLock);
+		return 0;
+	}
+
+	StoreInstanceSlot* lSlot = &gSlotChunks[lIndex / STORE_SLOT_CHUNK][lIndex % STORE_SLOT_CHUNK];
+	int32_t lGeneration = (int32_t) (lSlot->mState >> 32) + 1;
+	if (lGeneration == 0) {
+		lGeneration = 1;
+	}
+	lSlot->mInstance = pInstance;
+	pInstance->mSlot = lIndex;
+	__sync_synchronize();
+	lSlot->mState = (int64_t) lGeneration << 32;
+	pthread_mutex_unlock(&gSlotLock);
+	return ((jlong) lGeneration << 32) | lIndex;
+}
+
+/*
+ * Clears mNativeStore and returns its instance, once no call pins it anymore, for the caller to
+ * destroy. Returns NULL if the store is not initialized, or already being finalized by another
+ * thread.
+ */
+
+StoreInstance* unregisterInstance(JNIEnv* pEnv, jobject pThis) {
+	jlong lReference = (*pEnv)->GetLongField(pEnv, pThis, gStoreCache.FieldNativeStore);
+	StoreInstanceSlot* lSlot = getInstanceSlot(lReference);
+	if (lSlot == NULL) {
+		return NULL;
+	}
+	int64_t lState;
+	do {
+		lState = lSlot->mState;
+		if (((int32_t) (lState >> 32) != (int32_t) (lReference >> 32)) || (lState & STORE_SLOT_CLOSING)) {
+			return NULL;
+		}
+	} while (!__sync_bool_compare_and_swap(&lSlot->mState, lState, lState | STORE_SLOT_CLOSING));
+	(*pEnv)->SetLongField(pEnv, pThis, gStoreCache.FieldNativeStore, 0);
+
+	//Calls already in progress are short, but may be waiting for a shard lock
+	while ((lSlot->mState & STORE_SLOT_USERS) != 0) {
+		sched_yield();
+	}
+	StoreInstance* lInstance = lSlot->mInstance;
+	pthread_mutex_lock(&gSlotLock);
+	lSlot->mInstance = NULL;
+	lSlot->mState = lState & ~STORE_SLOT_USERS;
+	lSlot->mNextFree = gFreeSlot;
+	gFreeSlot = (int32_t) (lReference & 0xFFFFFFFFL);
+	pthread_mutex_unlock(&gSlotLock);
+	return lInstance;
+}
+
+/*
+ * Slot of a reference, NULL if the reference is 0 or names a slot never allocated.
+ */
+
+StoreInstanceSlot* getInstanceSlot(jlong pReference) {
+	int32_t lIndex = (int32_t) (pReference & 0xFFFFFFFFL);
+	if ((pReference == 0) || (lIndex < 0) || (lIndex >= STORE_MAX_SLOT_CHUNKS * STORE_SLOT_CHUNK)) {
+		return NULL;
+	}
+	StoreInstanceSlot* lChunk = gSlotChunks[lIndex / STORE_SLOT_CHUNK];
+	return (lChunk != NULL) ? &lChunk[lIndex % STORE_SLOT_CHUNK] : NULL;
+}
+
+/*
+ * Pins the instance of the Java object, which must be released with releaseInstance(). Returns NULL
+ * with an IllegalStateException pending if the store is not initialized, or being finalized.
+ */
+
+StoreInstance* getInstance(JNIEnv* pEnv, jobject pThis) {
+	jlong lReference = (*pEnv)->GetLongField(pEnv, pThis, gStoreCache.FieldNativeStore);
+	StoreInstanceSlot* lSlot = getInstanceSlot(lReference);
+	if (lSlot != NULL) {
+		int64_t lState;
+		do {
+			lState = lSlot->mState;
+			if (((int32_t) (lState >> 32) != (int32_t) (lReference >> 32)) || (lState & STORE_SLOT_CLOSING)) {
+				lSlot = NULL;
+				break;
+			}
+		} while (!__sync_bool_compare_and_swap(&lSlot->mState, lState, lState + 1));
+	}
+	if (lSlot == NULL) {
+		throwIllegalStateException(pEnv, "Store is not initialized");
+		return NULL;
+	}
+	return lSlot->mInstance;
+}
+
+void releaseInstance(StoreInstance* pInstance) {
+	__sync_fetch_and_sub(&gSlotChunks[pInstance->mSlot / STORE_SLOT_CHUNK][pInstance->mSlot % STORE_SLOT_CHUNK].mState, 1);
+}
+
+volatile int32_t* getInstanceVersion(StoreInstance* pInstance) {
+	return &gSlotChunks[pInstance->mSlot / STORE_SLOT_CHUNK][pInstance->mSlot % STORE_SLOT_CHUNK].mVersion;
+}
+
+/*
+ * Key is converted and hashed once, before any lock is taken. Must be closed with closeKey(), which
+ * releases the instance too. Returns 0 with an exception pending if the store is not initialized or
+ * out of memory. A key opened on an instance already pinned is closed with closeInstanceKey().
+ */
+
+int32_t openKey(JNIEnv* pEnv, jobject pThis, jstring pKey, StoreKey* pStoreKey) {
+	StoreInstance* lInstance = getInstance(pEnv, pThis);
+	if (lInstance == NULL) {
+		return 0;
+	}
+	if (!openInstanceKey(pEnv, lInstance, pKey, pStoreKey)) {
+		releaseInstance(lInstance);
+		return 0;
+	}
+	return 1;
+}
+
+int32_t openInstanceKey(JNIEnv* pEnv, StoreInstance* pInstance, jstring pKey, StoreKey* pStoreKey) {
+	pStoreKey->mKey = (*pEnv)->GetStringUTFChars(pEnv, pKey, NULL);
+	if (pStoreKey->mKey == NULL) {
+		return 0;
+	}
+	pStoreKey->mInstance = pInstance;
+	pStoreKey->mJavaKey = pKey;
+	pStoreKey->mHash = hashKey(pStoreKey->mKey);
+	pStoreKey->mShard = getKeyShard(pInstance, pStoreKey->mHash);
+	pStoreKey->mIndex = STORE_EMPTY_SLOT;
+	pStoreKey->mGeneration = 0;
+	return 1;
+}
+
+/*
+ * High bits of the hash pick the shard, low bits the slot in its table.
+ */
+
+Store* getKeyShard(StoreInstance* pInstance, uint32_t pHash) {
+	return &pInstance->mShards[(pHash >> (32 - STORE_SHARD_BITS)) & (pInstance->mShardCount - 1)];
+}
+
+/*
+ * A handle naming a shard this instance does not have resolves to no entry. Must be closed with
+ * closeKey() as a key.
+ */
+
+int32_t openHandle(JNIEnv* pEnv, jobject pThis, jlong pHandle, StoreKey* pStoreKey) {
+	StoreInstance* lInstance = getInstance(pEnv, pThis);
+	if (lInstance == NULL) {
+		return 0;
+	}
+	int32_t lShard = (int32_t) (pHandle & (STORE_MAX_SHARDS - 1));
+	jlong lIndex = (pHandle & 0xFFFFFFFFL) >> STORE_SHARD_BITS;
+	pStoreKey->mInstance = lInstance;
+	pStoreKey->mJavaKey = NULL;
+	pStoreKey->mKey = NULL;
+	pStoreKey->mShard = &lInstance->mShards[lShard & (lInstance->mShardCount - 1)];
+	pStoreKey->mIndex = ((pHandle < 0) || (lIndex >= STORE_MAX_CAPACITY) || (lShard >= lInstance->mShardCount))
+		? STORE_EMPTY_SLOT : (int32_t) lIndex;
+	pStoreKey->mGeneration = (int32_t) (pHandle >> 32);
+	return 1;
+}
+
+void closeKey(JNIEnv* pEnv, StoreKey* pStoreKey) {
+	closeInstanceKey(pEnv, pStoreKey);
+	releaseInstance(pStoreKey->mInstance);
+}
+
+void closeInstanceKey(JNIEnv* pEnv, StoreKey* pStoreKey) {
+	if (pStoreKey->mKey != NULL) {
+		(*pEnv)->ReleaseStringUTFChars(pEnv, pStoreKey->mJavaKey, pStoreKey->mKey);
+		pStoreKey->mKey = NULL;
+	}
+}
+
+/*
+ * Lookups and allocations run under the lock of pStoreKey->mShard.
+ */
+
+StoreEntry* findKeyEntry(StoreKey* pStoreKey) {
+	if (pStoreKey->mKey != NULL) {
+		pStoreKey->mIndex = lookupIndex(pStoreKey->mShard, pStoreKey->mKey, pStoreKey->mHash);
+		return findIndexEntry(pStoreKey->mShard, pStoreKey->mIndex);
+	}
+	return findHandleEntry(pStoreKey);
+}
+
+StoreEntry* allocateEntry(JNIEnv* pEnv, StoreKey* pStoreKey) {
+	if (pStoreKey->mKey != NULL) {
+		return allocateKeyEntry(pEnv, pStoreKey->mShard, pStoreKey->mKey, pStoreKey->mHash);
+	}
+
+	StoreEntry* lEntry = findHandleEntry(pStoreKey);
+	if (lEntry == NULL) {
+		throwNotExistingKeyException(pEnv);
+	} else {
+		releaseEntryValue(pEnv, pStoreKey->mShard, lEntry);
+	}
+	return lEntry;
+}
+
+/*
+ * Entry of a handle, NULL if its key was removed since the handle was made.
+ */
+
+StoreEntry* findHandleEntry(StoreKey* pStoreKey) {
+	StoreEntry* lEntry = findIndexEntry(pStoreKey->mShard, pStoreKey->mIndex);
+	return ((lEntry != NULL) && (lEntry->mGeneration == pStoreKey->mGeneration)) ? lEntry : NULL;
+}
+
+/*
+ * Same as allocateEntry(), but the current value of the entry is kept for the caller to update.
+ */
+
+StoreEntry* reserveEntry(JNIEnv* pEnv, StoreKey* pStoreKey) {
+	if (pStoreKey->mKey == NULL) {
+		StoreEntry* lEntry = findHandleEntry(pStoreKey);
+		if (lEntry == NULL) {
+			throwNotExistingKeyException(pEnv);
+		}
+		return lEntry;
+	}
+
+	int32_t lIndex = reserveKeyEntry(pStoreKey);
+	if (lIndex == STORE_EMPTY_SLOT) {
+		throwStoreFullException(pEnv);
+		return NULL;
+	}
+	return getEntry(pStoreKey->mShard, lIndex);
+}
+
+/*
+ * Same as allocateEntry() on a key, without raising any exception. Returns the index of the entry
+ * or STORE_EMPTY_SLOT if the shard is full.
+ */
+
+int32_t reserveKeyEntry(StoreKey* pStoreKey) {
+	return reserveKey(pStoreKey->mShard, pStoreKey->mKey, pStoreKey->mHash);
+}
+
+jlong makeHandle(StoreKey* pStoreKey, int32_t pIndex) {
+	if (pIndex == STORE_EMPTY_SLOT) {
+		return STORE_EMPTY_SLOT;
+	}
+	return makeEntryHandle(pStoreKey->mShard - pStoreKey->mInstance->mShards, pIndex, getEntry(pStoreKey->mShard, pIndex)->mGeneration);
+}
+
+jlong makeEntryHandle(int32_t pShard, int32_t pIndex, int32_t pGeneration) {
+	return ((jlong) pGeneration << 32) | ((jlong) pIndex << STORE_SHARD_BITS) | pShard;
+}
+
+/*
+ * Shard 0 is saved at mPath, shard i at mPath.i. Shards without a valid image start empty. Loaded
+ * values are recorded in the history, as if written.
+ */
+
+void loadInstance(StoreInstance* pInstance) {
+	int32_t i;
+	for (i = 0; i < pInstance->mShardCount; ++i) {
+		char* lPath = getShardPath(pInstance->mPath, i);
+		if (lPath != NULL) {
+			lockStoreWrite(&pInstance->mShards[i]);
+			loadStoreImage(&pInstance->mShards[i], lPath, i, pInstance->mShardCount);
+			publishStore(pInstance->mHistory, &pInstance->mShards[i]);
+			unlockStore(&pInstance->mShards[i]);
+			free(lPath);
+		}
+	}
+}
+
+/*
+ * Each shard is saved atomically under its read lock, but not all shards at once.
+ */
+
+int32_t saveInstance(StoreInstance* pInstance) {
+	int32_t lSaved = 1;
+	int32_t i;
+	for (i = 0; i < pInstance->mShardCount; ++i) {
+		char* lPath = getShardPath(pInstance->mPath, i);
+		if (lPath == NULL) {
+			lSaved = 0;
+			continue;
+		}
+		lockStoreRead(&pInstance->mShards[i]);
+		lSaved &= saveStoreImage(&pInstance->mShards[i], lPath, i, pInstance->mShardCount);
+		unlockStore(&pInstance->mShards[i]);
+		free(lPath);
+	}
+	return lSaved;
+}
+
+/*
+ * Whole-store operations lock every shard, always in the same order so that two of them cannot
+ * deadlock. Operations on a single key never hold more than one shard lock.
+ */
+
+void lockInstance(StoreInstance* pInstance, int32_t pWrite) {
+	int32_t i;
+	for (i = 0; i < pInstance->mShardCount; ++i) {
+		if (pWrite) {
+			lockStoreWrite(&pInstance->mShards[i]);
+		} else {
+			lockStoreRead(&pInstance->mShards[i]);
+		}
+	}
+}
+
+void unlockInstance(StoreInstance* pInstance) {
+	int32_t i;
+	for (i = pInstance->mShardCount - 1; i >= 0; --i) {
+		unlockStore(&pInstance->mShards[i]);
+	}
+}
+
+/*
+ * Position the cursor on the first key following pKey, or pKey itself if pInclusive, in each shard.
+ * A NULL pKey starts from the first key.
+ */
+
+void seekInstanceKeys(StoreInstance* pInstance, StoreKeyCursor* pCursor, const char* pKey, int32_t pInclusive) {
+	int32_t i;
+	for (i = 0; i < pInstance->mShardCount; ++i) {
+		pCursor->mNodes[i] = seekIndex(&pInstance->mShards[i].mKeyIndex, pKey, pInclusive);
+	}
+}
+
+/*
+ * Next key across all shards, the lowest of the keys the cursor is on in each shard, and its shard in
+ * pShard. Keys reserved without a value are skipped. Returns NULL once all keys were walked.
+ */
+
+StoreIndexNode* nextInstanceKey(StoreInstance* pInstance, StoreKeyCursor* pCursor, Store** pShard) {
+	for (;;) {
+		int32_t lLowest = -1;
+		int32_t i;
+		for (i = 0; i < pInstance->mShardCount; ++i) {
+			if ((pCursor->mNodes[i] != NULL)
+			 && ((lLowest < 0) || (strcmp(pCursor->mNodes[i]->mKey, pCursor->mNodes[lLowest]->mKey) < 0))) {
+				lLowest = i;
+			}
+		}
+		if (lLowest < 0) {
+			return NULL;
+		}
+
+		StoreIndexNode* lNode = pCursor->mNodes[lLowest];
+		pCursor->mNodes[lLowest] = lNode->mNext[0];
+		if (getEntry(&pInstance->mShards[lLowest], lNode->mEntry)->mType != StoreType_None) {
+			*pShard = &pInstance->mShards[lLowest];
+			return lNode;
+		}
+	}
+}
+
+/*
+ * Called after each write, once the shard lock is released: a reader which sees the new version
+ * and then takes the lock sees the new value.
+ */
+
+void publishWrite(StoreInstance* pInstance) {
+	__sync_fetch_and_add(getInstanceVersion(pInstance), 1);
+	notifyWatcher(&pInstance->mWatcher);
+}
+
+char* getShardPath(const char* pPath, int32_t pShard) {
+	size_t lSize = strlen(pPath) + 12;
+	char* lPath = (char*) malloc(lSize);
+	if (lPath != NULL) {
+		if (pShard == 0) {
+			strcpy(lPath, pPath);
+		} else {
+			snprintf(lPath, lSize, "%s.%d", pPath, (int) pShard);
+		}
+	}
+	return lPath;
+}
@@ -0,0 +1,110 @@
+#ifndef _STOREINSTANCE_H_
+#define _STOREINSTANCE_H_
+
+#include "jni.h"
+#include "Store.h"
+#include "StoreHistory.h"
+#include "StoreWatcher.h"
+#include <stdint.h>
+
+/*
+ * Native state of one Java Store, referenced from its mNativeStore field. Keys are spread over a
+ * power-of-two number of shards by the high bits of their hash, the low bits indexing the slot
+ * table of the shard. Each shard has its own lock, so writers to different shards do not contend.
+ *
+ * A handle packs the entry index with its shard number in the STORE_SHARD_BITS low bits, and the
+ * generation of the entry in its 32 high bits: once the key is removed, the handle resolves to no
+ * entry even if another key takes the entry.
+ */
+#define STORE_SHARD_BITS 6
+#define STORE_MAX_SHARDS (1 << STORE_SHARD_BITS)
+
+typedef struct {
+	Store* mShards;
+	int32_t mShardCount;
+	//Store image file of shard 0, NULL when the store lives in memory only
+	char* mPath;
+	StoreWatcher mWatcher;
+	//Slot referenced by mNativeStore, which holds the store version, see StoreInstanceSlot
+	int32_t mSlot;
+	//Values written to every shard, read by snapshots
+	StoreHistory* mHistory;
+#ifdef STORE_STATS
+	StoreStats* mStats;
+#endif
+} StoreInstance;
+
+/*
+ * mNativeStore references a slot by index, in its 32 low bits, and generation, in its 32 high bits.
+ * Slots are never freed, so a call racing with finalizeStore() always reads a slot, and finds that
+ * it is closing or that its generation moved on: it throws IllegalStateException instead of using a
+ * destroyed instance. Each native call pins the instance until it returns, and closing waits for the
+ * calls pinning it. Slots are allocated by chunks of STORE_SLOT_CHUNK, and reused once closed.
+ *
+ * The store version lives in the slot too, so that the direct ByteBuffer through which Java reads it
+ * never points to freed memory, even when read by a thread racing with finalizeStore().
+ */
+#define STORE_SLOT_CHUNK 64
+#define STORE_MAX_SLOT_CHUNKS 1024
+//Low bits of mState count the calls pinning the instance
+#define STORE_SLOT_CLOSING 0x80000000LL
+#define STORE_SLOT_USERS 0x7FFFFFFFLL
+
+typedef struct {
+	//Generation in the 32 high bits, then STORE_SLOT_CLOSING and STORE_SLOT_USERS
+	volatile int64_t mState;
+	StoreInstance* mInstance;
+	int32_t mNextFree;
+	//Incremented after each write, readable from Java through a direct ByteBuffer
+	volatile int32_t mVersion;
+} StoreInstanceSlot;
+
+/*
+ * A key converted from Java and routed to its shard, or a handle decoded. mKey is NULL for a
+ * handle.
+ */
+typedef struct {
+	StoreInstance* mInstance;
+	Store* mShard;
+	jstring mJavaKey;
+	const char* mKey;
+	uint32_t mHash;
+	int32_t mIndex;
+	int32_t mGeneration;
+} StoreKey;
+
+/*
+ * Ordered walk over the keys of all shards, which merges the index of each shard. The position in
+ * each index is kept, so the instance must stay locked while the cursor is in use.
+ */
+typedef struct {
+	StoreIndexNode* mNodes[STORE_MAX_SHARDS];
+} StoreKeyCursor;
+
+StoreInstance* createInstance(int32_t pShardCount);
+void destroyInstance(JNIEnv* pEnv, StoreInstance* pInstance);
+jlong registerInstance(StoreInstance* pInstance);
+StoreInstance* unregisterInstance(JNIEnv* pEnv, jobject pThis);
+StoreInstance* getInstance(JNIEnv* pEnv, jobject pThis);
+void releaseInstance(StoreInstance* pInstance);
+volatile int32_t* getInstanceVersion(StoreInstance* pInstance);
+int32_t openKey(JNIEnv* pEnv, jobject pThis, jstring pKey, StoreKey* pStoreKey);
+int32_t openInstanceKey(JNIEnv* pEnv, StoreInstance* pInstance, jstring pKey, StoreKey* pStoreKey);
+Store* getKeyShard(StoreInstance* pInstance, uint32_t pHash);
+int32_t openHandle(JNIEnv* pEnv, jobject pThis, jlong pHandle, StoreKey* pStoreKey);
+void closeKey(JNIEnv* pEnv, StoreKey* pStoreKey);
+void closeInstanceKey(JNIEnv* pEnv, StoreKey* pStoreKey);
+StoreEntry* findKeyEntry(StoreKey* pStoreKey);
+StoreEntry* allocateEntry(JNIEnv* pEnv, StoreKey* pStoreKey);
+StoreEntry* reserveEntry(JNIEnv* pEnv, StoreKey* pStoreKey);
+int32_t reserveKeyEntry(StoreKey* pStoreKey);
+jlong makeHandle(StoreKey* pStoreKey, int32_t pIndex);
+jlong makeEntryHandle(int32_t pShard, int32_t pIndex, int32_t pGeneration);
+void loadInstance(StoreInstance* pInstance);
+int32_t saveInstance(StoreInstance* pInstance);
+void lockInstance(StoreInstance* pInstance, int32_t pWrite);
+void unlockInstance(StoreInstance* pInstance);
+void publishWrite(StoreInstance* pInstance);
+void seekInstanceKeys(StoreInstance* pInstance, StoreKeyCursor* pCursor, const char* pKey, int32_t pInclusive);
+StoreIndexNode* nextInstanceKey(StoreInstance* pInstance, StoreKeyCursor* pCursor, Store** pShard);
+#endif
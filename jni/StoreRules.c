@@ -0,0 +1,228 @@
+#include "StoreRules.h"
+#include <stdlib.h>
+#include <string.h>
+
+void resetBindings(StoreRuleSet* pRuleSet);
+int32_t findRule(StoreRuleSet* pRuleSet, const char* pKey);
+void releaseRule(StoreRule* pRule);
+int32_t matchRuleString(StoreRule* pRule, StoreEntry* pEntry, int32_t pLength);
+
+/*
+ * Rules are only known to the watcher, so the set lives as long as it does. Returns 0 if out of
+ * memory, in which case the set must not be used.
+ */
+
+int32_t initializeRules(StoreRuleSet* pRuleSet, int32_t pShardCount) {
+	memset(pRuleSet, 0, sizeof(StoreRuleSet));
+	pRuleSet->mTables = calloc(pShardCount, sizeof(StoreBindingTable));
+	if (pRuleSet->mTables == NULL) {
+		return 0;
+	}
+	pRuleSet->mTableCount = pShardCount;
+	pthread_mutex_init(&pRuleSet->mMutex, NULL);
+	return 1;
+}
+
+void releaseRules(StoreRuleSet* pRuleSet) {
+	if (pRuleSet->mTables == NULL) {
+		return;
+	}
+	clearRules(pRuleSet);
+	int32_t i;
+	for (i = 0; i < pRuleSet->mTableCount; ++i) {
+		free(pRuleSet->mTables[i].mTimed);
+	}
+	free(pRuleSet->mTables);
+	free(pRuleSet->mRules);
+	pthread_mutex_destroy(&pRuleSet->mMutex);
+	memset(pRuleSet, 0, sizeof(StoreRuleSet));
+}
+
+/*
+ * Any change to the rules drops all bindings: entries are matched again, and evaluated, on next
+ * scan.
+ */
+
+void resetBindings(StoreRuleSet* pRuleSet) {
+	int32_t i;
+	for (i = 0; i < pRuleSet->mTableCount; ++i) {
+		pRuleSet->mTables[i].mMatched = 0;
+		pRuleSet->mTables[i].mTimedLength = 0;
+	}
+}
+
+/*
+ * Pattern and string are copied. Returns 0 if out of memory, or if the watcher did not start.
+ */
+
+int32_t addRule(StoreRuleSet* pRuleSet, StoreRuleType pType, const char* pPattern, int32_t pLow, int32_t pHigh, const jchar* pString, int32_t pStringLength) {
+	if (pRuleSet->mTables == NULL) {
+		return 0;
+	}
+	StoreRule lRule;
+	memset(&lRule, 0, sizeof(StoreRule));
+	lRule.mType = pType;
+	lRule.mLow = pLow;
+	lRule.mHigh = pHigh;
+	lRule.mPatternLength = strlen(pPattern);
+	if ((lRule.mPatternLength > 0) && (pPattern[lRule.mPatternLength - 1] == '*')) {
+		lRule.mPrefix = 1;
+		--lRule.mPatternLength;
+	}
+	lRule.mPattern = strndup(pPattern, lRule.mPatternLength);
+	if (pString != NULL) {
+		lRule.mStringLength = pStringLength;
+		//One more character so that empty strings are allocated too
+		lRule.mString = (jchar*) malloc((pStringLength + 1) * sizeof(jchar));
+		if (lRule.mString != NULL) {
+			memcpy(lRule.mString, pString, pStringLength * sizeof(jchar));
+		}
+	}
+	if ((lRule.mPattern == NULL) || ((pString != NULL) && (lRule.mString == NULL))) {
+		releaseRule(&lRule);
+		return 0;
+	}
+
+	pthread_mutex_lock(&pRuleSet->mMutex);
+	if (pRuleSet->mLength == pRuleSet->mCapacity) {
+		int32_t lCapacity = (pRuleSet->mCapacity > 0) ? pRuleSet->mCapacity * 2 : 8;
+		StoreRule* lRules = realloc(pRuleSet->mRules, lCapacity * sizeof(StoreRule));
+		if (lRules == NULL) {
+			pthread_mutex_unlock(&pRuleSet->mMutex);
+			releaseRule(&lRule);
+			return 0;
+		}
+		pRuleSet->mRules = lRules;
+		pRuleSet->mCapacity = lCapacity;
+	}
+	pRuleSet->mRules[pRuleSet->mLength++] = lRule;
+	resetBindings(pRuleSet);
+	pthread_mutex_unlock(&pRuleSet->mMutex);
+	return 1;
+}
+
+void clearRules(StoreRuleSet* pRuleSet) {
+	if (pRuleSet->mTables == NULL) {
+		return;
+	}
+	pthread_mutex_lock(&pRuleSet->mMutex);
+	int32_t i;
+	for (i = 0; i < pRuleSet->mLength; ++i) {
+		releaseRule(&pRuleSet->mRules[i]);
+	}
+	pRuleSet->mLength = 0;
+	resetBindings(pRuleSet);
+	pthread_mutex_unlock(&pRuleSet->mMutex);
+}
+
+void releaseRule(StoreRule* pRule) {
+	free(pRule->mPattern);
+	free(pRule->mString);
+}
+
+/*
+ * Returns the index of the most specific rule matching pKey, -1 if none does.
+ */
+
+int32_t findRule(StoreRuleSet* pRuleSet, const char* pKey) {
+	int32_t lBest = -1;
+	size_t lBestLength = 0;
+	int32_t i;
+	for (i = 0; i < pRuleSet->mLength; ++i) {
+		StoreRule* lRule = &pRuleSet->mRules[i];
+		if (!lRule->mPrefix) {
+			if (strcmp(pKey, lRule->mPattern) == 0) {
+				return i;
+			}
+		} else if (((lBest < 0) || (lRule->mPatternLength > lBestLength))
+				&& (strncmp(pKey, lRule->mPattern, lRule->mPatternLength) == 0)) {
+			lBest = i;
+			lBestLength = lRule->mPatternLength;
+		}
+	}
+	return lBest;
+}
+
+/*
+ * Matches entries appended to the shard since last call and queues those with a rule for
+ * evaluation. The key of an entry only changes when the entry is taken from the free list, in which
+ * case the entry is left unbound and written, and bound by the scan (see bindEntry()). So the store
+ * only needs to be locked for reading, by the watcher which owns the tables. Must be called with the
+ * rule set locked. Returns 0 if out of memory, in which case nothing is matched and the shard must
+ * not be scanned.
+ */
+
+int32_t bindEntries(StoreRuleSet* pRuleSet, int32_t pShard, Store* pStore) {
+	StoreBindingTable* lTable = &pRuleSet->mTables[pShard];
+	if (lTable->mTimedCapacity < pStore->mLength) {
+		StoreEntry** lTimed = realloc(lTable->mTimed, pStore->mLength * sizeof(StoreEntry*));
+		if (lTimed == NULL) {
+			return 0;
+		}
+		lTable->mTimed = lTimed;
+		lTable->mTimedCapacity = pStore->mLength;
+	}
+
+	for (; lTable->mMatched < pStore->mLength; ++lTable->mMatched) {
+		StoreEntry* lEntry = getEntry(pStore, lTable->mMatched);
+		bindEntry(pRuleSet, lEntry);
+		if (lEntry->mRule >= 0) {
+			markEntryDirty(pStore, lEntry);
+		}
+	}
+	return 1;
+}
+
+/*
+ * Removed entries have no key, hence no rule.
+ */
+
+void bindEntry(StoreRuleSet* pRuleSet, StoreEntry* pEntry) {
+	pEntry->mRule = ((pRuleSet->mLength > 0) && (pEntry->mKey != NULL)) ? findRule(pRuleSet, pEntry->mKey) : -1;
+}
+
+/*
+ * Timed entries collected during previous scan are queued with written ones, each entry being
+ * queued once.
+ */
+
+void queueTimedEntries(StoreRuleSet* pRuleSet, int32_t pShard, Store* pStore) {
+	StoreBindingTable* lTable = &pRuleSet->mTables[pShard];
+	int32_t i;
+	for (i = 0; i < lTable->mTimedLength; ++i) {
+		markEntryDirty(pStore, lTable->mTimed[i]);
+	}
+	lTable->mTimedLength = 0;
+}
+
+/*
+ * Whether pEntry is in alert according to pRule. An entry whose value is not of the type the rule
+ * expects is never in alert.
+ */
+
+int32_t evaluateRule(StoreRule* pRule, StoreEntry* pEntry) {
+	switch (pRule->mType) {
+	case StoreRule_IntegerOutside:
+		return (pEntry->mType == StoreType_Integer)
+			&& ((pEntry->mValue.mInteger < pRule->mLow) || (pEntry->mValue.mInteger > pRule->mHigh));
+	case StoreRule_StringEquals:
+		return (pEntry->mType == StoreType_String) && matchRuleString(pRule, pEntry, pEntry->mLength);
+	case StoreRule_StringDiffers:
+		return (pEntry->mType == StoreType_String) && !matchRuleString(pRule, pEntry, pEntry->mLength);
+	case StoreRule_StringPrefix:
+		return (pEntry->mType == StoreType_String) && matchRuleString(pRule, pEntry, pRule->mStringLength);
+	case StoreRule_ColorEquals:
+		return (pEntry->mType == StoreType_Color) && (pEntry->mValue.mColor == pRule->mLow);
+	default:
+		return 0;
+	}
+}
+
+/*
+ * Whether the first pLength characters of the entry are the whole rule string.
+ */
+
+int32_t matchRuleString(StoreRule* pRule, StoreEntry* pEntry, int32_t pLength) {
+	return (pRule->mStringLength == pLength) && (pEntry->mLength >= pLength)
+		&& (memcmp(pEntry->mValue.mString, pRule->mString, pLength * sizeof(jchar)) == 0);
+}
@@ -0,0 +1,76 @@
+#ifndef _STORERULES_H_
+#define _STORERULES_H_
+
+#include "Store.h"
+#include <stdint.h>
+#include <pthread.h>
+
+/*
+ * Conditions evaluated by the watcher, registered from Java. A rule applies to the keys matching its
+ * pattern: a pattern ending with '*' matches every key starting with what precedes it, any other
+ * pattern matches a single key. When several rules match a key, a key pattern wins over prefixes and
+ * a longer prefix over a shorter one. Among equals, the first registered wins.
+ *
+ * Keys are matched once, when the watcher first sees an entry after the rules changed, and the rule
+ * index is kept in the entry. Scans then only visit entries written since the previous scan (see
+ * touchEntry()) plus the timed ones: entries with a counter rule and, when alerts are rearmed,
+ * entries in alert. Entries without a rule are dropped as soon as they are visited.
+ */
+
+/*
+ * Values mirror the RULE_* constants of Store.java.
+ */
+typedef enum {
+	//Integer out of [mLow, mHigh]
+	StoreRule_IntegerOutside,
+	//String equal to, different from or starting with mString
+	StoreRule_StringEquals, StoreRule_StringDiffers, StoreRule_StringPrefix,
+	//Color equal to mLow
+	StoreRule_ColorEquals,
+	//Not an alert: integer incremented once per scan interval
+	StoreRule_Counter,
+	StoreRule_Count
+} StoreRuleType;
+
+typedef struct {
+	StoreRuleType mType;
+	//Key, or prefix without its '*'
+	char* mPattern;
+	size_t mPatternLength;
+	int32_t mPrefix;
+	int32_t mLow;
+	int32_t mHigh;
+	//UTF-16, as string values
+	jchar* mString;
+	int32_t mStringLength;
+} StoreRule;
+
+typedef struct {
+	//Entries of the shard already matched against the rules
+	int32_t mMatched;
+	//Entries to visit on next scan even if not written, at most one slot per entry
+	StoreEntry** mTimed;
+	int32_t mTimedLength;
+	int32_t mTimedCapacity;
+} StoreBindingTable;
+
+typedef struct {
+	StoreRule* mRules;
+	int32_t mLength;
+	int32_t mCapacity;
+	//One table per shard
+	StoreBindingTable* mTables;
+	int32_t mTableCount;
+	//Held by the watcher for a whole scan and by whoever changes the rules
+	pthread_mutex_t mMutex;
+} StoreRuleSet;
+
+int32_t initializeRules(StoreRuleSet* pRuleSet, int32_t pShardCount);
+void releaseRules(StoreRuleSet* pRuleSet);
+int32_t addRule(StoreRuleSet* pRuleSet, StoreRuleType pType, const char* pPattern, int32_t pLow, int32_t pHigh, const jchar* pString, int32_t pStringLength);
+void clearRules(StoreRuleSet* pRuleSet);
+int32_t bindEntries(StoreRuleSet* pRuleSet, int32_t pShard, Store* pStore);
+void bindEntry(StoreRuleSet* pRuleSet, StoreEntry* pEntry);
+void queueTimedEntries(StoreRuleSet* pRuleSet, int32_t pShard, Store* pStore);
+int32_t evaluateRule(StoreRule* pRule, StoreEntry* pEntry);
+#endif
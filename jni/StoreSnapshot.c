@@ -0,0 +1,120 @@
+#include "StoreSnapshot.h"
+#include <stdlib.h>
+#include <string.h>
+
+int32_t isSnapshotKey(StoreSnapshot* pSnapshot, const char* pKey);
+int compareSnapshotKeys(const void* pKey1, const void* pKey2);
+
+/*
+ * The instance is only needed to reach its history. Returns NULL if out of memory.
+ */
+
+StoreSnapshot* createSnapshot(StoreInstance* pInstance, const char* pPrefix) {
+	StoreSnapshot* lSnapshot = (StoreSnapshot*) calloc(1, sizeof(StoreSnapshot));
+	if (lSnapshot == NULL) {
+		return NULL;
+	}
+	if (pPrefix != NULL) {
+		if ((lSnapshot->mPrefix = strdup(pPrefix)) == NULL) {
+			free(lSnapshot);
+			return NULL;
+		}
+		lSnapshot->mPrefixLength = strlen(pPrefix);
+	}
+	if ((lSnapshot->mPin = pinHistory(pInstance->mHistory)) == NULL) {
+		free(lSnapshot->mPrefix);
+		free(lSnapshot);
+		return NULL;
+	}
+	lSnapshot->mStamp = lSnapshot->mPin->mStamp;
+	lSnapshot->mHistory = pInstance->mHistory;
+	retainHistory(lSnapshot->mHistory);
+	return lSnapshot;
+}
+
+/*
+ * Whether a write the snapshot should see could not be recorded, for lack of memory.
+ */
+
+int32_t isSnapshotLost(StoreSnapshot* pSnapshot) {
+	return isHistoryLost(pSnapshot->mHistory, pSnapshot->mStamp);
+}
+
+int32_t isSnapshotKey(StoreSnapshot* pSnapshot, const char* pKey) {
+	return (pSnapshot->mPrefix == NULL) || (strncmp(pKey, pSnapshot->mPrefix, pSnapshot->mPrefixLength) == 0);
+}
+
+/*
+ * Fills pView with the value of pKey at snapshot time. Returns NULL if pKey is out of the scope of
+ * the snapshot or had no value then.
+ */
+
+StoreEntry* findSnapshotEntry(StoreSnapshot* pSnapshot, const char* pKey, StoreEntry* pView) {
+	if (!isSnapshotKey(pSnapshot, pKey)) {
+		return NULL;
+	}
+	StoreHistoryKey* lKey = findHistoryKey(pSnapshot->mHistory, pKey);
+	StoreVersion* lVersion = (lKey != NULL) ? findVersion(lKey, pSnapshot->mStamp) : NULL;
+	if (lVersion == NULL) {
+		return NULL;
+	}
+	memset(pView, 0, sizeof(StoreEntry));
+	pView->mKey = lKey->mKey;
+	pView->mHash = lKey->mHash;
+	pView->mType = lVersion->mType;
+	pView->mValue = lVersion->mValue;
+	pView->mLength = lVersion->mLength;
+	pView->mCapacity = lVersion->mLength;
+	pView->mRule = -1;
+	return pView;
+}
+
+/*
+ * Sets pKeys to the keys of the snapshot in order, freed by the caller, which stay valid until the
+ * snapshot is released. Returns their count, or -1 if out of memory.
+ */
+
+int32_t findSnapshotKeys(StoreSnapshot* pSnapshot, const char*** pKeys) {
+	StoreHistoryTable* lTable = __atomic_load_n(&pSnapshot->mHistory->mTable, __ATOMIC_ACQUIRE);
+	int32_t lCapacity = 16;
+	int32_t lLength = 0;
+	const char** lKeys = (const char**) malloc(lCapacity * sizeof(const char*));
+	if (lKeys == NULL) {
+		return -1;
+	}
+	int32_t i;
+	for (i = 0; i < lTable->mCapacity; ++i) {
+		StoreHistoryKey* lKey = __atomic_load_n(&lTable->mKeys[i], __ATOMIC_ACQUIRE);
+		if ((lKey == NULL) || !isSnapshotKey(pSnapshot, lKey->mKey) || (findVersion(lKey, pSnapshot->mStamp) == NULL)) {
+			continue;
+		}
+		if (lLength == lCapacity) {
+			const char** lGrown = (const char**) realloc(lKeys, lCapacity * 2 * sizeof(const char*));
+			if (lGrown == NULL) {
+				free(lKeys);
+				return -1;
+			}
+			lKeys = lGrown;
+			lCapacity *= 2;
+		}
+		lKeys[lLength++] = lKey->mKey;
+	}
+	qsort(lKeys, lLength, sizeof(const char*), compareSnapshotKeys);
+	*pKeys = lKeys;
+	return lLength;
+}
+
+int compareSnapshotKeys(const void* pKey1, const void* pKey2) {
+	return strcmp(*(const char* const*) pKey1, *(const char* const*) pKey2);
+}
+
+/*
+ * The history is freed with the last snapshot once the store is finalized.
+ */
+
+void releaseSnapshot(StoreSnapshot* pSnapshot) {
+	unpinHistory(pSnapshot->mPin);
+	releaseHistory(pSnapshot->mHistory);
+	free(pSnapshot->mPrefix);
+	free(pSnapshot);
+}
@@ -0,0 +1,33 @@
+#ifndef _STORESNAPSHOT_H_
+#define _STORESNAPSHOT_H_
+
+#include "Store.h"
+#include "StoreHistory.h"
+#include "StoreInstance.h"
+#include <stdint.h>
+
+/*
+ * Read-only view of the keys of an instance, or of the keys starting with a prefix, as of the time
+ * it was taken. A snapshot is a pin on the version history of the instance, see StoreHistory.h:
+ * taking it copies nothing and locks nothing whatever the store size, reading it takes no lock, and
+ * writers never wait for it. It holds a reference on the history, so it outlives later writes, and
+ * even the store.
+ *
+ * Values are read as StoreEntry views on the versions pinned, which stay valid until the snapshot
+ * is released.
+ */
+typedef struct {
+	StoreHistory* mHistory;
+	StoreHistoryPin* mPin;
+	int64_t mStamp;
+	//NULL for the whole store
+	char* mPrefix;
+	size_t mPrefixLength;
+} StoreSnapshot;
+
+StoreSnapshot* createSnapshot(StoreInstance* pInstance, const char* pPrefix);
+int32_t isSnapshotLost(StoreSnapshot* pSnapshot);
+StoreEntry* findSnapshotEntry(StoreSnapshot* pSnapshot, const char* pKey, StoreEntry* pView);
+int32_t findSnapshotKeys(StoreSnapshot* pSnapshot, const char*** pKeys);
+void releaseSnapshot(StoreSnapshot* pSnapshot);
+#endif
@@ -0,0 +1,54 @@
+#include "StoreStats.h"
+#include <pthread.h>
+#include <string.h>
+#include <time.h>
+
+int64_t getStatsTime(void) {
+	struct timespec lNow;
+	clock_gettime(CLOCK_MONOTONIC, &lNow);
+	return (int64_t) lNow.tv_sec * 1000000000LL + lNow.tv_nsec;
+}
+
+/*
+ * Thread ids are addresses of thread structures, low bits are dropped as they are mostly aligned
+ * the same way. Statistics of stores which are not part of an instance are not recorded.
+ */
+
+void recordStat(StoreStats* pStats, StoreStat pStat, int64_t pValue) {
+	if (pStats == NULL) {
+		return;
+	}
+	uintptr_t lThread = (uintptr_t) pthread_self();
+	StoreHistogram* lHistogram = &pStats->mStripes[((lThread >> 4) ^ (lThread >> 12)) % STORE_STATS_STRIPES][pStat];
+
+	int32_t lBucket = 0;
+	if (pValue > 0) {
+		lBucket = 64 - __builtin_clzll((uint64_t) pValue);
+		if (lBucket >= STORE_STATS_BUCKETS) {
+			lBucket = STORE_STATS_BUCKETS - 1;
+		}
+	}
+	__sync_fetch_and_add(&lHistogram->mCount, 1);
+	__sync_fetch_and_add(&lHistogram->mSum, pValue);
+	__sync_fetch_and_add(&lHistogram->mBuckets[lBucket], 1);
+}
+
+/*
+ * pSnapshot must hold STORE_STATS_SIZE values.
+ */
+
+void snapshotStats(StoreStats* pStats, int64_t* pSnapshot) {
+	memset(pSnapshot, 0, STORE_STATS_SIZE * sizeof(int64_t));
+	int32_t lStripe, lStat, lBucket;
+	for (lStripe = 0; lStripe < STORE_STATS_STRIPES; ++lStripe) {
+		for (lStat = 0; lStat < StoreStat_Count; ++lStat) {
+			StoreHistogram* lHistogram = &pStats->mStripes[lStripe][lStat];
+			int64_t* lSnapshot = pSnapshot + lStat * STORE_STATS_STRIDE;
+			lSnapshot[0] += __sync_fetch_and_add(&lHistogram->mCount, 0);
+			lSnapshot[1] += __sync_fetch_and_add(&lHistogram->mSum, 0);
+			for (lBucket = 0; lBucket < STORE_STATS_BUCKETS; ++lBucket) {
+				lSnapshot[2 + lBucket] += __sync_fetch_and_add(&lHistogram->mBuckets[lBucket], 0);
+			}
+		}
+	}
+}
@@ -0,0 +1,66 @@
+#ifndef _STORESTATS_H_
+#define _STORESTATS_H_
+
+#include <stdint.h>
+
+/*
+ * Native instrumentation, compiled in when STORE_STATS is defined (see Android.mk). Each statistic
+ * is a histogram with power-of-two buckets: bucket 0 counts zero values and bucket i values in
+ * [2^(i-1), 2^i[, the last bucket absorbing anything larger. Durations are in nanoseconds.
+ *
+ * Updates are lock-free atomic additions. Histograms are striped: each thread updates the stripe
+ * picked from its id, so that concurrent threads rarely write to the same cache lines. Snapshots
+ * add all stripes up and may observe an update half applied.
+ *
+ * Without STORE_STATS, the macros below expand to nothing and no statistics memory is allocated.
+ */
+#define STORE_STATS_BUCKETS 32
+#define STORE_STATS_STRIPES 8
+
+/*
+ * Values mirror the STAT_* constants of Store.java.
+ */
+typedef enum {
+	StoreStat_GetInteger, StoreStat_SetInteger,
+	StoreStat_GetString, StoreStat_SetString,
+	StoreStat_GetColor, StoreStat_SetColor,
+	StoreStat_GetIntegerArray, StoreStat_SetIntegerArray, StoreStat_AggregateIntegerArray,
+	StoreStat_GetColorArray, StoreStat_SetColorArray,
+	StoreStat_GetBatch, StoreStat_SetBatch,
+	StoreStat_ResolveKey, StoreStat_EntryVersion,
+	//Slots probed per key lookup, not a duration
+	StoreStat_LookupProbes,
+	StoreStat_WatcherScan, StoreStat_WatcherLockWait, StoreStat_WatcherLockHold, StoreStat_WatcherCallback,
+	//Entries visited per shard scan, not a duration
+	StoreStat_WatcherScanSize,
+	StoreStat_Count
+} StoreStat;
+
+typedef struct {
+	int64_t mCount;
+	int64_t mSum;
+	int64_t mBuckets[STORE_STATS_BUCKETS];
+} StoreHistogram;
+
+typedef struct StoreStats {
+	StoreHistogram mStripes[STORE_STATS_STRIPES][StoreStat_Count];
+} StoreStats;
+
+//Snapshot layout: for each statistic, count, sum, then the buckets
+#define STORE_STATS_STRIDE (2 + STORE_STATS_BUCKETS)
+#define STORE_STATS_SIZE (StoreStat_Count * STORE_STATS_STRIDE)
+
+#ifdef STORE_STATS
+#define STATS_START(pStart) int64_t pStart = getStatsTime()
+#define STATS_RECORD(pStats, pStat, pStart) recordStat((pStats), (pStat), getStatsTime() - (pStart))
+#define STATS_VALUE(pStats, pStat, pValue) recordStat((pStats), (pStat), (pValue))
+#else
+#define STATS_START(pStart)
+#define STATS_RECORD(pStats, pStat, pStart)
+#define STATS_VALUE(pStats, pStat, pValue)
+#endif
+
+int64_t getStatsTime(void);
+void recordStat(StoreStats* pStats, StoreStat pStat, int64_t pValue);
+void snapshotStats(StoreStats* pStats, int64_t* pSnapshot);
+#endif
@@ -1,97 +1,33 @@
 #include "StoreWatcher.h"
-#include <unistd.h>
-
-void makeGlobalRef(JNIEnv* pEnv, jobject* pRef);
-void deleteGlobalRef(JNIEnv* pEnv, jobject* pRef);
-JNIEnv* getJNIEnv(JavaVM* pJavaVM);
+#include "StoreInstance.h"
+#include <errno.h>
+#include <string.h>
+#include <time.h>
 
 void* runWatcher(void* pArgs);
-void processEntry(JNIEnv* pEnv, StoreWatcher* pWatcher, StoreEntry* pEntry);
-void processEntryInt(JNIEnv* pEnv, StoreWatcher* pWatcher, StoreEntry* pEntry);
-void processEntryString(JNIEnv* pEnv, StoreWatcher* pWatcher, StoreEntry* pEntry);
-void processEntryColor(JNIEnv* pEnv, StoreWatcher* pWatcher, StoreEntry* pEntry);
+int32_t waitWatcher(StoreWatcher* pWatcher);
+void scanShard(StoreWatcher* pWatcher, int32_t pShard);
+void processEntry(StoreWatcher* pWatcher, int32_t pShard, Store* pStore, StoreEntry* pEntry, StoreRule* pRule);
+int32_t shouldAlert(StoreWatcher* pWatcher, StoreEntry* pEntry, int32_t pCondition);
 
 /*
- * startWatcher is called from the UI thread to initialize and start the watcher. Thus this is
- * a perfect place to cache JNI descriptors. Actually, this is almost one of the only places
- * because as the UI thread is a Java thread, we have total access to the application class
- * loader. But if we were trying to cache them inside the native thread, the latter would have
- * access only to the system class loader and nothing else.
- *
- * To get a field value, one needs to get its containing class description and its field descriptor
- * before actually retrieving its value. To call a method, one needs to retrieve class descriptor
- * and method descriptor before calling the method with the necessary parameters. The process is
- * always the same.
- *
- * Caching is the only solution to communicate with native threads, which do not have access to
- * the application class loader. Instead of caching classes, methods, and fields, simply cache the
- * application class loader itself.
+ * startWatcher is called from the UI thread to initialize and start the watcher. The watcher never
+ * calls into Java: alerts are queued in mAlerts, which a Java thread drains. The native thread is
+ * therefore not even attached to the VM.
  */
 
-void startWatcher(JNIEnv* pEnv, StoreWatcher* pWatcher, Store* pStore, jobject pStoreFront) {
+void startWatcher(StoreWatcher* pWatcher, Store* pShards, int32_t pShardCount, int32_t pScanInterval, int32_t pRearmInterval) {
 	//Erase
 	memset(pWatcher, 0, sizeof(StoreWatcher));
-	pWatcher->mState = STATE_OK;
-	pWatcher->mStore = pStore;
-
-	//Cache the VM
-	if ((*pEnv)->GetJavaVM(pEnv, &pWatcher->mJavaVM) != JNI_OK) {
-		goto ERROR;
-	}
-
-	//Cache classes
-	pWatcher->ClassStore = (*pEnv)->FindClass(pEnv, "za/co/technodev/javajni/Store");
-	makeGlobalRef(pEnv, &pWatcher->ClassStore);
-	if(pWatcher->ClassStore == NULL) {
-		goto ERROR;
-	}
-
-	pWatcher->ClassColor = (*pEnv)->FindClass(pEnv, "za/co/technodev/javajni/Color");
-	makeGlobalRef(pEnv, &pWatcher->ClassColor);
-	if(pWatcher->ClassColor == NULL) {
-		goto ERROR;
-	}
-
-	//Cache Java methods
-	pWatcher->MethodOnAlertInt = (*pEnv)->GetMethodID(pEnv, pWatcher->ClassStore, "onAlert", "(I)V");
-	if(pWatcher->MethodOnAlertInt == NULL) {
-		goto ERROR;
-	}
-
-	pWatcher->MethodOnAlertString = (*pEnv)->GetMethodID(pEnv, pWatcher->ClassStore, "onAlert", "(Ljava/lang/String;)V");
-	if(pWatcher->MethodOnAlertString == NULL) {
-		goto ERROR;
-	}
-
-	pWatcher->MethodOnAlertColor = (*pEnv)->GetMethodID(pEnv, pWatcher->ClassStore, "onAlert", "(Lza/co/technodev/javajni/Color;)V");
-	if(pWatcher->MethodOnAlertColor == NULL) {
-		goto ERROR;
-	}
-
-	pWatcher->MethodColorEquals = (*pEnv)->GetMethodID(pEnv, pWatcher->ClassColor, "equals", "(Ljava/lang/Object;)Z");
-	if(pWatcher->MethodColorEquals == NULL) {
-		goto ERROR;
-	}
-
-	jmethodID ConstructorColor = (*pEnv)->GetMethodID(pEnv, pWatcher->ClassColor, "<init>", "(Ljava/lang/String;)V");
-	if(ConstructorColor == NULL) {
-		goto ERROR;
-	}
-
-	//Cache objects
-	pWatcher->mStoreFront = (*pEnv)->NewGlobalRef(pEnv, pStoreFront);
-	if(pWatcher->mStoreFront == NULL) {
-		goto ERROR;
-	}
-
-	jstring lColor = (*pEnv)->NewStringUTF(pEnv, "white");
-	if (lColor == NULL) {
-		goto ERROR;
-	}
-
-	pWatcher->mColor = (*pEnv)->NewObject(pEnv, pWatcher->ClassColor, ConstructorColor, lColor);
-	makeGlobalRef(pEnv, &pWatcher->mColor);
-	if(pWatcher->mColor == NULL) {
+	pWatcher->mShards = pShards;
+	pWatcher->mShardCount = pShardCount;
+	pWatcher->mScanInterval = (pScanInterval > 0) ? pScanInterval : DEFAULT_SCAN_INTERVAL;
+	pWatcher->mRearmInterval = pRearmInterval;
+	struct timespec lNow;
+	clock_gettime(CLOCK_MONOTONIC, &lNow);
+	pWatcher->mTickTime = (int64_t) lNow.tv_sec * 1000 + lNow.tv_nsec / 1000000;
+	if (!initializeRules(&pWatcher->mRules, pShardCount)
+	 || !initializeAlertRing(&pWatcher->mAlerts, STORE_ALERT_CAPACITY)) {
 		goto ERROR;
 	}
 
@@ -102,170 +38,251 @@ void startWatcher(JNIEnv* pEnv, StoreWatcher* pWatcher, Store* pStore, jobject p
 		goto ERROR;
 	}
 
+	pthread_mutex_init(&pWatcher->mMutex, NULL);
+	pthread_cond_init(&pWatcher->mCondition, NULL);
+	pWatcher->mState = STATE_OK;
 	lError = pthread_create(&pWatcher->mThread, &lAttributes, runWatcher, pWatcher);
+	pthread_attr_destroy(&lAttributes);
 	if (lError) {
+		pWatcher->mState = STATE_KO;
+		pthread_cond_destroy(&pWatcher->mCondition);
+		pthread_mutex_destroy(&pWatcher->mMutex);
 		goto ERROR;
 	}
 	return;
 
 ERROR:
-	stopWatcher(pEnv, pWatcher);
+	stopWatcher(pWatcher);
 	return;
 }
 
 /*
- * watcher thread is native which means that no JNI environment is attached. It is not instantiated by Java.
- * the native thread is attached to the VM with AttachCurrentThread() in order to retrieve a JNIEnv.
- * JNIEnv is specific to current thread and cannot be shared with others (opposite with JavaVM). Internally
- * the VM builds a new Thread object and adds it to the main thread group, like any other Java thread.
+ * Instead of sleeping a fixed duration, the watcher waits on a condition variable until either the
+ * scan interval elapses, a write is notified or a stop is requested. A whole scan happens under a
+ * single shared acquisition of each shard lock: Java readers keep running in parallel and only
+ * writers wait for the scan to end. Rules cannot change during a scan. Alerts of the scan are
+ * published once all locks are released.
  */
 
-JNIEnv* getJNIEnv(JavaVM* pJavaVM) {
-	JavaVMAttachArgs lJavaVMAttachArgs;
-	lJavaVMAttachArgs.version = JNI_VERSION_1_6;
-	lJavaVMAttachArgs.name = "NativeThread";
-	lJavaVMAttachArgs.group = NULL;
+void* runWatcher(void* pArgs) {
+	StoreWatcher* lWatcher = (StoreWatcher*) pArgs;
+	while (waitWatcher(lWatcher)) {
+		struct timespec lNow;
+		clock_gettime(CLOCK_MONOTONIC, &lNow);
+		lWatcher->mScanTime = (int64_t) lNow.tv_sec * 1000 + lNow.tv_nsec / 1000000;
+		lWatcher->mTick = (lWatcher->mScanTime - lWatcher->mTickTime >= lWatcher->mScanInterval);
+		if (lWatcher->mTick) {
+			lWatcher->mTickTime = lWatcher->mScanTime;
+		}
+		STATS_START(lScanStart);
 
-	JNIEnv* lEnv;
-	if ((*pJavaVM)->AttachCurrentThread(pJavaVM, &lEnv, &lJavaVMAttachArgs) != JNI_OK) {
-		lEnv = NULL;
+		//One shard locked at a time, writers to other shards are not blocked
+		pthread_mutex_lock(&lWatcher->mRules.mMutex);
+		int32_t lShard;
+		for (lShard = 0; (lWatcher->mState == STATE_OK) && (lShard < lWatcher->mShardCount); ++lShard) {
+			scanShard(lWatcher, lShard);
+		}
+		pthread_mutex_unlock(&lWatcher->mRules.mMutex);
+		STATS_RECORD(lWatcher->mShards->mStats, StoreStat_WatcherScan, lScanStart);
+		publishAlerts(&lWatcher->mAlerts);
 	}
-	return lEnv;
+	pthread_exit(NULL);
 }
 
 /*
- * critical section is delimited with a JNI monitor which has exactly the same properties as the synchronized
- * keyword in java. An attached thread which dies must eventually detach from the VM so that the latter can
- * release resources properly.
+ * Only entries written since last scan, new entries matching a rule and timed entries are visited.
+ * An idle shard costs nothing beyond taking its lock. Entries left when the watcher stops are
+ * dropped. Keys cannot be removed while the shard is locked; entries removed since last scan are
+ * queued like written ones and simply dropped, the next key taking the entry being bound anew.
  */
 
-void* runWatcher(void* pArgs) {
-	StoreWatcher* lWatcher = (StoreWatcher*) pArgs;
-	Store* lStore = lWatcher->mStore;
-	JavaVM* lJavaVM = lWatcher->mJavaVM;
-
-	JNIEnv* lEnv = getJNIEnv(lJavaVM);
-	if (lEnv == NULL) {
-		goto ERROR;
+void scanShard(StoreWatcher* pWatcher, int32_t pShard) {
+	Store* lStore = &pWatcher->mShards[pShard];
+	StoreBindingTable* lTable = &pWatcher->mRules.mTables[pShard];
+	//Critical section
+	STATS_START(lWaitStart);
+	lockStoreRead(lStore);
+	STATS_RECORD(lStore->mStats, StoreStat_WatcherLockWait, lWaitStart);
+	STATS_START(lHoldStart);
+	if (bindEntries(&pWatcher->mRules, pShard, lStore)) {
+		queueTimedEntries(&pWatcher->mRules, pShard, lStore);
+		STATS_VALUE(lStore->mStats, StoreStat_WatcherScanSize, lStore->mDirtyLength);
+		int32_t i;
+		for (i = 0; (pWatcher->mState == STATE_OK) && (i < lStore->mDirtyLength); ++i) {
+			StoreEntry* lEntry = lStore->mDirty[i];
+			lEntry->mDirty = 0;
+			if (lEntry->mType == StoreType_Removed) {
+				continue;
+			}
+			if (lEntry->mRule == STORE_UNBOUND_RULE) {
+				bindEntry(&pWatcher->mRules, lEntry);
+			}
+			if (lEntry->mRule < 0) {
+				continue;
+			}
+			StoreRule* lRule = &pWatcher->mRules.mRules[lEntry->mRule];
+			processEntry(pWatcher, pShard, lStore, lEntry, lRule);
+			if ((lRule->mType == StoreRule_Counter) || (lEntry->mAlerted && (pWatcher->mRearmInterval > 0))) {
+				lTable->mTimed[lTable->mTimedLength++] = lEntry;
+			}
+		}
+		for (; i < lStore->mDirtyLength; ++i) {
+			lStore->mDirty[i]->mDirty = 0;
+		}
+		lStore->mDirtyLength = 0;
 	}
+	STATS_RECORD(lStore->mStats, StoreStat_WatcherLockHold, lHoldStart);
+	//Critical section end
+	unlockStore(lStore);
+}
 
-	int32_t lRunning = 1;
-	while (lRunning) {
-		sleep(SLEEP_DURATION);
-
-		StoreEntry* lEntry = lWatcher->mStore->mEntries;
-		int32_t lScanning = 1;
-		while(lScanning) {
-			//Critical section
-			(*lEnv)->MonitorEnter(lEnv, lWatcher->mStoreFront);
-			lRunning = (lWatcher->mState == STATE_OK);
-			StoreEntry* lEntryEnd = lWatcher->mStore->mEntries + lWatcher->mStore->mLength;
-			lScanning = (lEntry < lEntryEnd);
+/*
+ * Blocks until next scan is due, a scan interval after the last counter tick: scans woken up by
+ * writes do not postpone it. Spurious wake-ups only cause an early scan. Returns 0 when the
+ * watcher is stopping.
+ */
 
-			if (lRunning & lScanning) {
-				processEntry(lEnv, lWatcher, lEntry);
-			}
+int32_t waitWatcher(StoreWatcher* pWatcher) {
+	struct timespec lNow;
+	clock_gettime(CLOCK_MONOTONIC, &lNow);
+	int64_t lDelay = pWatcher->mTickTime + pWatcher->mScanInterval - ((int64_t) lNow.tv_sec * 1000 + lNow.tv_nsec / 1000000);
+	if (lDelay < 0) {
+		lDelay = 0;
+	}
+	struct timespec lDeadline;
+	clock_gettime(CLOCK_REALTIME, &lDeadline);
+	lDeadline.tv_sec += lDelay / 1000;
+	lDeadline.tv_nsec += (lDelay % 1000) * 1000000L;
+	if (lDeadline.tv_nsec >= 1000000000L) {
+		++lDeadline.tv_sec;
+		lDeadline.tv_nsec -= 1000000000L;
+	}
 
-			//Critical section end
-			(*lEnv)->MonitorExit(lEnv, lWatcher->mStoreFront);
-			++lEntry;
-		}
+	pthread_mutex_lock(&pWatcher->mMutex);
+	int lError = 0;
+	while ((pWatcher->mState == STATE_OK) && !pWatcher->mPending && (lError != ETIMEDOUT)) {
+		lError = pthread_cond_timedwait(&pWatcher->mCondition, &pWatcher->mMutex, &lDeadline);
 	}
+	pWatcher->mPending = 0;
+	int32_t lRunning = (pWatcher->mState == STATE_OK);
+	pthread_mutex_unlock(&pWatcher->mMutex);
+	return lRunning;
+}
 
-ERROR:
-	(*lJavaVM)->DetachCurrentThread(lJavaVM);
-	pthread_exit(NULL);
+/*
+ * Called after each write. Several writes before the watcher wakes up result in a single scan, in
+ * which case the mutex is not even taken.
+ */
+
+void notifyWatcher(StoreWatcher* pWatcher) {
+	if ((pWatcher->mState == STATE_OK) && !pWatcher->mPending) {
+		pthread_mutex_lock(&pWatcher->mMutex);
+		pWatcher->mPending = 1;
+		pthread_cond_signal(&pWatcher->mCondition);
+		pthread_mutex_unlock(&pWatcher->mMutex);
+	}
 }
 
 /*
- * To invoke a Java method on a Java object, simply use CallVoidMethod() on a JNI environment.
- * This means that the called Java method returns void. If Java method was returning an int,
- * we would call CallIntMethod(). Like with the reflection API, invoking a Java method method
- * requires:
- *
- * An object instance (except for static methods, in which case we would provide a class instance
- * and use CallStaticVoidMethod().
- *
- * A method descriptor
- *
- * Parameters (if applicable, here an integer value).
+ * An alert is queued as the handle of the entry with its value, or its version for a string, which
+ * Java reads through the handle. Only the time to queue it is recorded as StoreStat_WatcherCallback.
  */
 
-void processEntry(JNIEnv* pEnv, StoreWatcher* pWatcher, StoreEntry* pEntry) {
+void processEntry(StoreWatcher* pWatcher, int32_t pShard, Store* pStore, StoreEntry* pEntry, StoreRule* pRule) {
+	if (pRule->mType == StoreRule_Counter) {
+		if (pWatcher->mTick && (pEntry->mType == StoreType_Integer)) {
+			//Store is only locked for reading here, the entry is not queued as dirty again
+			__sync_fetch_and_add(&pEntry->mValue.mInteger, 1);
+			__sync_fetch_and_add(&pEntry->mVersion, 1);
+			//Writers are excluded, the watcher is the only one to publish the entry meanwhile
+			if (pStore->mHistory != NULL) {
+				publishEntry(pStore->mHistory, pEntry, 0);
+			}
+		}
+		return;
+	}
+	if (!shouldAlert(pWatcher, pEntry, evaluateRule(pRule, pEntry))) {
+		return;
+	}
+
+	int32_t lValue;
 	switch(pEntry->mType) {
 	case StoreType_Integer:
-		processEntryInt(pEnv, pWatcher, pEntry);
+		lValue = pEntry->mValue.mInteger;
 		break;
 	case StoreType_String:
-		processEntryString(pEnv, pWatcher, pEntry);
+		lValue = pEntry->mVersion;
 		break;
 	case StoreType_Color:
-		processEntryColor(pEnv, pWatcher, pEntry);
+		lValue = pEntry->mValue.mColor;
 		break;
+	default:
+		return;
 	}
-}
-
-void processEntryInt(JNIEnv* pEnv, StoreWatcher* pWatcher, StoreEntry* pEntry) {
-	if(strcmp(pEntry->mKey, "watcherCounter") == 0) {
-		++pEntry->mValue.mInteger;
-	} else if ((pEntry->mValue.mInteger > 1000) || (pEntry->mValue.mInteger < -1000)) {
-		(*pEnv)->CallVoidMethod(pEnv, pWatcher->mStoreFront, pWatcher->MethodOnAlertInt, (jint) pEntry->mValue.mInteger);
+	STATS_START(lCallStart);
+	jlong lHandle = makeEntryHandle(pShard, pEntry->mIndex, pEntry->mGeneration);
+	if (pushAlert(&pWatcher->mAlerts, lHandle, pEntry->mType, lValue)) {
+		__sync_fetch_and_add(&pWatcher->mAlertsQueued, 1);
 	}
+	STATS_RECORD(pStore->mStats, StoreStat_WatcherCallback, lCallStart);
 }
 
 /*
- * Strings require allocating a new Java string. We do not need to generate a global reference as it is
- * used immediately in the Java callback. We can release the local reference right after it is used. In
- * a classic JNI method, local references are deleted when method returns, here we are in an attached
- * native thread. Thus, local references would get deleted only when thread is detached (that is, when
- * activity leaves). JNI memory would leak meanwhile
+ * Alerts are edge-triggered: an entry is reported when it enters the alert condition, not on every
+ * scan while it stays in it. If a rearm interval is set, an entry which is still in alert is reported
+ * again once the interval has elapsed. Alert state is only touched by the watcher thread, so the
+ * shared store lock is enough.
  */
 
-void processEntryString(JNIEnv* pEnv, StoreWatcher* pWatcher, StoreEntry* pEntry) {
-	if(strcmp(pEntry->mValue.mString, "apple")) {
-		jstring lValue = (*pEnv)->NewStringUTF(pEnv, pENtry->mValue.mString);
-		(*pEnv)->CallVoidMethod(pEnv, pWatcher->mStoreFront, pWatcher->MethodOnAlertString, lValue);
-		(*pEnv)->DeleteLocalRef(pEnv, lValue);
+int32_t shouldAlert(StoreWatcher* pWatcher, StoreEntry* pEntry, int32_t pCondition) {
+	if (!pCondition) {
+		pEntry->mAlerted = 0;
+		return 0;
 	}
-}
-
-/*
- * Check if a color is identical to the reference color, invoke the equality method provided by Java
- * and reimplemented in our Color class.
- */
 
-void processEntryColor(JNIEnv* pEnv, StoreWatcher* pWatcher, StoreEntry* pEntry) {
-	jboolean lResult = (*pEnv)->CallBooleanMethod(pEnv, pWatcher->mColor, pWatcher->MethodColorEquals, pEntry->mValue.mColor);
-	if(lResult) {
-		(*pEnv)->CallVoidMethod(pEnv, pWatcher->mStoreFront, pWatcher->MethodOnAlertColor, pEntry->mValue.mColor);
+	if (!pEntry->mAlerted
+	 || ((pWatcher->mRearmInterval > 0) && (pWatcher->mScanTime - pEntry->mAlertTime >= pWatcher->mRearmInterval))) {
+		pEntry->mAlerted = 1;
+		pEntry->mAlertTime = pWatcher->mScanTime;
+		return 1;
+	} else {
+		__sync_fetch_and_add(&pWatcher->mAlertsSuppressed, 1);
+		return 0;
 	}
 }
 
-void makeGlobalRef(JNIEnv* pEnv, jobject* pRef) {
-	if (*pRef != NULL) {
-		jobject lGlobalRef = (*pEnv)->NewGlobalRef(pEnv, *pRef);
-		(*pEnv)->DeleteLocalRef(pEnv, *pRef);
-		*pRef = lGlobalRef;
-	}
+int64_t getAlertsQueued(StoreWatcher* pWatcher) {
+	return __sync_fetch_and_add(&pWatcher->mAlertsQueued, 0);
 }
 
-void deleteGlobalRef(JNIEnv* pEnv, jobject* pRef) {
-	if (*pRef != NULL) {
-		(*pEnv)->DeleteGlobalRef(pEnv, *pRef);
-		*pRef = NULL;
-	}
+int64_t getAlertsSuppressed(StoreWatcher* pWatcher) {
+	return __sync_fetch_and_add(&pWatcher->mAlertsSuppressed, 0);
+}
+
+/*
+ * Alerts which did not fit in the ring. They count neither as queued nor as suppressed.
+ */
+
+int64_t getAlertsDropped(StoreWatcher* pWatcher) {
+	return (pWatcher->mAlerts.mBuffer != NULL) ? __atomic_load_n(&pWatcher->mAlerts.mBuffer->mDropped, __ATOMIC_RELAXED) : 0;
 }
 
- void stopWatcher(JNIEnv* pEnv, StoreWatcher* pWatcher) {
+/*
+ * The stop request wakes the watcher up immediately, so joining it only waits for the end of the
+ * current scan, if any.
+ */
+
+ void stopWatcher(StoreWatcher* pWatcher) {
 	 if (pWatcher->mState == STATE_OK) {
-		 (*pEnv)->MonitorEnter(pEnv, pWatcher->mStoreFront);
+		 pthread_mutex_lock(&pWatcher->mMutex);
 		 pWatcher->mState = STATE_KO;
-		 (*pEnv)->MonitorExit(pEnv, pWatcher->mStoreFront);
+		 pthread_cond_signal(&pWatcher->mCondition);
+		 pthread_mutex_unlock(&pWatcher->mMutex);
 		 pthread_join(pWatcher->mThread, NULL);
 
-		 deleteGlobalRef(pEnv, &pWatcher->mStoreFront);
-		 deleteGlobalRef(pEnv, &pWatcher->mColor);
-		 deleteGlobalRef(pEnv, &pWatcher->ClassStore);
-		 deleteGlobalRef(pEnv, &pWatcher->ClassColor);
+		 pthread_cond_destroy(&pWatcher->mCondition);
+		 pthread_mutex_destroy(&pWatcher->mMutex);
 	 }
+	 releaseRules(&pWatcher->mRules);
+	 releaseAlertRing(&pWatcher->mAlerts);
  }
@@ -2,34 +2,47 @@
 #define _STOREWATCHER_H_
 
 #include "Store.h"
-#include <jni.h>
+#include "StoreAlerts.h"
+#include "StoreRules.h"
 #include <stdint.h>
 #include <pthread.h>
 
-#define SLEEP_DURATION 5
-#define STATE_OK 0
-#define STATE_KO 1
+//Milliseconds between two scans when no write wakes the watcher up
+#define DEFAULT_SCAN_INTERVAL 5000
+//A zeroed watcher is a stopped watcher
+#define STATE_KO 0
+#define STATE_OK 1
 
 typedef struct {
-	//Native variables
-	Store* mStore;
-	//Cached JNI references
-	JavaVM* mJavaVM;
-	jobject mStoreFront;
-	jobject mColor;
-	//Classes
-	jclass ClassStore;
-	jclass ClassColor;
-	//Methods
-	jmethodID MethodOnAlertInt;
-	jmethodID MethodOnAlertString;
-	jmethodID MethodOnAlertColor;
-	jmethodID MethodColorEquals;
+	//Native variables, shards watched one after the other
+	Store* mShards;
+	int32_t mShardCount;
+	//Entries without a rule are ignored
+	StoreRuleSet mRules;
+	//Alerts waiting for Java
+	StoreAlertRing mAlerts;
 	//Thread variables
 	pthread_t mThread;
-	int32_t mState;
+	volatile int32_t mState;
+	//Wake-up, mState and mPending are modified under mMutex
+	pthread_mutex_t mMutex;
+	pthread_cond_t mCondition;
+	volatile int32_t mPending;
+	int32_t mScanInterval;
+	//Alert deduplication
+	int32_t mRearmInterval;
+	int64_t mScanTime;
+	//Counters only tick on scans due to the scan interval, not on those woken up by writes
+	int64_t mTickTime;
+	int32_t mTick;
+	int64_t mAlertsQueued;
+	int64_t mAlertsSuppressed;
 } StoreWatcher;
 
-void startWatcher(JNIEnv* pEnv, StoreWatcher* pWatcher, Store* pStore, jobject pStoreFront);
-void stopWatcher(JNIEnv* pEnv, StoreWatcher* pWatcher);
+void startWatcher(StoreWatcher* pWatcher, Store* pShards, int32_t pShardCount, int32_t pScanInterval, int32_t pRearmInterval);
+void stopWatcher(StoreWatcher* pWatcher);
+void notifyWatcher(StoreWatcher* pWatcher);
+int64_t getAlertsQueued(StoreWatcher* pWatcher);
+int64_t getAlertsSuppressed(StoreWatcher* pWatcher);
+int64_t getAlertsDropped(StoreWatcher* pWatcher);
 #endif
@@ -1,101 +1,845 @@
 #include "za_co_technodev_javajni_Store.h"
 #include "Store.h"
-#include "StoreWatcher.h"
+#include "StoreAggregate.h"
+#include "StoreCache.h"
+#include "StoreExport.h"
+#include "StoreInstance.h"
+#include "StoreSnapshot.h"
+#include "StoreStats.h"
 #include <stdint.h>
+#include <stdlib.h>
 #include <string.h>
 
-static Store gStore = { {}, 0 };
-static Store mStore;
-static StoreWatcher mStoreWatcher;
+typedef enum {
+	IntegerArrayAggregate_Sum, IntegerArrayAggregate_Min, IntegerArrayAggregate_Max,
+	IntegerArrayAggregate_Count, IntegerArrayAggregate_IndexOf
+} IntegerArrayAggregate;
+
+//Bounds of a page of keys, see readKeyPage()
+typedef struct {
+	const char* mFrom;
+	int32_t mInclusive;
+	const char* mTo;
+	const char* mPrefix;
+	size_t mPrefixLength;
+} StorePageScope;
+
+int32_t commitEntry(JNIEnv* pEnv, Store* pStore, StoreEntry* pEntry, StoreEntry* pValue);
+jint readInteger(JNIEnv* pEnv, StoreEntry* pEntry);
+jstring readString(JNIEnv* pEnv, Store* pStore, StoreEntry* pEntry);
+int32_t prepareString(JNIEnv* pEnv, jstring pString, StoreEntry* pValue);
+jobject readColor(JNIEnv* pEnv, StoreEntry* pEntry);
+int32_t prepareColor(JNIEnv* pEnv, jobject pColor, StoreEntry* pValue);
+jintArray readIntegerArray(JNIEnv* pEnv, StoreEntry* pEntry);
+int32_t prepareIntegerArray(JNIEnv* pEnv, jintArray pIntegerArray, StoreEntry* pValue);
+int32_t updateIntegerArray(JNIEnv* pEnv, Store* pStore, StoreEntry* pEntry, jintArray pIntegerArray);
+jobject readIntegerArrayBuffer(JNIEnv* pEnv, Store* pStore, StoreEntry* pEntry);
+int32_t appendIntegerArray(JNIEnv* pEnv, Store* pStore, StoreEntry* pEntry, jintArray pIntegerArray);
+int32_t isRegionValid(JNIEnv* pEnv, StoreEntry* pEntry, jint pOffset, jint pLength);
+jintArray readIntegerArrayRegion(JNIEnv* pEnv, StoreEntry* pEntry, jint pOffset, jint pLength);
+int32_t updateIntegerArrayRegion(JNIEnv* pEnv, Store* pStore, StoreEntry* pEntry, jint pOffset, jintArray pIntegerArray);
+jlong aggregateIntegerArray(JNIEnv* pEnv, StoreEntry* pEntry, IntegerArrayAggregate pAggregate, jint pArg1, jint pArg2);
+jintArray readIntegerArrayHistogram(JNIEnv* pEnv, StoreEntry* pEntry, jint pLow, jint pHigh, jint pBucketCount);
+jobjectArray readColorArray(JNIEnv* pEnv, StoreEntry* pEntry);
+int32_t prepareColorArray(JNIEnv* pEnv, jobjectArray pColorArray, StoreEntry* pValue);
+int32_t openBatchKey(JNIEnv* pEnv, StoreInstance* pInstance, jobjectArray pKeys, jsize pIndex, StoreKey* pStoreKey);
+void closeBatchKey(JNIEnv* pEnv, StoreKey* pStoreKey);
+void switchShard(Store** pLocked, Store* pShard, int32_t pWrite);
+StoreEntry* allocateBatchEntry(JNIEnv* pEnv, StoreKey* pStoreKey, int32_t* pStatus);
+StoreEntry* reserveBatchEntry(JNIEnv* pEnv, StoreKey* pStoreKey, int32_t* pStatus);
+void writeStatus(JNIEnv* pEnv, jintArray pStatus, int32_t* pStatusTmp, jsize pLength);
+char* getBufferRegion(JNIEnv* pEnv, jobject pBuffer, jint pOffset, jint pLength);
+int32_t checkSnapshot(JNIEnv* pEnv, StoreSnapshot* pSnapshot);
+StoreEntry* openSnapshotKey(JNIEnv* pEnv, jlong pSnapshot, jstring pKey, StoreEntry* pView, int32_t* pOpened);
+StoreEntry* nextPageEntry(StoreInstance* pInstance, StoreKeyCursor* pCursor, const StorePageScope* pScope);
+jint copyKeyPage(StoreInstance* pInstance, const StorePageScope* pScope, jsize pLength, int32_t pValues, StoreEntry** pPage);
 
 /*
- * mInteger which is a C int can be casted directly to a Java jint primitive and vice versa
+ * Every accessor exists in two flavors: by key, which converts and looks up the jstring on each
+ * call, and by handle, which was resolved once with resolveKey(). Both are opened as a StoreKey,
+ * which routes them to their shard in the StoreInstance of the Java object, and share the same
+ * read and prepare helpers below.
+ *
+ * Setters prepare the new value first in a temporary entry, then reserve the target entry and
+ * commit the value into it, which releases the previous value. If reservation fails, the prepared
+ * value is released instead. Strings are the exception: the prepared value only holds a weak
+ * reference to the Java string, whose characters are copied into the store arena on commit. If the
+ * arena is full, the previous value is kept.
+ *
+ * Java methods are not synchronized: readers take the shard lock shared and writers exclusive.
+ * Values are prepared, and Java objects and references created, outside the write lock to keep it
+ * short: only GetStringRegion(), a plain copy, and the release of replaced weak references run
+ * under it. Each write wakes the watcher up once the lock is released.
+ */
+
+int32_t commitEntry(JNIEnv* pEnv, Store* pStore, StoreEntry* pEntry, StoreEntry* pValue) {
+	if (pValue->mType == StoreType_String) {
+		//Allocated while the previous value is still in place, so that it is kept if the arena is full
+		jchar* lChars = (pEntry != NULL) ? allocateChars(pStore, pValue->mLength) : NULL;
+		if (lChars == NULL) {
+			(*pEnv)->DeleteWeakGlobalRef(pEnv, pValue->mJavaString);
+			return pEntry == NULL;
+		}
+		(*pEnv)->GetStringRegion(pEnv, (jstring) pValue->mJavaString, 0, pValue->mLength, lChars);
+		pValue->mValue.mString = lChars;
+	} else if (pEntry == NULL) {
+		releaseEntryValue(pEnv, pStore, pValue);
+		return 1;
+	}
+
+	releaseEntryValue(pEnv, pStore, pEntry);
+	pEntry->mType = pValue->mType;
+	pEntry->mValue = pValue->mValue;
+	pEntry->mLength = pValue->mLength;
+	pEntry->mCapacity = pValue->mLength;
+	if (pValue->mType == StoreType_String) {
+		//The string just written is as good as a string read
+		pEntry->mJavaString = pValue->mJavaString;
+	}
+	touchEntry(pStore, pEntry);
+	return 1;
+}
+
+JNIEXPORT jlong JNICALL Java_za_co_technodev_javajni_Store_resolveKey
+  (JNIEnv* pEnv, jobject pThis, jstring pKey) {
+	StoreKey lKey;
+	if (!openKey(pEnv, pThis, pKey, &lKey)) {
+		return STORE_EMPTY_SLOT;
+	}
+	STATS_START(lStart);
+	lockStoreWrite(lKey.mShard);
+	jlong lHandle = makeHandle(&lKey, reserveKeyEntry(&lKey));
+	unlockStore(lKey.mShard);
+	STATS_RECORD(lKey.mInstance->mStats, StoreStat_ResolveKey, lStart);
+	closeKey(pEnv, &lKey);
+	if (lHandle == STORE_EMPTY_SLOT) {
+		throwStoreFullException(pEnv);
+	}
+	return lHandle;
+}
+
+/*
+ * Removal is by key only: a handle could name a key which is not the caller's anymore.
+ */
+
+JNIEXPORT jboolean JNICALL Java_za_co_technodev_javajni_Store_removeKey
+  (JNIEnv* pEnv, jobject pThis, jstring pKey) {
+	StoreKey lKey;
+	if (!openKey(pEnv, pThis, pKey, &lKey)) {
+		return JNI_FALSE;
+	}
+	lockStoreWrite(lKey.mShard);
+	int32_t lRemoved = removeKey(pEnv, lKey.mShard, lKey.mKey, lKey.mHash);
+	unlockStore(lKey.mShard);
+	publishWrite(lKey.mInstance);
+	closeKey(pEnv, &lKey);
+	return lRemoved ? JNI_TRUE : JNI_FALSE;
+}
+
+JNIEXPORT jint JNICALL Java_za_co_technodev_javajni_Store_removeKeys
+  (JNIEnv* pEnv, jobject pThis, jobjectArray pKeys) {
+	StoreInstance* lInstance = getInstance(pEnv, pThis);
+	if (lInstance == NULL) {
+		return 0;
+	}
+	jsize lLength = (*pEnv)->GetArrayLength(pEnv, pKeys);
+	jint lRemoved = 0;
+	jsize i;
+	Store* lLocked = NULL;
+	for (i = 0; i < lLength; ++i) {
+		StoreKey lKey;
+		if (openBatchKey(pEnv, lInstance, pKeys, i, &lKey)) {
+			switchShard(&lLocked, lKey.mShard, 1);
+			lRemoved += removeKey(pEnv, lKey.mShard, lKey.mKey, lKey.mHash);
+			closeBatchKey(pEnv, &lKey);
+		} else if ((*pEnv)->ExceptionCheck(pEnv)) {
+			break;
+		}
+	}
+	if (lLocked != NULL) {
+		unlockStore(lLocked);
+	}
+	publishWrite(lInstance);
+	releaseInstance(lInstance);
+	return lRemoved;
+}
+
+/*
+ * Shards are cleared one after the other, a reader may see some of them cleared and not others.
+ */
+
+JNIEXPORT void JNICALL Java_za_co_technodev_javajni_Store_clearNativeStore
+  (JNIEnv* pEnv, jobject pThis) {
+	StoreInstance* lInstance = getInstance(pEnv, pThis);
+	if (lInstance == NULL) {
+		return;
+	}
+	int32_t i;
+	for (i = 0; i < lInstance->mShardCount; ++i) {
+		lockStoreWrite(&lInstance->mShards[i]);
+		clearStore(pEnv, &lInstance->mShards[i]);
+		unlockStore(&lInstance->mShards[i]);
+	}
+	publishWrite(lInstance);
+	releaseInstance(lInstance);
+}
+
+/*
+ * Next entry with a value in the scope of the page, or NULL past the last one.
+ */
+
+StoreEntry* nextPageEntry(StoreInstance* pInstance, StoreKeyCursor* pCursor, const StorePageScope* pScope) {
+	Store* lShard;
+	StoreIndexNode* lNode = nextInstanceKey(pInstance, pCursor, &lShard);
+	if ((lNode == NULL) || ((pScope->mTo != NULL) && (strcmp(lNode->mKey, pScope->mTo) >= 0))
+	 || ((pScope->mPrefix != NULL) && (strncmp(lNode->mKey, pScope->mPrefix, pScope->mPrefixLength) != 0))) {
+		return NULL;
+	}
+	return getEntry(lShard, lNode->mEntry);
+}
+
+/*
+ * Copies up to pLength keys in scope, with their values if pValues, into a single block of entries
+ * followed by their arrays, strings and keys, as a snapshot does. Keys are walked twice under the
+ * same locks: once to size the block, once to copy it. Returns the number of keys copied, with
+ * *pPage to be freed if any, or -1 if out of memory.
+ */
+
+jint copyKeyPage(StoreInstance* pInstance, const StorePageScope* pScope, jsize pLength, int32_t pValues, StoreEntry** pPage) {
+	StoreKeyCursor lCursor;
+	StoreEntry* lEntry;
+	*pPage = NULL;
+	lockInstance(pInstance, 0);
+
+	jint lCount = 0;
+	size_t lArraySize = 0;
+	size_t lStringSize = 0;
+	size_t lKeySize = 0;
+	seekInstanceKeys(pInstance, &lCursor, pScope->mFrom, pScope->mInclusive);
+	while ((lCount < pLength) && ((lEntry = nextPageEntry(pInstance, &lCursor, pScope)) != NULL)) {
+		++lCount;
+		lKeySize += strlen(lEntry->mKey) + 1;
+		if (!pValues) {
+			continue;
+		}
+		if (lEntry->mType == StoreType_String) {
+			lStringSize += lEntry->mLength * sizeof(jchar);
+		} else if ((lEntry->mType == StoreType_IntegerArray) || (lEntry->mType == StoreType_ColorArray)) {
+			lArraySize += lEntry->mLength * sizeof(int32_t);
+		}
+	}
+	if (lCount == 0) {
+		unlockInstance(pInstance);
+		return 0;
+	}
+
+	StoreEntry* lPage = (StoreEntry*) malloc(lCount * sizeof(StoreEntry) + lArraySize + lStringSize + lKeySize);
+	if (lPage == NULL) {
+		unlockInstance(pInstance);
+		return -1;
+	}
+	char* lArrays = (char*) (lPage + lCount);
+	char* lStrings = lArrays + lArraySize;
+	char* lKeys = lStrings + lStringSize;
+	seekInstanceKeys(pInstance, &lCursor, pScope->mFrom, pScope->mInclusive);
+	jint i;
+	for (i = 0; i < lCount; ++i) {
+		lEntry = nextPageEntry(pInstance, &lCursor, pScope);
+		StoreEntry* lCopy = &lPage[i];
+		memset(lCopy, 0, sizeof(StoreEntry));
+		size_t lKeyLength = strlen(lEntry->mKey) + 1;
+		lCopy->mKey = (char*) memcpy(lKeys, lEntry->mKey, lKeyLength);
+		lKeys += lKeyLength;
+		if (!pValues) {
+			continue;
+		}
+		lCopy->mType = lEntry->mType;
+		lCopy->mLength = lEntry->mLength;
+		lCopy->mCapacity = lEntry->mLength;
+		switch (lEntry->mType) {
+		case StoreType_String:
+			lCopy->mValue.mString = (jchar*) memcpy(lStrings, lEntry->mValue.mString, lEntry->mLength * sizeof(jchar));
+			lStrings += lEntry->mLength * sizeof(jchar);
+			break;
+		case StoreType_IntegerArray:
+		case StoreType_ColorArray:
+			lCopy->mValue.mIntegerArray = (int32_t*) memcpy(lArrays, lEntry->mValue.mIntegerArray, lEntry->mLength * sizeof(int32_t));
+			lArrays += lEntry->mLength * sizeof(int32_t);
+			break;
+		default:
+			lCopy->mValue = lEntry->mValue;
+			break;
+		}
+	}
+	unlockInstance(pInstance);
+	*pPage = lPage;
+	return lCount;
+}
+
+/*
+ * Fills pKeys, from its first element, with the keys following pFrom in order, pFrom itself included
+ * if pInclusive, up to pTo excluded and as long as they start with pPrefix. Null bounds and prefix
+ * do not restrict the keys. Unless pTypes is null, the type of each value goes in pTypes, as a
+ * StoreType, and the value in pIntegers for integers or pObjects otherwise.
+ *
+ * All shards are read locked while the page is copied natively, so that it is consistent, but not
+ * between pages. Java strings and arrays are only created from the copy, once the locks are
+ * released. Returns the number of keys read, fewer than the length of pKeys once the last key was
+ * read, or -1 with an exception pending.
+ */
+
+JNIEXPORT jint JNICALL Java_za_co_technodev_javajni_Store_readKeyPage
+  (JNIEnv* pEnv, jobject pThis, jstring pFrom, jboolean pInclusive, jstring pTo, jstring pPrefix, jobjectArray pKeys, jintArray pTypes, jintArray pIntegers, jobjectArray pObjects) {
+	StoreInstance* lInstance = getInstance(pEnv, pThis);
+	if (lInstance == NULL) {
+		return -1;
+	}
+	jsize lLength = (*pEnv)->GetArrayLength(pEnv, pKeys);
+	if (lLength == 0) {
+		releaseInstance(lInstance);
+		return 0;
+	}
+	StorePageScope lScope;
+	lScope.mFrom = (pFrom != NULL) ? (*pEnv)->GetStringUTFChars(pEnv, pFrom, NULL) : NULL;
+	lScope.mInclusive = pInclusive;
+	lScope.mTo = (pTo != NULL) ? (*pEnv)->GetStringUTFChars(pEnv, pTo, NULL) : NULL;
+	lScope.mPrefix = (pPrefix != NULL) ? (*pEnv)->GetStringUTFChars(pEnv, pPrefix, NULL) : NULL;
+	lScope.mPrefixLength = (lScope.mPrefix != NULL) ? strlen(lScope.mPrefix) : 0;
+	jint lCount = -1;
+	StoreEntry* lPage = NULL;
+	if (((pFrom != NULL) && (lScope.mFrom == NULL)) || ((pTo != NULL) && (lScope.mTo == NULL))
+	 || ((pPrefix != NULL) && (lScope.mPrefix == NULL))) {
+		goto RELEASE;
+	}
+
+	lCount = copyKeyPage(lInstance, &lScope, lLength, pTypes != NULL, &lPage);
+	if (lCount < 0) {
+		throwIllegalStateException(pEnv, "Cannot allocate page");
+		goto RELEASE;
+	}
+	jint i;
+	for (i = 0; i < lCount; ++i) {
+		StoreEntry* lEntry = &lPage[i];
+		jstring lKey = (*pEnv)->NewStringUTF(pEnv, lEntry->mKey);
+		if (lKey == NULL) {
+			lCount = -1;
+			break;
+		}
+		(*pEnv)->SetObjectArrayElement(pEnv, pKeys, i, lKey);
+		(*pEnv)->DeleteLocalRef(pEnv, lKey);
+		if (pTypes == NULL) {
+			continue;
+		}
+
+		jint lType = lEntry->mType;
+		jint lValue = 0;
+		jobject lObject = NULL;
+		switch (lEntry->mType) {
+		case StoreType_Integer:
+			lValue = lEntry->mValue.mInteger;
+			break;
+		case StoreType_String:
+			lObject = (*pEnv)->NewString(pEnv, lEntry->mValue.mString, lEntry->mLength);
+			break;
+		case StoreType_Color:
+			lObject = readColor(pEnv, lEntry);
+			break;
+		case StoreType_IntegerArray:
+			lObject = readIntegerArray(pEnv, lEntry);
+			break;
+		case StoreType_ColorArray:
+			lObject = readColorArray(pEnv, lEntry);
+			break;
+		default:
+			break;
+		}
+		if ((*pEnv)->ExceptionCheck(pEnv)) {
+			lCount = -1;
+			break;
+		}
+		(*pEnv)->SetIntArrayRegion(pEnv, pTypes, i, 1, &lType);
+		(*pEnv)->SetIntArrayRegion(pEnv, pIntegers, i, 1, &lValue);
+		(*pEnv)->SetObjectArrayElement(pEnv, pObjects, i, lObject);
+		(*pEnv)->DeleteLocalRef(pEnv, lObject);
+	}
+RELEASE:
+	if (lScope.mFrom != NULL) {
+		(*pEnv)->ReleaseStringUTFChars(pEnv, pFrom, lScope.mFrom);
+	}
+	if (lScope.mTo != NULL) {
+		(*pEnv)->ReleaseStringUTFChars(pEnv, pTo, lScope.mTo);
+	}
+	if (lScope.mPrefix != NULL) {
+		(*pEnv)->ReleaseStringUTFChars(pEnv, pPrefix, lScope.mPrefix);
+	}
+	free(lPage);
+	releaseInstance(lInstance);
+	return lCount;
+}
+
+/*
+ * Snapshots are read without any lock, see StoreSnapshot.h. They only depend on the instance while
+ * they are created and may be read, and released, after finalizeStore(). Reading a snapshot that
+ * does not have the key throws NotExistingKeyException, as the store would have at snapshot time.
+ * A snapshot which missed a write, for lack of memory, throws IllegalStateException when read.
+ */
+
+JNIEXPORT jlong JNICALL Java_za_co_technodev_javajni_Store_createSnapshot
+  (JNIEnv* pEnv, jobject pThis, jstring pPrefix) {
+	StoreInstance* lInstance = getInstance(pEnv, pThis);
+	if (lInstance == NULL) {
+		return 0;
+	}
+	const char* lPrefix = (pPrefix != NULL) ? (*pEnv)->GetStringUTFChars(pEnv, pPrefix, NULL) : NULL;
+	if ((pPrefix != NULL) && (lPrefix == NULL)) {
+		releaseInstance(lInstance);
+		return 0;
+	}
+	StoreSnapshot* lSnapshot = createSnapshot(lInstance, lPrefix);
+	releaseInstance(lInstance);
+	if (lPrefix != NULL) {
+		(*pEnv)->ReleaseStringUTFChars(pEnv, pPrefix, lPrefix);
+	}
+	if (lSnapshot == NULL) {
+		throwIllegalStateException(pEnv, "Cannot allocate snapshot");
+	}
+	return (jlong) (intptr_t) lSnapshot;
+}
+
+JNIEXPORT void JNICALL Java_za_co_technodev_javajni_Store_releaseSnapshot
+  (JNIEnv* pEnv, jobject pThis, jlong pSnapshot) {
+	releaseSnapshot((StoreSnapshot*) (intptr_t) pSnapshot);
+}
+
+/*
+ * Returns 0, with an exception pending, if the snapshot missed a write.
+ */
+
+int32_t checkSnapshot(JNIEnv* pEnv, StoreSnapshot* pSnapshot) {
+	if (isSnapshotLost(pSnapshot)) {
+		throwIllegalStateException(pEnv, "Snapshot missed a write");
+		return 0;
+	}
+	return 1;
+}
+
+/*
+ * Fills pView with the value of the key. Returns NULL, with an exception pending, if the key could
+ * not be converted or the snapshot missed a write.
+ */
+
+StoreEntry* openSnapshotKey(JNIEnv* pEnv, jlong pSnapshot, jstring pKey, StoreEntry* pView, int32_t* pOpened) {
+	StoreSnapshot* lSnapshot = (StoreSnapshot*) (intptr_t) pSnapshot;
+	*pOpened = 0;
+	if (!checkSnapshot(pEnv, lSnapshot)) {
+		return NULL;
+	}
+	const char* lKey = (*pEnv)->GetStringUTFChars(pEnv, pKey, NULL);
+	if (lKey == NULL) {
+		return NULL;
+	}
+	StoreEntry* lEntry = findSnapshotEntry(lSnapshot, lKey, pView);
+	(*pEnv)->ReleaseStringUTFChars(pEnv, pKey, lKey);
+	*pOpened = 1;
+	return lEntry;
+}
+
+JNIEXPORT jint JNICALL Java_za_co_technodev_javajni_Store_getSnapshotInteger
+  (JNIEnv* pEnv, jobject pThis, jlong pSnapshot, jstring pKey) {
+	StoreEntry lView;
+	int32_t lOpened;
+	StoreEntry* lEntry = openSnapshotKey(pEnv, pSnapshot, pKey, &lView, &lOpened);
+	return lOpened ? readInteger(pEnv, lEntry) : 0;
+}
+
+JNIEXPORT jstring JNICALL Java_za_co_technodev_javajni_Store_getSnapshotString
+  (JNIEnv* pEnv, jobject pThis, jlong pSnapshot, jstring pKey) {
+	StoreEntry lView;
+	int32_t lOpened;
+	StoreEntry* lEntry = openSnapshotKey(pEnv, pSnapshot, pKey, &lView, &lOpened);
+	if (!lOpened || !isEntryValid(pEnv, lEntry, StoreType_String)) {
+		return NULL;
+	}
+	return (*pEnv)->NewString(pEnv, lEntry->mValue.mString, lEntry->mLength);
+}
+
+JNIEXPORT jobject JNICALL Java_za_co_technodev_javajni_Store_getSnapshotColor
+  (JNIEnv* pEnv, jobject pThis, jlong pSnapshot, jstring pKey) {
+	StoreEntry lView;
+	int32_t lOpened;
+	StoreEntry* lEntry = openSnapshotKey(pEnv, pSnapshot, pKey, &lView, &lOpened);
+	return lOpened ? readColor(pEnv, lEntry) : NULL;
+}
+
+JNIEXPORT jintArray JNICALL Java_za_co_technodev_javajni_Store_getSnapshotIntegerArray
+  (JNIEnv* pEnv, jobject pThis, jlong pSnapshot, jstring pKey) {
+	StoreEntry lView;
+	int32_t lOpened;
+	StoreEntry* lEntry = openSnapshotKey(pEnv, pSnapshot, pKey, &lView, &lOpened);
+	return lOpened ? readIntegerArray(pEnv, lEntry) : NULL;
+}
+
+JNIEXPORT jobjectArray JNICALL Java_za_co_technodev_javajni_Store_getSnapshotColorArray
+  (JNIEnv* pEnv, jobject pThis, jlong pSnapshot, jstring pKey) {
+	StoreEntry lView;
+	int32_t lOpened;
+	StoreEntry* lEntry = openSnapshotKey(pEnv, pSnapshot, pKey, &lView, &lOpened);
+	return lOpened ? readColorArray(pEnv, lEntry) : NULL;
+}
+
+/*
+ * Keys of the snapshot, in order.
+ */
+
+JNIEXPORT jobjectArray JNICALL Java_za_co_technodev_javajni_Store_getSnapshotKeys
+  (JNIEnv* pEnv, jobject pThis, jlong pSnapshot) {
+	StoreSnapshot* lSnapshot = (StoreSnapshot*) (intptr_t) pSnapshot;
+	if (!checkSnapshot(pEnv, lSnapshot)) {
+		return NULL;
+	}
+	const char** lSnapshotKeys;
+	int32_t lLength = findSnapshotKeys(lSnapshot, &lSnapshotKeys);
+	if (lLength < 0) {
+		throwIllegalStateException(pEnv, "Cannot allocate keys");
+		return NULL;
+	}
+	jobjectArray lKeys = (*pEnv)->NewObjectArray(pEnv, lLength, gStoreCache.ClassString, NULL);
+	int32_t i;
+	for (i = 0; (lKeys != NULL) && (i < lLength); ++i) {
+		jstring lKey = (*pEnv)->NewStringUTF(pEnv, lSnapshotKeys[i]);
+		if (lKey == NULL) {
+			lKeys = NULL;
+			break;
+		}
+		(*pEnv)->SetObjectArrayElement(pEnv, lKeys, i, lKey);
+		(*pEnv)->DeleteLocalRef(pEnv, lKey);
+	}
+	free(lSnapshotKeys);
+	return lKeys;
+}
+
+/*
+ * Versions let Store.java keep the Java objects it materialized and skip native calls while
+ * nothing changes. The store version is read straight from native memory through a direct
+ * ByteBuffer, entry versions are only queried once the store version has moved. Returns -1 for a
+ * key which is not in the store.
  */
 
-JNIEXPORT jint JNICALL Java_za_co_technodev_javajni_Store_getInteger
+JNIEXPORT jint JNICALL Java_za_co_technodev_javajni_Store_getEntryVersion__Ljava_lang_String_2
   (JNIEnv* pEnv, jobject pThis, jstring pKey) {
-	StoreEntry* lEntry = findEntry(pEnv, &gStore, pKey, NULL);
-	if (isEntryValid(pEnv, lEntry, StoreType_Integer)) {
-		return lEntry->mValue.mInteger;
+	StoreKey lKey;
+	if (!openKey(pEnv, pThis, pKey, &lKey)) {
+		return -1;
+	}
+	STATS_START(lStart);
+	lockStoreRead(lKey.mShard);
+	StoreEntry* lEntry = findKeyEntry(&lKey);
+	jint lVersion = (lEntry != NULL) ? lEntry->mVersion : -1;
+	unlockStore(lKey.mShard);
+	STATS_RECORD(lKey.mInstance->mStats, StoreStat_EntryVersion, lStart);
+	closeKey(pEnv, &lKey);
+	return lVersion;
+}
+
+JNIEXPORT jint JNICALL Java_za_co_technodev_javajni_Store_getEntryVersion__J
+  (JNIEnv* pEnv, jobject pThis, jlong pHandle) {
+	StoreKey lKey;
+	if (!openHandle(pEnv, pThis, pHandle, &lKey)) {
+		return -1;
+	}
+	STATS_START(lStart);
+	lockStoreRead(lKey.mShard);
+	StoreEntry* lEntry = findKeyEntry(&lKey);
+	jint lVersion = (lEntry != NULL) ? lEntry->mVersion : -1;
+	unlockStore(lKey.mShard);
+	STATS_RECORD(lKey.mInstance->mStats, StoreStat_EntryVersion, lStart);
+	closeKey(pEnv, &lKey);
+	return lVersion;
+}
+
+JNIEXPORT jobject JNICALL Java_za_co_technodev_javajni_Store_getVersionBuffer
+  (JNIEnv* pEnv, jobject pThis) {
+	StoreInstance* lInstance = getInstance(pEnv, pThis);
+	if (lInstance == NULL) {
+		return NULL;
+	}
+	jobject lBuffer = (*pEnv)->NewDirectByteBuffer(pEnv, (void*) getInstanceVersion(lInstance), sizeof(int32_t));
+	releaseInstance(lInstance);
+	return lBuffer;
+}
+
+/*
+ * mInteger which is a C int can be casted directly to a Java jint primitive and vice versa
+ */
+
+jint readInteger(JNIEnv* pEnv, StoreEntry* pEntry) {
+	if (isEntryValid(pEnv, pEntry, StoreType_Integer)) {
+		return pEntry->mValue.mInteger;
 	} else {
-		return 0.0f;
+		return 0;
+	}
+}
+
+JNIEXPORT jint JNICALL Java_za_co_technodev_javajni_Store_getInteger__Ljava_lang_String_2
+  (JNIEnv* pEnv, jobject pThis, jstring pKey) {
+	StoreKey lKey;
+	if (!openKey(pEnv, pThis, pKey, &lKey)) {
+		return 0;
 	}
+	STATS_START(lStart);
+	lockStoreRead(lKey.mShard);
+	jint lResult = readInteger(pEnv, findKeyEntry(&lKey));
+	unlockStore(lKey.mShard);
+	STATS_RECORD(lKey.mInstance->mStats, StoreStat_GetInteger, lStart);
+	closeKey(pEnv, &lKey);
+	return lResult;
 }
 
-JNIEXPORT void JNICALL Java_za_co_technodev_javajni_Store_setInteger
+JNIEXPORT jint JNICALL Java_za_co_technodev_javajni_Store_getInteger__J
+  (JNIEnv* pEnv, jobject pThis, jlong pHandle) {
+	StoreKey lKey;
+	if (!openHandle(pEnv, pThis, pHandle, &lKey)) {
+		return 0;
+	}
+	STATS_START(lStart);
+	lockStoreRead(lKey.mShard);
+	jint lResult = readInteger(pEnv, findKeyEntry(&lKey));
+	unlockStore(lKey.mShard);
+	STATS_RECORD(lKey.mInstance->mStats, StoreStat_GetInteger, lStart);
+	closeKey(pEnv, &lKey);
+	return lResult;
+}
+
+JNIEXPORT void JNICALL Java_za_co_technodev_javajni_Store_setInteger__Ljava_lang_String_2I
   (JNIEnv* pEnv, jobject pThis, jstring pKey, jint pInteger) {
-	StoreEntry* lEntry = allocateEntry(pEnv, &gStore, pKey);
+	StoreKey lKey;
+	if (!openKey(pEnv, pThis, pKey, &lKey)) {
+		return;
+	}
+	STATS_START(lStart);
+	lockStoreWrite(lKey.mShard);
+	StoreEntry* lEntry = allocateEntry(pEnv, &lKey);
+	if (lEntry != NULL) {
+		lEntry->mType = StoreType_Integer;
+		lEntry->mValue.mInteger = pInteger;
+		touchEntry(lKey.mShard, lEntry);
+	}
+	unlockStore(lKey.mShard);
+	STATS_RECORD(lKey.mInstance->mStats, StoreStat_SetInteger, lStart);
+	publishWrite(lKey.mInstance);
+	closeKey(pEnv, &lKey);
+}
+
+JNIEXPORT void JNICALL Java_za_co_technodev_javajni_Store_setInteger__JI
+  (JNIEnv* pEnv, jobject pThis, jlong pHandle, jint pInteger) {
+	StoreKey lKey;
+	if (!openHandle(pEnv, pThis, pHandle, &lKey)) {
+		return;
+	}
+	STATS_START(lStart);
+	lockStoreWrite(lKey.mShard);
+	StoreEntry* lEntry = allocateEntry(pEnv, &lKey);
 	if (lEntry != NULL) {
 		lEntry->mType = StoreType_Integer;
 		lEntry->mValue.mInteger = pInteger;
+		touchEntry(lKey.mShard, lEntry);
 	}
+	unlockStore(lKey.mShard);
+	STATS_RECORD(lKey.mInstance->mStats, StoreStat_SetInteger, lStart);
+	publishWrite(lKey.mInstance);
+	closeKey(pEnv, &lKey);
 }
 
 /*
- * Java strings are not real primitives. Types jstring and char* cannot be used interchangeably
- * To create a Java string object from a C string, use NewStringUTF()
- * To convert a Java string into a C string, use GetStringUTFChars() and SetStringUTFChars()
- *
+ * Java strings are not real primitives. Types jstring and char* cannot be used interchangeably.
+ * Values are kept in UTF-16, as in Java, rather than in the modified UTF-8 of GetStringUTFChars()
+ * and NewStringUTF(): GetStringRegion() and NewString() copy characters without any conversion.
+ * Java strings themselves are reused while still alive, see newEntryString().
+ */
+
+jstring readString(JNIEnv* pEnv, Store* pStore, StoreEntry* pEntry) {
+	if (isEntryValid(pEnv, pEntry, StoreType_String)) {
+		return newEntryString(pEnv, pStore, pEntry);
+	} else {
+		return NULL;
+	}
+}
+
+/*
+ * The weak reference is used to copy the characters on commit, which is safe as long as the caller
+ * holds pString. Returns 0 with an exception pending if out of memory.
  */
 
-JNIEXPORT jstring JNICALL Java_za_co_technodev_javajni_Store_getString
+int32_t prepareString(JNIEnv* pEnv, jstring pString, StoreEntry* pValue) {
+	pValue->mType = StoreType_String;
+	pValue->mLength = (*pEnv)->GetStringLength(pEnv, pString);
+	pValue->mJavaString = (*pEnv)->NewWeakGlobalRef(pEnv, pString);
+	return pValue->mJavaString != NULL;
+}
+
+JNIEXPORT jstring JNICALL Java_za_co_technodev_javajni_Store_getString__Ljava_lang_String_2
   (JNIEnv* pEnv, jobject pThis, jstring pKey) {
-	StoreEntry* lEntry = findEntry(pEnv, &gStore, pKey, NULL);
-	if (isEntryValid(pEnv, lEntry, StoreType_String)) {
-		return (*pEnv)->NewStringUTF(pEnv, lEntry->mValue.mString);
+	StoreKey lKey;
+	if (!openKey(pEnv, pThis, pKey, &lKey)) {
+		return NULL;
 	}
-	else {
+	STATS_START(lStart);
+	lockStoreRead(lKey.mShard);
+	jstring lResult = readString(pEnv, lKey.mShard, findKeyEntry(&lKey));
+	unlockStore(lKey.mShard);
+	STATS_RECORD(lKey.mInstance->mStats, StoreStat_GetString, lStart);
+	closeKey(pEnv, &lKey);
+	return lResult;
+}
+
+JNIEXPORT jstring JNICALL Java_za_co_technodev_javajni_Store_getString__J
+  (JNIEnv* pEnv, jobject pThis, jlong pHandle) {
+	StoreKey lKey;
+	if (!openHandle(pEnv, pThis, pHandle, &lKey)) {
 		return NULL;
 	}
+	STATS_START(lStart);
+	lockStoreRead(lKey.mShard);
+	jstring lResult = readString(pEnv, lKey.mShard, findKeyEntry(&lKey));
+	unlockStore(lKey.mShard);
+	STATS_RECORD(lKey.mInstance->mStats, StoreStat_GetString, lStart);
+	closeKey(pEnv, &lKey);
+	return lResult;
 }
 
-JNIEXPORT void JNICALL Java_za_co_technodev_javajni_Store_setString
+JNIEXPORT void JNICALL Java_za_co_technodev_javajni_Store_setString__Ljava_lang_String_2Ljava_lang_String_2
   (JNIEnv* pEnv, jobject pThis, jstring pKey, jstring pString) {
-	const char* lStringTmp = (*pEnv)->GetStringUTFChars(pEnv, pString, NULL);
-	if(lStringTmp == NULL) {
+	StoreKey lKey;
+	if (!openKey(pEnv, pThis, pKey, &lKey)) {
 		return;
 	}
+	STATS_START(lStart);
+	StoreEntry lValue;
+	if (prepareString(pEnv, pString, &lValue)) {
+		lockStoreWrite(lKey.mShard);
+		int32_t lCommitted = commitEntry(pEnv, lKey.mShard, reserveEntry(pEnv, &lKey), &lValue);
+		unlockStore(lKey.mShard);
+		STATS_RECORD(lKey.mInstance->mStats, StoreStat_SetString, lStart);
+		if (!lCommitted) {
+			throwStoreFullException(pEnv);
+		}
+		publishWrite(lKey.mInstance);
+	}
+	closeKey(pEnv, &lKey);
+}
 
-	StoreEntry* lEntry = allocateEntry(pEnv, &gStore, pKey);
-	if (lEntry != NULL) {
-		lEntry->mType = StoreType_String;
-		jsize lStringLength = (*pEnv)->GetStringUTFLength(pEnv, pString);
-		lEntry->mValue.mString = (char*) malloc(sizeof(char) * (lStringLength + 1));
-		strcpy(lEntry->mValue.mString, lStringTmp);
+JNIEXPORT void JNICALL Java_za_co_technodev_javajni_Store_setString__JLjava_lang_String_2
+  (JNIEnv* pEnv, jobject pThis, jlong pHandle, jstring pString) {
+	StoreKey lKey;
+	if (!openHandle(pEnv, pThis, pHandle, &lKey)) {
+		return;
 	}
-	(*pEnv)->ReleaseStringUTFChars(pEnv, pString, lStringTmp);
+	STATS_START(lStart);
+	StoreEntry lValue;
+	if (prepareString(pEnv, pString, &lValue)) {
+		lockStoreWrite(lKey.mShard);
+		int32_t lCommitted = commitEntry(pEnv, lKey.mShard, reserveEntry(pEnv, &lKey), &lValue);
+		unlockStore(lKey.mShard);
+		STATS_RECORD(lKey.mInstance->mStats, StoreStat_SetString, lStart);
+		if (!lCommitted) {
+			throwStoreFullException(pEnv);
+		}
+		publishWrite(lKey.mInstance);
+	}
+	closeKey(pEnv, &lKey);
 }
 
 /*
  * Objects passed in parameters or created inside a JNI method are local references. Local references
- * cannot be kept on native code outside method scope. Must use global references to inform Dalvik VM
- * that they cannot be garbage collected. Use NewGlobalRef() and DeleteGlobalRef().
+ * cannot be kept on native code outside method scope. Instead of pinning each Color with a global
+ * reference, which would exhaust the global reference table with large arrays, its packed ARGB
+ * value is read once from field mColor and kept natively. A new Color is only built when Java reads
+ * it back.
+ *
+ * Color class, field and constructor come from gStoreCache.
  */
 
-JNIEXPORT jobject JNICALL Java_za_co_technodev_javajni_Store_getColor
-  (JNIEnv* pEnv, jobject pThis, jstring pKey) {
-	StoreEntry* lEntry = findEntry(pEnv, &gStore, pKey, NULL);
-	if (isEntryValid(pEnv, lEntry, StoreType_Color)) {
-		return lEntry->mValue.mColor;
+jobject readColor(JNIEnv* pEnv, StoreEntry* pEntry) {
+	if (isEntryValid(pEnv, pEntry, StoreType_Color)) {
+		return (*pEnv)->NewObject(pEnv, gStoreCache.ClassColor, gStoreCache.ConstructorColor, (jint) pEntry->mValue.mColor);
 	} else {
 		return NULL;
 	}
 }
 
-JNIEXPORT void JNICALL Java_za_co_technodev_javajni_Store_setColor
+int32_t prepareColor(JNIEnv* pEnv, jobject pColor, StoreEntry* pValue) {
+	if (pColor == NULL) {
+		return 0;
+	}
+	pValue->mType = StoreType_Color;
+	pValue->mValue.mColor = (*pEnv)->GetIntField(pEnv, pColor, gStoreCache.FieldColor);
+	return 1;
+}
+
+JNIEXPORT jobject JNICALL Java_za_co_technodev_javajni_Store_getColor__Ljava_lang_String_2
+  (JNIEnv* pEnv, jobject pThis, jstring pKey) {
+	StoreKey lKey;
+	if (!openKey(pEnv, pThis, pKey, &lKey)) {
+		return NULL;
+	}
+	STATS_START(lStart);
+	lockStoreRead(lKey.mShard);
+	jobject lResult = readColor(pEnv, findKeyEntry(&lKey));
+	unlockStore(lKey.mShard);
+	STATS_RECORD(lKey.mInstance->mStats, StoreStat_GetColor, lStart);
+	closeKey(pEnv, &lKey);
+	return lResult;
+}
+
+JNIEXPORT jobject JNICALL Java_za_co_technodev_javajni_Store_getColor__J
+  (JNIEnv* pEnv, jobject pThis, jlong pHandle) {
+	StoreKey lKey;
+	if (!openHandle(pEnv, pThis, pHandle, &lKey)) {
+		return NULL;
+	}
+	STATS_START(lStart);
+	lockStoreRead(lKey.mShard);
+	jobject lResult = readColor(pEnv, findKeyEntry(&lKey));
+	unlockStore(lKey.mShard);
+	STATS_RECORD(lKey.mInstance->mStats, StoreStat_GetColor, lStart);
+	closeKey(pEnv, &lKey);
+	return lResult;
+}
+
+JNIEXPORT void JNICALL Java_za_co_technodev_javajni_Store_setColor__Ljava_lang_String_2Lza_co_technodev_javajni_Color_2
   (JNIEnv* pEnv, jobject pThis, jstring pKey, jobject pColor) {
-	jobject lColor = (*pEnv)->NewGlobalRef(pEnv, pColor);
-	if(lColor == NULL) {
+	StoreKey lKey;
+	if (!openKey(pEnv, pThis, pKey, &lKey)) {
 		return;
 	}
+	STATS_START(lStart);
+	StoreEntry lValue;
+	if (prepareColor(pEnv, pColor, &lValue)) {
+		lockStoreWrite(lKey.mShard);
+		commitEntry(pEnv, lKey.mShard, reserveEntry(pEnv, &lKey), &lValue);
+		unlockStore(lKey.mShard);
+		STATS_RECORD(lKey.mInstance->mStats, StoreStat_SetColor, lStart);
+		publishWrite(lKey.mInstance);
+	}
+	closeKey(pEnv, &lKey);
+}
 
-	StoreEntry* lEntry = allocateEntry(pEnv, &gStore, pKey);
-	if (lEntry != NULL) {
-		lEntry->mType = StoreType_Color;
-		lEntry->mValue.mColor = lColor;
-	} else {
-		(*pEnv)->DeleteGlobalRef(pEnv, lColor);
+JNIEXPORT void JNICALL Java_za_co_technodev_javajni_Store_setColor__JLza_co_technodev_javajni_Color_2
+  (JNIEnv* pEnv, jobject pThis, jlong pHandle, jobject pColor) {
+	StoreKey lKey;
+	if (!openHandle(pEnv, pThis, pHandle, &lKey)) {
+		return;
+	}
+	STATS_START(lStart);
+	StoreEntry lValue;
+	if (prepareColor(pEnv, pColor, &lValue)) {
+		lockStoreWrite(lKey.mShard);
+		commitEntry(pEnv, lKey.mShard, reserveEntry(pEnv, &lKey), &lValue);
+		unlockStore(lKey.mShard);
+		STATS_RECORD(lKey.mInstance->mStats, StoreStat_SetColor, lStart);
+		publishWrite(lKey.mInstance);
 	}
+	closeKey(pEnv, &lKey);
 }
 
 /*
@@ -105,15 +849,13 @@ JNIEXPORT void JNICALL Java_za_co_technodev_javajni_Store_setColor
  * content into the jintArray
  */
 
-JNIEXPORT jintArray JNICALL Java_za_co_technodev_javajni_Store_getIntegerArray
-  (JNIEnv* pEnv, jobject pThis, jstring pKey) {
-	StoreEntry* lEntry = findEntry(pEnv, &gStore, pKey, NULL);
-	if (isEntryValid(pEnv, lEntry, StoreType_IntegerArray)) {
-		jintArray lJavaArray = (*pEnv)->NewIntArray(pEnv, lEntry->mLength);
+jintArray readIntegerArray(JNIEnv* pEnv, StoreEntry* pEntry) {
+	if (isEntryValid(pEnv, pEntry, StoreType_IntegerArray)) {
+		jintArray lJavaArray = (*pEnv)->NewIntArray(pEnv, pEntry->mLength);
 		if (lJavaArray == NULL) {
-			return;
+			return NULL;
 		}
-		(*pEnv)->SetIntArrayRegion(pEnv, lJavaArray, 0 , lEntry->mLength, lEntry->mValue.mIntegerArray);
+		(*pEnv)->SetIntArrayRegion(pEnv, lJavaArray, 0 , pEntry->mLength, pEntry->mValue.mIntegerArray);
 		return lJavaArray;
 	} else {
 		return NULL;
@@ -123,126 +865,1445 @@ JNIEXPORT jintArray JNICALL Java_za_co_technodev_javajni_Store_getIntegerArray
 /*
  * To save a Java array in native code, the inverse operation GetIntArrayRegion() exists.
  * The only way to allocate a suitable target memory buffer is to measure array size with
- * GetArrayLength(). GetIntArrayRegion() also performs bound checking and can raise an exception.
+ * GetArrayLength().
+ *
+ * GetPrimitiveArrayCritical() gives direct access to the Java array content, most often without
+ * any copy, so that elements are copied exactly once into the native buffer. No other JNI call
+ * may happen and the thread must not block until the array is released, which is why the buffer
+ * is allocated beforehand. JNI_ABORT tells the VM the content was not modified.
  */
 
-JNIEXPORT void JNICALL Java_za_co_technodev_javajni_Store_setIntegerArray
-  (JNIEnv* pEnv, jobject pThis, jstring pKey, jintArray pIntegerArray) {
+int32_t prepareIntegerArray(JNIEnv* pEnv, jintArray pIntegerArray, StoreEntry* pValue) {
 	jsize lLength = (*pEnv)->GetArrayLength(pEnv, pIntegerArray);
 	int32_t* lArray = (int32_t*) malloc(lLength * sizeof(int32_t));
-	(*pEnv)->GetIntArrayRegion(pEnv, pIntegerArray, 0, lLength, lArray);
-	if ((*pEnv)->ExceptionCheck(pEnv)) {
-		free(lArray);
-		return;
+	if ((lArray == NULL) && (lLength > 0)) {
+		return 0;
 	}
 
-	StoreEntry* lEntry = allocateEntry(pEnv, &gStore, pKey);
-	if(lEntry != NULL) {
-		lEntry->mType = StoreType_IntegerArray;
-		lEntry->mLength = lLength;
-		lEntry->mValue.mIntegerArray = lArray;
-	} else {
+	jint* lJavaArray = (jint*) (*pEnv)->GetPrimitiveArrayCritical(pEnv, pIntegerArray, NULL);
+	if (lJavaArray == NULL) {
 		free(lArray);
-		return;
+		return 0;
 	}
+	memcpy(lArray, lJavaArray, lLength * sizeof(int32_t));
+	(*pEnv)->ReleasePrimitiveArrayCritical(pEnv, pIntegerArray, lJavaArray, JNI_ABORT);
+
+	pValue->mType = StoreType_IntegerArray;
+	pValue->mLength = lLength;
+	pValue->mValue.mIntegerArray = lArray;
+	return 1;
 }
 
 /*
- * Object arrays are represented with type jobjectArray. On the opposite of primitive arrays
- * it is not possible to work on all elements at the same time. Instead, objects are set one by
- * one with SetObjectArrayElement().
+ * Overwriting an integer array with one of the same length reuses the native buffer. This avoids an
+ * allocation and keeps views returned by getIntegerArrayBuffer() valid. Returns 0 if the entry
+ * cannot be updated in place, or -1, with an exception pending and the entry untouched, if the Java
+ * array cannot be read.
  */
 
-JNIEXPORT jobjectArray JNICALL Java_za_co_technodev_javajni_Store_getColorArray
-  (JNIEnv* pEnv, jobject pThis, jstring pKey) {
-	StoreEntry* lEntry = findEntry(pEnv, &gStore, pKey, NULL);
-	if (isEntryValid(pEnv, lEntry, StoreType_ColorArray)) {
-		jclass lColorClass = (*pEnv)->FindClass(pEnv, "za/co/technodev/javajni/Color");
-		if (lColorClass == NULL) {
-			return NULL;
-		}
-		jobjectArray lJavaArray = (*pEnv)->NewObjectArray(pEnv, lEntry->mLength, lColorClass, NULL);
-		(*pEnv)->DeleteLocalRef(pEnv, lColorClass);
-		if (lJavaArray == NULL) {
-			return NULL;
-		}
+int32_t updateIntegerArray(JNIEnv* pEnv, Store* pStore, StoreEntry* pEntry, jintArray pIntegerArray) {
+	//A mapped array is replaced by a heap copy through the regular setter
+	if ((pEntry == NULL) || (pEntry->mType != StoreType_IntegerArray)
+	 || (pEntry->mLength != (*pEnv)->GetArrayLength(pEnv, pIntegerArray))
+	 || isMapped(pStore, pEntry->mValue.mIntegerArray)) {
+		return 0;
+	}
 
-		int32_t i;
-		for (i = 0; i < lEntry->mLength; i++) {
-			(*pEnv)->SetObjectArrayElement(pEnv, lJavaArray, i, lEntry->mValue.mColorArray[i]);
-			if((*pEnv)->ExceptionCheck(pEnv)) {
-				return NULL;
-			}
-		}
-		return lJavaArray;
-	} else {
-		return NULL;
+	jint* lJavaArray = (jint*) (*pEnv)->GetPrimitiveArrayCritical(pEnv, pIntegerArray, NULL);
+	if (lJavaArray == NULL) {
+		return -1;
 	}
+	memcpy(pEntry->mValue.mIntegerArray, lJavaArray, pEntry->mLength * sizeof(int32_t));
+	(*pEnv)->ReleasePrimitiveArrayCritical(pEnv, pIntegerArray, lJavaArray, JNI_ABORT);
+	touchEntry(pStore, pEntry);
+	return 1;
 }
 
 /*
- * Array elements are also retrieved one by one with GetObjectArrayElement(). Returned references
- * are local and should be made global to store them safely in a memeory buffer. If a problem happens
- * global references must be carefully destroyed to allow garbage collection.
+ * A direct ByteBuffer wraps native memory without copying it. The buffer handed to Java points
+ * straight into the entry storage. An array still in the mapped store image is first moved to the
+ * heap, under the write lock, so that no buffer ever points into the mapping. It stays valid until
+ * that storage is freed or moved, which happens when:
+ * - the entry is overwritten with an array of a different length or another type;
+ * - the entry is appended to, which may reallocate the array;
+ * - the key is removed, by removeKey() or removeKeys();
+ * - the store is cleared;
+ * - the key is imported, importRecord() always replacing the value;
+ * - the store is finalized.
+ * Using it afterwards reads freed memory. Reads and writes through the buffer take no shard lock.
  */
 
-JNIEXPORT void JNICALL Java_za_co_technodev_javajni_Store_setColorArray
-  (JNIEnv* pEnv, jobject pThis, jstring pKey, jobjectArray pColorArray) {
-	jsize lLength = (*pEnv)->GetArrayLength(pEnv, pColorArray);
-	jobject* lArray = (jobject*) malloc(lLength * sizeof(jobject));
-	int32_t i,j;
-	for (i = 0; i < lLength; ++i) {
-		jobject lLocalColor = (*pEnv)->GetObjectArrayElement(pEnv, pColorArray, i);
-		if(lLocalColor == NULL) {
-			for (j = 0; j < i; ++j) {
-				(*pEnv)->DeleteGlobalRef(pEnv, lArray[j]);
-			}
-			free(lArray);
-			return;
-		}
-		lArray[i] = (*pEnv)->NewGlobalRef(pEnv, lLocalColor);
-		if(lArray[i] == NULL) {
-			for (j = 0; j < i; ++j) {
-				(*pEnv)->DeleteGlobalRef(pEnv, lArray[j]);
-			}
-			free(lArray);
-			return;
+jobject readIntegerArrayBuffer(JNIEnv* pEnv, Store* pStore, StoreEntry* pEntry) {
+	static int32_t lEmptyArray;
+	if (isEntryValid(pEnv, pEntry, StoreType_IntegerArray)) {
+		if (!detachEntryArray(pStore, pEntry)) {
+			throwIllegalStateException(pEnv, "Cannot allocate array");
+			return NULL;
 		}
-		(*pEnv)->DeleteLocalRef(pEnv, lLocalColor);
-	}
-
-	StoreEntry* lEntry = allocateEntry(pEnv, &gStore, pKey);
-	if (lEntry != NULL) {
-		lEntry->mType = StoreType_ColorArray;
-		lEntry->mLength = lLength;
-		lEntry->mValue.mColorArray = lArray;
+		void* lAddress = (pEntry->mLength > 0) ? (void*) pEntry->mValue.mIntegerArray : (void*) &lEmptyArray;
+		return (*pEnv)->NewDirectByteBuffer(pEnv, lAddress, pEntry->mLength * sizeof(int32_t));
 	} else {
-		for (j = 0; j < i; ++j) {
-			(*pEnv)->DeleteGlobalRef(pEnv, lArray[j]);
-		}
-		free(lArray);
-		return;
+		return NULL;
 	}
 }
 
-
-JNIEXPORT void JNICALL Java_za_co_technodev_javajni_Store_initializeStore
-  (JNIEnv* pEnv, jobject pThis) {
-	mStore.mLength = 0;
-	startWatcher(pEnv, &mStoreWatcher, &mStore, pThis);
+JNIEXPORT jintArray JNICALL Java_za_co_technodev_javajni_Store_getIntegerArray__Ljava_lang_String_2
+  (JNIEnv* pEnv, jobject pThis, jstring pKey) {
+	StoreKey lKey;
+	if (!openKey(pEnv, pThis, pKey, &lKey)) {
+		return NULL;
+	}
+	STATS_START(lStart);
+	lockStoreRead(lKey.mShard);
+	jintArray lResult = readIntegerArray(pEnv, findKeyEntry(&lKey));
+	unlockStore(lKey.mShard);
+	STATS_RECORD(lKey.mInstance->mStats, StoreStat_GetIntegerArray, lStart);
+	closeKey(pEnv, &lKey);
+	return lResult;
+}
+
+JNIEXPORT jintArray JNICALL Java_za_co_technodev_javajni_Store_getIntegerArray__J
+  (JNIEnv* pEnv, jobject pThis, jlong pHandle) {
+	StoreKey lKey;
+	if (!openHandle(pEnv, pThis, pHandle, &lKey)) {
+		return NULL;
+	}
+	STATS_START(lStart);
+	lockStoreRead(lKey.mShard);
+	jintArray lResult = readIntegerArray(pEnv, findKeyEntry(&lKey));
+	unlockStore(lKey.mShard);
+	STATS_RECORD(lKey.mInstance->mStats, StoreStat_GetIntegerArray, lStart);
+	closeKey(pEnv, &lKey);
+	return lResult;
+}
+
+JNIEXPORT void JNICALL Java_za_co_technodev_javajni_Store_setIntegerArray__Ljava_lang_String_2_3I
+  (JNIEnv* pEnv, jobject pThis, jstring pKey, jintArray pIntegerArray) {
+	StoreKey lKey;
+	if (!openKey(pEnv, pThis, pKey, &lKey)) {
+		return;
+	}
+	STATS_START(lStart);
+	lockStoreWrite(lKey.mShard);
+	int32_t lUpdated = updateIntegerArray(pEnv, lKey.mShard, findKeyEntry(&lKey), pIntegerArray);
+	unlockStore(lKey.mShard);
+	if (lUpdated != 0) {
+		if (lUpdated > 0) {
+			STATS_RECORD(lKey.mInstance->mStats, StoreStat_SetIntegerArray, lStart);
+			publishWrite(lKey.mInstance);
+		}
+		closeKey(pEnv, &lKey);
+		return;
+	}
+
+	StoreEntry lValue;
+	if (prepareIntegerArray(pEnv, pIntegerArray, &lValue)) {
+		lockStoreWrite(lKey.mShard);
+		commitEntry(pEnv, lKey.mShard, reserveEntry(pEnv, &lKey), &lValue);
+		unlockStore(lKey.mShard);
+		STATS_RECORD(lKey.mInstance->mStats, StoreStat_SetIntegerArray, lStart);
+		publishWrite(lKey.mInstance);
+	}
+	closeKey(pEnv, &lKey);
+}
+
+JNIEXPORT void JNICALL Java_za_co_technodev_javajni_Store_setIntegerArray__J_3I
+  (JNIEnv* pEnv, jobject pThis, jlong pHandle, jintArray pIntegerArray) {
+	StoreKey lKey;
+	if (!openHandle(pEnv, pThis, pHandle, &lKey)) {
+		return;
+	}
+	STATS_START(lStart);
+	lockStoreWrite(lKey.mShard);
+	int32_t lUpdated = updateIntegerArray(pEnv, lKey.mShard, findKeyEntry(&lKey), pIntegerArray);
+	unlockStore(lKey.mShard);
+	if (lUpdated != 0) {
+		if (lUpdated > 0) {
+			STATS_RECORD(lKey.mInstance->mStats, StoreStat_SetIntegerArray, lStart);
+			publishWrite(lKey.mInstance);
+		}
+		return;
+	}
+
+	StoreEntry lValue;
+	if (prepareIntegerArray(pEnv, pIntegerArray, &lValue)) {
+		lockStoreWrite(lKey.mShard);
+		commitEntry(pEnv, lKey.mShard, reserveEntry(pEnv, &lKey), &lValue);
+		unlockStore(lKey.mShard);
+		STATS_RECORD(lKey.mInstance->mStats, StoreStat_SetIntegerArray, lStart);
+		publishWrite(lKey.mInstance);
+	}
+	closeKey(pEnv, &lKey);
+}
+
+JNIEXPORT jobject JNICALL Java_za_co_technodev_javajni_Store_getIntegerArrayBuffer__Ljava_lang_String_2
+  (JNIEnv* pEnv, jobject pThis, jstring pKey) {
+	StoreKey lKey;
+	if (!openKey(pEnv, pThis, pKey, &lKey)) {
+		return NULL;
+	}
+	STATS_START(lStart);
+	//Written since a mapped array is moved to the heap first
+	lockStoreWrite(lKey.mShard);
+	jobject lResult = readIntegerArrayBuffer(pEnv, lKey.mShard, findKeyEntry(&lKey));
+	unlockStore(lKey.mShard);
+	STATS_RECORD(lKey.mInstance->mStats, StoreStat_GetIntegerArray, lStart);
+	closeKey(pEnv, &lKey);
+	return lResult;
+}
+
+JNIEXPORT jobject JNICALL Java_za_co_technodev_javajni_Store_getIntegerArrayBuffer__J
+  (JNIEnv* pEnv, jobject pThis, jlong pHandle) {
+	StoreKey lKey;
+	if (!openHandle(pEnv, pThis, pHandle, &lKey)) {
+		return NULL;
+	}
+	STATS_START(lStart);
+	//Written since a mapped array is moved to the heap first
+	lockStoreWrite(lKey.mShard);
+	jobject lResult = readIntegerArrayBuffer(pEnv, lKey.mShard, findKeyEntry(&lKey));
+	unlockStore(lKey.mShard);
+	STATS_RECORD(lKey.mInstance->mStats, StoreStat_GetIntegerArray, lStart);
+	closeKey(pEnv, &lKey);
+	return lResult;
+}
+
+/*
+ * Appended values are copied straight from the Java array into the native buffer, which grows
+ * geometrically so that repeated appends cost amortized O(k). An entry without value becomes an
+ * IntegerArray. An array mapped from a store image is moved to the heap the first time it grows.
+ * Returns 0, with the entry left untouched, if it is of another type or out of memory.
+ */
+
+int32_t appendIntegerArray(JNIEnv* pEnv, Store* pStore, StoreEntry* pEntry, jintArray pIntegerArray) {
+	if (pEntry->mType == StoreType_None) {
+		pEntry->mValue.mIntegerArray = NULL;
+		pEntry->mLength = 0;
+		pEntry->mCapacity = 0;
+	} else if (!isEntryValid(pEnv, pEntry, StoreType_IntegerArray)) {
+		return 0;
+	}
+
+	jsize lCount = (*pEnv)->GetArrayLength(pEnv, pIntegerArray);
+	int64_t lLength = (int64_t) pEntry->mLength + lCount;
+	if (lLength > STORE_MAX_ARRAY_LENGTH) {
+		return 0;
+	}
+	if (lLength > pEntry->mCapacity) {
+		int64_t lCapacity = (pEntry->mCapacity > STORE_MIN_ARRAY_CAPACITY) ? pEntry->mCapacity : STORE_MIN_ARRAY_CAPACITY;
+		while (lCapacity < lLength) {
+			lCapacity *= 2;
+		}
+		if (lCapacity > STORE_MAX_ARRAY_LENGTH) {
+			lCapacity = STORE_MAX_ARRAY_LENGTH;
+		}
+
+		int32_t* lArray;
+		if (isMapped(pStore, pEntry->mValue.mIntegerArray)) {
+			lArray = (int32_t*) malloc(lCapacity * sizeof(int32_t));
+			if (lArray != NULL) {
+				memcpy(lArray, pEntry->mValue.mIntegerArray, pEntry->mLength * sizeof(int32_t));
+			}
+		} else {
+			lArray = (int32_t*) realloc(pEntry->mValue.mIntegerArray, lCapacity * sizeof(int32_t));
+		}
+		if (lArray == NULL) {
+			return 0;
+		}
+		pEntry->mValue.mIntegerArray = lArray;
+		pEntry->mCapacity = (int32_t) lCapacity;
+	}
+
+	int32_t lFrom = pEntry->mLength;
+	(*pEnv)->GetIntArrayRegion(pEnv, pIntegerArray, 0, lCount, pEntry->mValue.mIntegerArray + lFrom);
+	pEntry->mLength = (int32_t) lLength;
+	pEntry->mType = StoreType_IntegerArray;
+	touchAppendedEntry(pStore, pEntry, lFrom);
+	return 1;
+}
+
+JNIEXPORT void JNICALL Java_za_co_technodev_javajni_Store_appendIntegers__Ljava_lang_String_2_3I
+  (JNIEnv* pEnv, jobject pThis, jstring pKey, jintArray pIntegerArray) {
+	StoreKey lKey;
+	if (!openKey(pEnv, pThis, pKey, &lKey)) {
+		return;
+	}
+	STATS_START(lStart);
+	lockStoreWrite(lKey.mShard);
+	StoreEntry* lEntry = reserveEntry(pEnv, &lKey);
+	int32_t lAppended = (lEntry != NULL) && appendIntegerArray(pEnv, lKey.mShard, lEntry, pIntegerArray);
+	unlockStore(lKey.mShard);
+	STATS_RECORD(lKey.mInstance->mStats, StoreStat_SetIntegerArray, lStart);
+	if (lAppended) {
+		publishWrite(lKey.mInstance);
+	}
+	closeKey(pEnv, &lKey);
+}
+
+JNIEXPORT void JNICALL Java_za_co_technodev_javajni_Store_appendIntegers__J_3I
+  (JNIEnv* pEnv, jobject pThis, jlong pHandle, jintArray pIntegerArray) {
+	StoreKey lKey;
+	if (!openHandle(pEnv, pThis, pHandle, &lKey)) {
+		return;
+	}
+	STATS_START(lStart);
+	lockStoreWrite(lKey.mShard);
+	StoreEntry* lEntry = reserveEntry(pEnv, &lKey);
+	int32_t lAppended = (lEntry != NULL) && appendIntegerArray(pEnv, lKey.mShard, lEntry, pIntegerArray);
+	unlockStore(lKey.mShard);
+	STATS_RECORD(lKey.mInstance->mStats, StoreStat_SetIntegerArray, lStart);
+	if (lAppended) {
+		publishWrite(lKey.mInstance);
+	}
+	closeKey(pEnv, &lKey);
+}
+
+/*
+ * Regions only transfer the elements in [pOffset, pOffset + pLength[, which must lie within the
+ * current length of the array.
+ */
+
+int32_t isRegionValid(JNIEnv* pEnv, StoreEntry* pEntry, jint pOffset, jint pLength) {
+	if ((pOffset < 0) || (pLength < 0) || ((int64_t) pOffset + pLength > pEntry->mLength)) {
+		throwIndexOutOfBoundsException(pEnv);
+		return 0;
+	}
+	return 1;
+}
+
+jintArray readIntegerArrayRegion(JNIEnv* pEnv, StoreEntry* pEntry, jint pOffset, jint pLength) {
+	if (!isEntryValid(pEnv, pEntry, StoreType_IntegerArray) || !isRegionValid(pEnv, pEntry, pOffset, pLength)) {
+		return NULL;
+	}
+	jintArray lJavaArray = (*pEnv)->NewIntArray(pEnv, pLength);
+	if (lJavaArray != NULL) {
+		(*pEnv)->SetIntArrayRegion(pEnv, lJavaArray, 0, pLength, pEntry->mValue.mIntegerArray + pOffset);
+	}
+	return lJavaArray;
+}
+
+int32_t updateIntegerArrayRegion(JNIEnv* pEnv, Store* pStore, StoreEntry* pEntry, jint pOffset, jintArray pIntegerArray) {
+	jsize lLength = (*pEnv)->GetArrayLength(pEnv, pIntegerArray);
+	if (!isEntryValid(pEnv, pEntry, StoreType_IntegerArray) || !isRegionValid(pEnv, pEntry, pOffset, lLength)) {
+		return 0;
+	}
+	if (!detachEntryArray(pStore, pEntry)) {
+		throwIllegalStateException(pEnv, "Cannot allocate array");
+		return 0;
+	}
+	(*pEnv)->GetIntArrayRegion(pEnv, pIntegerArray, 0, lLength, pEntry->mValue.mIntegerArray + pOffset);
+	touchEntry(pStore, pEntry);
+	return 1;
+}
+
+JNIEXPORT jintArray JNICALL Java_za_co_technodev_javajni_Store_getIntegerArrayRegion__Ljava_lang_String_2II
+  (JNIEnv* pEnv, jobject pThis, jstring pKey, jint pOffset, jint pLength) {
+	StoreKey lKey;
+	if (!openKey(pEnv, pThis, pKey, &lKey)) {
+		return NULL;
+	}
+	STATS_START(lStart);
+	lockStoreRead(lKey.mShard);
+	jintArray lResult = readIntegerArrayRegion(pEnv, findKeyEntry(&lKey), pOffset, pLength);
+	unlockStore(lKey.mShard);
+	STATS_RECORD(lKey.mInstance->mStats, StoreStat_GetIntegerArray, lStart);
+	closeKey(pEnv, &lKey);
+	return lResult;
+}
+
+JNIEXPORT jintArray JNICALL Java_za_co_technodev_javajni_Store_getIntegerArrayRegion__JII
+  (JNIEnv* pEnv, jobject pThis, jlong pHandle, jint pOffset, jint pLength) {
+	StoreKey lKey;
+	if (!openHandle(pEnv, pThis, pHandle, &lKey)) {
+		return NULL;
+	}
+	STATS_START(lStart);
+	lockStoreRead(lKey.mShard);
+	jintArray lResult = readIntegerArrayRegion(pEnv, findKeyEntry(&lKey), pOffset, pLength);
+	unlockStore(lKey.mShard);
+	STATS_RECORD(lKey.mInstance->mStats, StoreStat_GetIntegerArray, lStart);
+	closeKey(pEnv, &lKey);
+	return lResult;
+}
+
+JNIEXPORT void JNICALL Java_za_co_technodev_javajni_Store_setIntegerArrayRegion__Ljava_lang_String_2I_3I
+  (JNIEnv* pEnv, jobject pThis, jstring pKey, jint pOffset, jintArray pIntegerArray) {
+	StoreKey lKey;
+	if (!openKey(pEnv, pThis, pKey, &lKey)) {
+		return;
+	}
+	STATS_START(lStart);
+	lockStoreWrite(lKey.mShard);
+	int32_t lUpdated = updateIntegerArrayRegion(pEnv, lKey.mShard, findKeyEntry(&lKey), pOffset, pIntegerArray);
+	unlockStore(lKey.mShard);
+	STATS_RECORD(lKey.mInstance->mStats, StoreStat_SetIntegerArray, lStart);
+	if (lUpdated) {
+		publishWrite(lKey.mInstance);
+	}
+	closeKey(pEnv, &lKey);
+}
+
+JNIEXPORT void JNICALL Java_za_co_technodev_javajni_Store_setIntegerArrayRegion__JI_3I
+  (JNIEnv* pEnv, jobject pThis, jlong pHandle, jint pOffset, jintArray pIntegerArray) {
+	StoreKey lKey;
+	if (!openHandle(pEnv, pThis, pHandle, &lKey)) {
+		return;
+	}
+	STATS_START(lStart);
+	lockStoreWrite(lKey.mShard);
+	int32_t lUpdated = updateIntegerArrayRegion(pEnv, lKey.mShard, findKeyEntry(&lKey), pOffset, pIntegerArray);
+	unlockStore(lKey.mShard);
+	STATS_RECORD(lKey.mInstance->mStats, StoreStat_SetIntegerArray, lStart);
+	if (lUpdated) {
+		publishWrite(lKey.mInstance);
+	}
+	closeKey(pEnv, &lKey);
+}
+
+/*
+ * Aggregates run over the native array in place under the read lock, nothing is copied to Java.
+ * See StoreAggregate.h.
+ */
+
+jlong aggregateIntegerArray(JNIEnv* pEnv, StoreEntry* pEntry, IntegerArrayAggregate pAggregate, jint pArg1, jint pArg2) {
+	if (!isEntryValid(pEnv, pEntry, StoreType_IntegerArray)) {
+		return 0;
+	}
+	switch (pAggregate) {
+	case IntegerArrayAggregate_Sum:
+		return sumIntegers(pEntry->mValue.mIntegerArray, pEntry->mLength);
+	case IntegerArrayAggregate_Min:
+		return minIntegers(pEntry->mValue.mIntegerArray, pEntry->mLength);
+	case IntegerArrayAggregate_Max:
+		return maxIntegers(pEntry->mValue.mIntegerArray, pEntry->mLength);
+	case IntegerArrayAggregate_Count:
+		return countIntegers(pEntry->mValue.mIntegerArray, pEntry->mLength, pArg1, pArg2);
+	case IntegerArrayAggregate_IndexOf:
+		return indexOfInteger(pEntry->mValue.mIntegerArray, pEntry->mLength, pArg1);
+	}
+	return 0;
+}
+
+/*
+ * Buckets are counted straight into the Java array. Arguments are checked on the Java side.
+ */
+
+jintArray readIntegerArrayHistogram(JNIEnv* pEnv, StoreEntry* pEntry, jint pLow, jint pHigh, jint pBucketCount) {
+	if (!isEntryValid(pEnv, pEntry, StoreType_IntegerArray)) {
+		return NULL;
+	}
+	jintArray lJavaArray = (*pEnv)->NewIntArray(pEnv, pBucketCount);
+	if (lJavaArray == NULL) {
+		return NULL;
+	}
+	jint* lBuckets = (jint*) (*pEnv)->GetPrimitiveArrayCritical(pEnv, lJavaArray, NULL);
+	if (lBuckets == NULL) {
+		return NULL;
+	}
+	histogramIntegers(pEntry->mValue.mIntegerArray, pEntry->mLength, pLow, pHigh, lBuckets, pBucketCount);
+	(*pEnv)->ReleasePrimitiveArrayCritical(pEnv, lJavaArray, lBuckets, 0);
+	return lJavaArray;
+}
+
+JNIEXPORT jlong JNICALL Java_za_co_technodev_javajni_Store_sumIntegerArray__Ljava_lang_String_2
+  (JNIEnv* pEnv, jobject pThis, jstring pKey) {
+	StoreKey lKey;
+	if (!openKey(pEnv, pThis, pKey, &lKey)) {
+		return 0;
+	}
+	STATS_START(lStart);
+	lockStoreRead(lKey.mShard);
+	jlong lResult = aggregateIntegerArray(pEnv, findKeyEntry(&lKey), IntegerArrayAggregate_Sum, 0, 0);
+	unlockStore(lKey.mShard);
+	STATS_RECORD(lKey.mInstance->mStats, StoreStat_AggregateIntegerArray, lStart);
+	closeKey(pEnv, &lKey);
+	return lResult;
+}
+
+JNIEXPORT jlong JNICALL Java_za_co_technodev_javajni_Store_sumIntegerArray__J
+  (JNIEnv* pEnv, jobject pThis, jlong pHandle) {
+	StoreKey lKey;
+	if (!openHandle(pEnv, pThis, pHandle, &lKey)) {
+		return 0;
+	}
+	STATS_START(lStart);
+	lockStoreRead(lKey.mShard);
+	jlong lResult = aggregateIntegerArray(pEnv, findKeyEntry(&lKey), IntegerArrayAggregate_Sum, 0, 0);
+	unlockStore(lKey.mShard);
+	STATS_RECORD(lKey.mInstance->mStats, StoreStat_AggregateIntegerArray, lStart);
+	closeKey(pEnv, &lKey);
+	return lResult;
+}
+
+JNIEXPORT jint JNICALL Java_za_co_technodev_javajni_Store_minIntegerArray__Ljava_lang_String_2
+  (JNIEnv* pEnv, jobject pThis, jstring pKey) {
+	StoreKey lKey;
+	if (!openKey(pEnv, pThis, pKey, &lKey)) {
+		return 0;
+	}
+	STATS_START(lStart);
+	lockStoreRead(lKey.mShard);
+	jint lResult = (jint) aggregateIntegerArray(pEnv, findKeyEntry(&lKey), IntegerArrayAggregate_Min, 0, 0);
+	unlockStore(lKey.mShard);
+	STATS_RECORD(lKey.mInstance->mStats, StoreStat_AggregateIntegerArray, lStart);
+	closeKey(pEnv, &lKey);
+	return lResult;
+}
+
+JNIEXPORT jint JNICALL Java_za_co_technodev_javajni_Store_minIntegerArray__J
+  (JNIEnv* pEnv, jobject pThis, jlong pHandle) {
+	StoreKey lKey;
+	if (!openHandle(pEnv, pThis, pHandle, &lKey)) {
+		return 0;
+	}
+	STATS_START(lStart);
+	lockStoreRead(lKey.mShard);
+	jint lResult = (jint) aggregateIntegerArray(pEnv, findKeyEntry(&lKey), IntegerArrayAggregate_Min, 0, 0);
+	unlockStore(lKey.mShard);
+	STATS_RECORD(lKey.mInstance->mStats, StoreStat_AggregateIntegerArray, lStart);
+	closeKey(pEnv, &lKey);
+	return lResult;
+}
+
+JNIEXPORT jint JNICALL Java_za_co_technodev_javajni_Store_maxIntegerArray__Ljava_lang_String_2
+  (JNIEnv* pEnv, jobject pThis, jstring pKey) {
+	StoreKey lKey;
+	if (!openKey(pEnv, pThis, pKey, &lKey)) {
+		return 0;
+	}
+	STATS_START(lStart);
+	lockStoreRead(lKey.mShard);
+	jint lResult = (jint) aggregateIntegerArray(pEnv, findKeyEntry(&lKey), IntegerArrayAggregate_Max, 0, 0);
+	unlockStore(lKey.mShard);
+	STATS_RECORD(lKey.mInstance->mStats, StoreStat_AggregateIntegerArray, lStart);
+	closeKey(pEnv, &lKey);
+	return lResult;
+}
+
+JNIEXPORT jint JNICALL Java_za_co_technodev_javajni_Store_maxIntegerArray__J
+  (JNIEnv* pEnv, jobject pThis, jlong pHandle) {
+	StoreKey lKey;
+	if (!openHandle(pEnv, pThis, pHandle, &lKey)) {
+		return 0;
+	}
+	STATS_START(lStart);
+	lockStoreRead(lKey.mShard);
+	jint lResult = (jint) aggregateIntegerArray(pEnv, findKeyEntry(&lKey), IntegerArrayAggregate_Max, 0, 0);
+	unlockStore(lKey.mShard);
+	STATS_RECORD(lKey.mInstance->mStats, StoreStat_AggregateIntegerArray, lStart);
+	closeKey(pEnv, &lKey);
+	return lResult;
+}
+
+JNIEXPORT jint JNICALL Java_za_co_technodev_javajni_Store_countIntegerArray__Ljava_lang_String_2II
+  (JNIEnv* pEnv, jobject pThis, jstring pKey, jint pLow, jint pHigh) {
+	StoreKey lKey;
+	if (!openKey(pEnv, pThis, pKey, &lKey)) {
+		return 0;
+	}
+	STATS_START(lStart);
+	lockStoreRead(lKey.mShard);
+	jint lResult = (jint) aggregateIntegerArray(pEnv, findKeyEntry(&lKey), IntegerArrayAggregate_Count, pLow, pHigh);
+	unlockStore(lKey.mShard);
+	STATS_RECORD(lKey.mInstance->mStats, StoreStat_AggregateIntegerArray, lStart);
+	closeKey(pEnv, &lKey);
+	return lResult;
+}
+
+JNIEXPORT jint JNICALL Java_za_co_technodev_javajni_Store_countIntegerArray__JII
+  (JNIEnv* pEnv, jobject pThis, jlong pHandle, jint pLow, jint pHigh) {
+	StoreKey lKey;
+	if (!openHandle(pEnv, pThis, pHandle, &lKey)) {
+		return 0;
+	}
+	STATS_START(lStart);
+	lockStoreRead(lKey.mShard);
+	jint lResult = (jint) aggregateIntegerArray(pEnv, findKeyEntry(&lKey), IntegerArrayAggregate_Count, pLow, pHigh);
+	unlockStore(lKey.mShard);
+	STATS_RECORD(lKey.mInstance->mStats, StoreStat_AggregateIntegerArray, lStart);
+	closeKey(pEnv, &lKey);
+	return lResult;
+}
+
+JNIEXPORT jint JNICALL Java_za_co_technodev_javajni_Store_indexOfIntegerArray__Ljava_lang_String_2I
+  (JNIEnv* pEnv, jobject pThis, jstring pKey, jint pValue) {
+	StoreKey lKey;
+	if (!openKey(pEnv, pThis, pKey, &lKey)) {
+		return 0;
+	}
+	STATS_START(lStart);
+	lockStoreRead(lKey.mShard);
+	jint lResult = (jint) aggregateIntegerArray(pEnv, findKeyEntry(&lKey), IntegerArrayAggregate_IndexOf, pValue, 0);
+	unlockStore(lKey.mShard);
+	STATS_RECORD(lKey.mInstance->mStats, StoreStat_AggregateIntegerArray, lStart);
+	closeKey(pEnv, &lKey);
+	return lResult;
+}
+
+JNIEXPORT jint JNICALL Java_za_co_technodev_javajni_Store_indexOfIntegerArray__JI
+  (JNIEnv* pEnv, jobject pThis, jlong pHandle, jint pValue) {
+	StoreKey lKey;
+	if (!openHandle(pEnv, pThis, pHandle, &lKey)) {
+		return 0;
+	}
+	STATS_START(lStart);
+	lockStoreRead(lKey.mShard);
+	jint lResult = (jint) aggregateIntegerArray(pEnv, findKeyEntry(&lKey), IntegerArrayAggregate_IndexOf, pValue, 0);
+	unlockStore(lKey.mShard);
+	STATS_RECORD(lKey.mInstance->mStats, StoreStat_AggregateIntegerArray, lStart);
+	closeKey(pEnv, &lKey);
+	return lResult;
+}
+
+JNIEXPORT jintArray JNICALL Java_za_co_technodev_javajni_Store_getIntegerArrayHistogram__Ljava_lang_String_2III
+  (JNIEnv* pEnv, jobject pThis, jstring pKey, jint pLow, jint pHigh, jint pBucketCount) {
+	StoreKey lKey;
+	if (!openKey(pEnv, pThis, pKey, &lKey)) {
+		return NULL;
+	}
+	STATS_START(lStart);
+	lockStoreRead(lKey.mShard);
+	jintArray lResult = readIntegerArrayHistogram(pEnv, findKeyEntry(&lKey), pLow, pHigh, pBucketCount);
+	unlockStore(lKey.mShard);
+	STATS_RECORD(lKey.mInstance->mStats, StoreStat_AggregateIntegerArray, lStart);
+	closeKey(pEnv, &lKey);
+	return lResult;
+}
+
+JNIEXPORT jintArray JNICALL Java_za_co_technodev_javajni_Store_getIntegerArrayHistogram__JIII
+  (JNIEnv* pEnv, jobject pThis, jlong pHandle, jint pLow, jint pHigh, jint pBucketCount) {
+	StoreKey lKey;
+	if (!openHandle(pEnv, pThis, pHandle, &lKey)) {
+		return NULL;
+	}
+	STATS_START(lStart);
+	lockStoreRead(lKey.mShard);
+	jintArray lResult = readIntegerArrayHistogram(pEnv, findKeyEntry(&lKey), pLow, pHigh, pBucketCount);
+	unlockStore(lKey.mShard);
+	STATS_RECORD(lKey.mInstance->mStats, StoreStat_AggregateIntegerArray, lStart);
+	closeKey(pEnv, &lKey);
+	return lResult;
+}
+
+/*
+ * Object arrays are represented with type jobjectArray. On the opposite of primitive arrays
+ * it is not possible to work on all elements at the same time. Instead, objects are set one by
+ * one with SetObjectArrayElement(). Each Color is rebuilt from its packed value, local references
+ * are deleted right away so that large arrays do not overflow the local reference table.
+ */
+
+jobjectArray readColorArray(JNIEnv* pEnv, StoreEntry* pEntry) {
+	if (isEntryValid(pEnv, pEntry, StoreType_ColorArray)) {
+		jobjectArray lJavaArray = (*pEnv)->NewObjectArray(pEnv, pEntry->mLength, gStoreCache.ClassColor, NULL);
+		if (lJavaArray == NULL) {
+			return NULL;
+		}
+
+		int32_t i;
+		for (i = 0; i < pEntry->mLength; i++) {
+			jobject lColor = (*pEnv)->NewObject(pEnv, gStoreCache.ClassColor, gStoreCache.ConstructorColor, (jint) pEntry->mValue.mColorArray[i]);
+			if (lColor == NULL) {
+				return NULL;
+			}
+			(*pEnv)->SetObjectArrayElement(pEnv, lJavaArray, i, lColor);
+			(*pEnv)->DeleteLocalRef(pEnv, lColor);
+		}
+		return lJavaArray;
+	} else {
+		return NULL;
+	}
+}
+
+/*
+ * Array elements are also retrieved one by one with GetObjectArrayElement(). Only their packed value
+ * is kept, in a contiguous buffer, so returned local references can be deleted immediately.
+ */
+
+int32_t prepareColorArray(JNIEnv* pEnv, jobjectArray pColorArray, StoreEntry* pValue) {
+	jsize lLength = (*pEnv)->GetArrayLength(pEnv, pColorArray);
+	int32_t* lArray = (int32_t*) malloc(lLength * sizeof(int32_t));
+	if ((lArray == NULL) && (lLength > 0)) {
+		return 0;
+	}
+
+	int32_t i;
+	for (i = 0; i < lLength; ++i) {
+		jobject lLocalColor = (*pEnv)->GetObjectArrayElement(pEnv, pColorArray, i);
+		if(lLocalColor == NULL) {
+			free(lArray);
+			return 0;
+		}
+		lArray[i] = (*pEnv)->GetIntField(pEnv, lLocalColor, gStoreCache.FieldColor);
+		(*pEnv)->DeleteLocalRef(pEnv, lLocalColor);
+	}
+
+	pValue->mType = StoreType_ColorArray;
+	pValue->mLength = lLength;
+	pValue->mValue.mColorArray = lArray;
+	return 1;
+}
+
+JNIEXPORT jobjectArray JNICALL Java_za_co_technodev_javajni_Store_getColorArray__Ljava_lang_String_2
+  (JNIEnv* pEnv, jobject pThis, jstring pKey) {
+	StoreKey lKey;
+	if (!openKey(pEnv, pThis, pKey, &lKey)) {
+		return NULL;
+	}
+	STATS_START(lStart);
+	lockStoreRead(lKey.mShard);
+	jobjectArray lResult = readColorArray(pEnv, findKeyEntry(&lKey));
+	unlockStore(lKey.mShard);
+	STATS_RECORD(lKey.mInstance->mStats, StoreStat_GetColorArray, lStart);
+	closeKey(pEnv, &lKey);
+	return lResult;
+}
+
+JNIEXPORT jobjectArray JNICALL Java_za_co_technodev_javajni_Store_getColorArray__J
+  (JNIEnv* pEnv, jobject pThis, jlong pHandle) {
+	StoreKey lKey;
+	if (!openHandle(pEnv, pThis, pHandle, &lKey)) {
+		return NULL;
+	}
+	STATS_START(lStart);
+	lockStoreRead(lKey.mShard);
+	jobjectArray lResult = readColorArray(pEnv, findKeyEntry(&lKey));
+	unlockStore(lKey.mShard);
+	STATS_RECORD(lKey.mInstance->mStats, StoreStat_GetColorArray, lStart);
+	closeKey(pEnv, &lKey);
+	return lResult;
+}
+
+JNIEXPORT void JNICALL Java_za_co_technodev_javajni_Store_setColorArray__Ljava_lang_String_2_3Lza_co_technodev_javajni_Color_2
+  (JNIEnv* pEnv, jobject pThis, jstring pKey, jobjectArray pColorArray) {
+	StoreKey lKey;
+	if (!openKey(pEnv, pThis, pKey, &lKey)) {
+		return;
+	}
+	STATS_START(lStart);
+	StoreEntry lValue;
+	if (prepareColorArray(pEnv, pColorArray, &lValue)) {
+		lockStoreWrite(lKey.mShard);
+		commitEntry(pEnv, lKey.mShard, reserveEntry(pEnv, &lKey), &lValue);
+		unlockStore(lKey.mShard);
+		STATS_RECORD(lKey.mInstance->mStats, StoreStat_SetColorArray, lStart);
+		publishWrite(lKey.mInstance);
+	}
+	closeKey(pEnv, &lKey);
+}
+
+JNIEXPORT void JNICALL Java_za_co_technodev_javajni_Store_setColorArray__J_3Lza_co_technodev_javajni_Color_2
+  (JNIEnv* pEnv, jobject pThis, jlong pHandle, jobjectArray pColorArray) {
+	StoreKey lKey;
+	if (!openHandle(pEnv, pThis, pHandle, &lKey)) {
+		return;
+	}
+	STATS_START(lStart);
+	StoreEntry lValue;
+	if (prepareColorArray(pEnv, pColorArray, &lValue)) {
+		lockStoreWrite(lKey.mShard);
+		commitEntry(pEnv, lKey.mShard, reserveEntry(pEnv, &lKey), &lValue);
+		unlockStore(lKey.mShard);
+		STATS_RECORD(lKey.mInstance->mStats, StoreStat_SetColorArray, lStart);
+		publishWrite(lKey.mInstance);
+	}
+	closeKey(pEnv, &lKey);
+}
+
+/*
+ * Batched accessors cross the JNI boundary once for a whole set of keys. Keys are routed to their
+ * shard one by one: the shard of the previous key stays locked and the lock only changes hands
+ * when a key falls in another shard, so a store with a single shard is locked once per batch.
+ * Problems are reported per key in an optional status array (see STORE_STATUS_*) instead of an
+ * exception, which would abort the batch on the first missing key. Keys are local references
+ * retrieved one by one and must be deleted inside the loop, otherwise the local reference table
+ * overflows on large batches.
+ */
+
+int32_t openBatchKey(JNIEnv* pEnv, StoreInstance* pInstance, jobjectArray pKeys, jsize pIndex, StoreKey* pStoreKey) {
+	jstring lKey = (jstring) (*pEnv)->GetObjectArrayElement(pEnv, pKeys, pIndex);
+	if (lKey == NULL) {
+		return 0;
+	}
+	if (!openInstanceKey(pEnv, pInstance, lKey, pStoreKey)) {
+		(*pEnv)->DeleteLocalRef(pEnv, lKey);
+		return 0;
+	}
+	return 1;
 }
 
-JNIEXPORT void JNICALL Java_za_co_technodev_javajni_Store_finalizeStore
+void closeBatchKey(JNIEnv* pEnv, StoreKey* pStoreKey) {
+	jstring lKey = pStoreKey->mJavaKey;
+	closeInstanceKey(pEnv, pStoreKey);
+	(*pEnv)->DeleteLocalRef(pEnv, lKey);
+}
+
+void switchShard(Store** pLocked, Store* pShard, int32_t pWrite) {
+	if (*pLocked == pShard) {
+		return;
+	}
+	if (*pLocked != NULL) {
+		unlockStore(*pLocked);
+	}
+	if (pWrite) {
+		lockStoreWrite(pShard);
+	} else {
+		lockStoreRead(pShard);
+	}
+	*pLocked = pShard;
+}
+
+StoreEntry* allocateBatchEntry(JNIEnv* pEnv, StoreKey* pStoreKey, int32_t* pStatus) {
+	StoreEntry* lEntry = reserveBatchEntry(pEnv, pStoreKey, pStatus);
+	if (lEntry != NULL) {
+		releaseEntryValue(pEnv, pStoreKey->mShard, lEntry);
+	}
+	return lEntry;
+}
+
+/*
+ * Same as allocateBatchEntry(), but the current value of the entry is kept for commitEntry().
+ */
+
+StoreEntry* reserveBatchEntry(JNIEnv* pEnv, StoreKey* pStoreKey, int32_t* pStatus) {
+	int32_t lIndex = reserveKeyEntry(pStoreKey);
+	if (lIndex == STORE_EMPTY_SLOT) {
+		*pStatus = STORE_STATUS_STORE_FULL;
+		return NULL;
+	}
+	*pStatus = STORE_STATUS_OK;
+	return getEntry(pStoreKey->mShard, lIndex);
+}
+
+void writeStatus(JNIEnv* pEnv, jintArray pStatus, int32_t* pStatusTmp, jsize pLength) {
+	if (pStatus != NULL) {
+		(*pEnv)->SetIntArrayRegion(pEnv, pStatus, 0, pLength, pStatusTmp);
+	}
+}
+
+JNIEXPORT void JNICALL Java_za_co_technodev_javajni_Store_getIntegers
+  (JNIEnv* pEnv, jobject pThis, jobjectArray pKeys, jintArray pIntegers, jintArray pStatus) {
+	StoreInstance* lInstance = getInstance(pEnv, pThis);
+	if (lInstance == NULL) {
+		return;
+	}
+	jsize lLength = (*pEnv)->GetArrayLength(pEnv, pKeys);
+	int32_t* lValues = (lLength > 0) ? (int32_t*) malloc(2 * lLength * sizeof(int32_t)) : NULL;
+	if (lValues == NULL) {
+		releaseInstance(lInstance);
+		return;
+	}
+	int32_t* lStatus = lValues + lLength;
+
+	STATS_START(lStart);
+	jsize i;
+	Store* lLocked = NULL;
+	for (i = 0; i < lLength; ++i) {
+		StoreKey lKey;
+		StoreEntry* lEntry = NULL;
+		if (openBatchKey(pEnv, lInstance, pKeys, i, &lKey)) {
+			switchShard(&lLocked, lKey.mShard, 0);
+			lEntry = findKeyEntry(&lKey);
+			closeBatchKey(pEnv, &lKey);
+		} else if ((*pEnv)->ExceptionCheck(pEnv)) {
+			break;
+		}
+		lStatus[i] = checkEntry(lEntry, StoreType_Integer);
+		lValues[i] = (lStatus[i] == STORE_STATUS_OK) ? lEntry->mValue.mInteger : 0;
+	}
+	if (lLocked != NULL) {
+		unlockStore(lLocked);
+	}
+	STATS_RECORD(lInstance->mStats, StoreStat_GetBatch, lStart);
+
+	if (i == lLength) {
+		(*pEnv)->SetIntArrayRegion(pEnv, pIntegers, 0, lLength, lValues);
+		writeStatus(pEnv, pStatus, lStatus, lLength);
+	}
+	free(lValues);
+	releaseInstance(lInstance);
+}
+
+JNIEXPORT void JNICALL Java_za_co_technodev_javajni_Store_setIntegers
+  (JNIEnv* pEnv, jobject pThis, jobjectArray pKeys, jintArray pIntegers, jintArray pStatus) {
+	StoreInstance* lInstance = getInstance(pEnv, pThis);
+	if (lInstance == NULL) {
+		return;
+	}
+	jsize lLength = (*pEnv)->GetArrayLength(pEnv, pKeys);
+	int32_t* lValues = (lLength > 0) ? (int32_t*) malloc(2 * lLength * sizeof(int32_t)) : NULL;
+	if (lValues == NULL) {
+		releaseInstance(lInstance);
+		return;
+	}
+	int32_t* lStatus = lValues + lLength;
+
+	//Raises an ArrayIndexOutOfBoundsException if there are less values than keys
+	(*pEnv)->GetIntArrayRegion(pEnv, pIntegers, 0, lLength, lValues);
+	if ((*pEnv)->ExceptionCheck(pEnv)) {
+		free(lValues);
+		releaseInstance(lInstance);
+		return;
+	}
+
+	STATS_START(lStart);
+	jsize i;
+	Store* lLocked = NULL;
+	for (i = 0; i < lLength; ++i) {
+		StoreKey lKey;
+		if (!openBatchKey(pEnv, lInstance, pKeys, i, &lKey)) {
+			if ((*pEnv)->ExceptionCheck(pEnv)) {
+				break;
+			}
+			lStatus[i] = STORE_STATUS_ERROR;
+			continue;
+		}
+		switchShard(&lLocked, lKey.mShard, 1);
+		StoreEntry* lEntry = allocateBatchEntry(pEnv, &lKey, &lStatus[i]);
+		if (lEntry != NULL) {
+			lEntry->mType = StoreType_Integer;
+			lEntry->mValue.mInteger = lValues[i];
+			touchEntry(lKey.mShard, lEntry);
+		}
+		closeBatchKey(pEnv, &lKey);
+	}
+	if (lLocked != NULL) {
+		unlockStore(lLocked);
+	}
+	STATS_RECORD(lInstance->mStats, StoreStat_SetBatch, lStart);
+	publishWrite(lInstance);
+
+	if (i == lLength) {
+		writeStatus(pEnv, pStatus, lStatus, lLength);
+	}
+	free(lValues);
+	releaseInstance(lInstance);
+}
+
+JNIEXPORT jobjectArray JNICALL Java_za_co_technodev_javajni_Store_getStrings
+  (JNIEnv* pEnv, jobject pThis, jobjectArray pKeys, jintArray pStatus) {
+	StoreInstance* lInstance = getInstance(pEnv, pThis);
+	if (lInstance == NULL) {
+		return NULL;
+	}
+	jsize lLength = (*pEnv)->GetArrayLength(pEnv, pKeys);
+	jobjectArray lJavaArray = (*pEnv)->NewObjectArray(pEnv, lLength, gStoreCache.ClassString, NULL);
+	if ((lJavaArray == NULL) || (lLength == 0)) {
+		releaseInstance(lInstance);
+		return lJavaArray;
+	}
+	int32_t* lStatus = (int32_t*) malloc(lLength * sizeof(int32_t));
+	if (lStatus == NULL) {
+		releaseInstance(lInstance);
+		return NULL;
+	}
+
+	STATS_START(lStart);
+	jsize i;
+	Store* lLocked = NULL;
+	for (i = 0; i < lLength; ++i) {
+		StoreKey lKey;
+		StoreEntry* lEntry = NULL;
+		if (openBatchKey(pEnv, lInstance, pKeys, i, &lKey)) {
+			switchShard(&lLocked, lKey.mShard, 0);
+			lEntry = findKeyEntry(&lKey);
+			closeBatchKey(pEnv, &lKey);
+		} else if ((*pEnv)->ExceptionCheck(pEnv)) {
+			break;
+		}
+		lStatus[i] = checkEntry(lEntry, StoreType_String);
+		if (lStatus[i] == STORE_STATUS_OK) {
+			jstring lValue = newEntryString(pEnv, lLocked, lEntry);
+			if (lValue == NULL) {
+				break;
+			}
+			(*pEnv)->SetObjectArrayElement(pEnv, lJavaArray, i, lValue);
+			(*pEnv)->DeleteLocalRef(pEnv, lValue);
+		}
+	}
+	if (lLocked != NULL) {
+		unlockStore(lLocked);
+	}
+	STATS_RECORD(lInstance->mStats, StoreStat_GetBatch, lStart);
+
+	if (i < lLength) {
+		lJavaArray = NULL;
+	} else {
+		writeStatus(pEnv, pStatus, lStatus, lLength);
+	}
+	free(lStatus);
+	releaseInstance(lInstance);
+	return lJavaArray;
+}
+
+JNIEXPORT void JNICALL Java_za_co_technodev_javajni_Store_setStrings
+  (JNIEnv* pEnv, jobject pThis, jobjectArray pKeys, jobjectArray pStrings, jintArray pStatus) {
+	StoreInstance* lInstance = getInstance(pEnv, pThis);
+	if (lInstance == NULL) {
+		return;
+	}
+	jsize lLength = (*pEnv)->GetArrayLength(pEnv, pKeys);
+	int32_t* lStatus = (lLength > 0) ? (int32_t*) malloc(lLength * sizeof(int32_t)) : NULL;
+	if (lStatus == NULL) {
+		releaseInstance(lInstance);
+		return;
+	}
+
+	STATS_START(lStart);
+	jsize i;
+	Store* lLocked = NULL;
+	for (i = 0; i < lLength; ++i) {
+		jstring lString = (jstring) (*pEnv)->GetObjectArrayElement(pEnv, pStrings, i);
+		StoreEntry lValue;
+		StoreKey lKey;
+		if ((lString == NULL) || !prepareString(pEnv, lString, &lValue)) {
+			//Out of bounds or out of memory, stop here
+			if ((*pEnv)->ExceptionCheck(pEnv)) {
+				break;
+			}
+			lStatus[i] = STORE_STATUS_ERROR;
+		} else {
+			if (openBatchKey(pEnv, lInstance, pKeys, i, &lKey)) {
+				switchShard(&lLocked, lKey.mShard, 1);
+				if (!commitEntry(pEnv, lKey.mShard, reserveBatchEntry(pEnv, &lKey, &lStatus[i]), &lValue)) {
+					lStatus[i] = STORE_STATUS_STORE_FULL;
+				}
+				closeBatchKey(pEnv, &lKey);
+			} else {
+				(*pEnv)->DeleteWeakGlobalRef(pEnv, lValue.mJavaString);
+				lStatus[i] = STORE_STATUS_ERROR;
+			}
+			if ((*pEnv)->ExceptionCheck(pEnv)) {
+				(*pEnv)->DeleteLocalRef(pEnv, lString);
+				break;
+			}
+		}
+		(*pEnv)->DeleteLocalRef(pEnv, lString);
+	}
+	if (lLocked != NULL) {
+		unlockStore(lLocked);
+	}
+	STATS_RECORD(lInstance->mStats, StoreStat_SetBatch, lStart);
+	publishWrite(lInstance);
+
+	if (i == lLength) {
+		writeStatus(pEnv, pStatus, lStatus, lLength);
+	}
+	free(lStatus);
+	releaseInstance(lInstance);
+}
+
+/*
+ * Native state is allocated per Java object and referenced from its mNativeStore field. Several
+ * stores are fully independent: data, locks and watcher. With a path, each shard starts from the
+ * image found for it, if any, and is written back by flush() and finalizeStore(). See StoreImage.h.
+ */
+
+JNIEXPORT void JNICALL Java_za_co_technodev_javajni_Store_initializeNativeStore
+  (JNIEnv* pEnv, jobject pThis, jstring pPath, jint pShardCount, jint pScanInterval, jint pRearmInterval) {
+	if ((*pEnv)->GetLongField(pEnv, pThis, gStoreCache.FieldNativeStore) != 0) {
+		throwIllegalStateException(pEnv, "Store is already initialized");
+		return;
+	}
+	StoreInstance* lInstance = createInstance(pShardCount);
+	if (lInstance == NULL) {
+		throwIllegalStateException(pEnv, "Cannot allocate store");
+		return;
+	}
+
+	if (pPath != NULL) {
+		const char* lPathTmp = (*pEnv)->GetStringUTFChars(pEnv, pPath, NULL);
+		if (lPathTmp == NULL) {
+			destroyInstance(pEnv, lInstance);
+			return;
+		}
+		lInstance->mPath = strdup(lPathTmp);
+		(*pEnv)->ReleaseStringUTFChars(pEnv, pPath, lPathTmp);
+		if (lInstance->mPath == NULL) {
+			destroyInstance(pEnv, lInstance);
+			throwIllegalStateException(pEnv, "Cannot allocate store");
+			return;
+		}
+		loadInstance(lInstance);
+	}
+
+	jlong lReference = registerInstance(lInstance);
+	if (lReference == 0) {
+		destroyInstance(pEnv, lInstance);
+		throwIllegalStateException(pEnv, "Cannot allocate store");
+		return;
+	}
+	startWatcher(&lInstance->mWatcher, lInstance->mShards, lInstance->mShardCount, pScanInterval, pRearmInterval);
+	(*pEnv)->SetLongField(pEnv, pThis, gStoreCache.FieldNativeStore, lReference);
+}
+
+JNIEXPORT void JNICALL Java_za_co_technodev_javajni_Store_flush
+  (JNIEnv* pEnv, jobject pThis) {
+	StoreInstance* lInstance = getInstance(pEnv, pThis);
+	if (lInstance == NULL) {
+		return;
+	}
+	if ((lInstance->mPath != NULL) && !saveInstance(lInstance)) {
+		throwIOException(pEnv);
+	}
+	releaseInstance(lInstance);
+}
+
+/*
+ * The whole store crosses JNI once each way, through the memory of a direct buffer, see
+ * StoreExport.h. Store.java checks that the buffer is direct and passes its remaining region.
+ */
+
+JNIEXPORT jlong JNICALL Java_za_co_technodev_javajni_Store_getExportSize
   (JNIEnv* pEnv, jobject pThis) {
-	stopWatcher(pEnv, &mStoreWatcher);
+	StoreInstance* lInstance = getInstance(pEnv, pThis);
+	if (lInstance == NULL) {
+		return 0;
+	}
+	jlong lSize = measureExport(lInstance);
+	releaseInstance(lInstance);
+	return lSize;
+}
+
+JNIEXPORT jint JNICALL Java_za_co_technodev_javajni_Store_exportNativeStore
+  (JNIEnv* pEnv, jobject pThis, jobject pBuffer, jint pOffset, jint pLength) {
+	StoreInstance* lInstance = getInstance(pEnv, pThis);
+	if (lInstance == NULL) {
+		return -1;
+	}
+	char* lData = getBufferRegion(pEnv, pBuffer, pOffset, pLength);
+	if (lData == NULL) {
+		releaseInstance(lInstance);
+		return -1;
+	}
+	int64_t lSize = exportInstance(lInstance, lData, pLength);
+	releaseInstance(lInstance);
+	return (lSize <= pLength) ? (jint) lSize : -1;
+}
+
+JNIEXPORT jint JNICALL Java_za_co_technodev_javajni_Store_importNativeStore
+  (JNIEnv* pEnv, jobject pThis, jobject pBuffer, jint pOffset, jint pLength) {
+	StoreInstance* lInstance = getInstance(pEnv, pThis);
+	if (lInstance == NULL) {
+		return -1;
+	}
+	char* lData = getBufferRegion(pEnv, pBuffer, pOffset, pLength);
+	if (lData == NULL) {
+		releaseInstance(lInstance);
+		return -1;
+	}
+	int32_t lStatus = STORE_STATUS_OK;
+	int64_t lSize = importInstance(pEnv, lInstance, lData, pLength, &lStatus);
+	if (lSize >= 0) {
+		publishWrite(lInstance);
+	}
+	releaseInstance(lInstance);
+	if (lStatus == STORE_STATUS_STORE_FULL) {
+		throwStoreFullException(pEnv);
+	}
+	return (jint) lSize;
+}
+
+/*
+ * Raises an IllegalStateException and returns NULL if the buffer is not direct or too small.
+ */
 
-	StoreEntry* lEntry = mStore.mEntries;
-	StoreEntry* lEntryEnd = lEntry + mStore.mLength;
-	while (lEntry < lEntryEnd) {
-		free(lEntry->mKey);
-		releaseEntryValue(pEnv, lEntry);
+char* getBufferRegion(JNIEnv* pEnv, jobject pBuffer, jint pOffset, jint pLength) {
+	char* lData = (char*) (*pEnv)->GetDirectBufferAddress(pEnv, pBuffer);
+	if ((lData == NULL) || (pOffset < 0) || (pLength < 0)
+	 || ((jlong) pOffset + pLength > (*pEnv)->GetDirectBufferCapacity(pEnv, pBuffer))) {
+		throwIllegalStateException(pEnv, "Invalid buffer");
+		return NULL;
+	}
+	return lData + pOffset;
+}
+
+/*
+ * The image is saved on a best effort basis, flush() reports errors. Calls in progress on other
+ * threads complete first, later calls throw IllegalStateException, see StoreInstanceSlot.
+ * Finalizing a store which is not initialized, or already being finalized, does nothing.
+ */
 
-		++lEntry;
+JNIEXPORT void JNICALL Java_za_co_technodev_javajni_Store_finalizeNativeStore
+  (JNIEnv* pEnv, jobject pThis) {
+	StoreInstance* lInstance = unregisterInstance(pEnv, pThis);
+	if (lInstance == NULL) {
+		return;
+	}
+
+	stopWatcher(&lInstance->mWatcher);
+	if (lInstance->mPath != NULL) {
+		saveInstance(lInstance);
+	}
+	destroyInstance(pEnv, lInstance);
+}
+
+JNIEXPORT jlongArray JNICALL Java_za_co_technodev_javajni_Store_getNativeAlertCounters
+  (JNIEnv* pEnv, jobject pThis) {
+	StoreInstance* lInstance = getInstance(pEnv, pThis);
+	if (lInstance == NULL) {
+		return NULL;
+	}
+	jlong lCounters[3];
+	lCounters[0] = getAlertsQueued(&lInstance->mWatcher);
+	lCounters[1] = getAlertsSuppressed(&lInstance->mWatcher);
+	lCounters[2] = getAlertsDropped(&lInstance->mWatcher);
+	releaseInstance(lInstance);
+
+	jlongArray lJavaArray = (*pEnv)->NewLongArray(pEnv, 3);
+	if (lJavaArray != NULL) {
+		(*pEnv)->SetLongArrayRegion(pEnv, lJavaArray, 0, 3, lCounters);
+	}
+	return lJavaArray;
+}
+
+/*
+ * The alert ring is drained by a Java thread, see StoreAlerts.h. getAlertBuffer() returns NULL if
+ * the watcher is not running. stopAlerts() releases the consumer, which must be done with the ring
+ * before the store is finalized.
+ */
+
+JNIEXPORT jobject JNICALL Java_za_co_technodev_javajni_Store_getAlertBuffer
+  (JNIEnv* pEnv, jobject pThis) {
+	StoreInstance* lInstance = getInstance(pEnv, pThis);
+	if (lInstance == NULL) {
+		return NULL;
+	}
+	jobject lBuffer = newAlertBuffer(pEnv, &lInstance->mWatcher.mAlerts);
+	releaseInstance(lInstance);
+	return lBuffer;
+}
+
+JNIEXPORT jint JNICALL Java_za_co_technodev_javajni_Store_waitAlerts
+  (JNIEnv* pEnv, jobject pThis, jint pTail, jint pTimeout) {
+	StoreInstance* lInstance = getInstance(pEnv, pThis);
+	if (lInstance == NULL) {
+		return -1;
+	}
+	jint lCount = (lInstance->mWatcher.mAlerts.mBuffer != NULL) ? waitAlerts(&lInstance->mWatcher.mAlerts, pTail, pTimeout) : -1;
+	releaseInstance(lInstance);
+	return lCount;
+}
+
+JNIEXPORT void JNICALL Java_za_co_technodev_javajni_Store_stopAlerts
+  (JNIEnv* pEnv, jobject pThis) {
+	StoreInstance* lInstance = getInstance(pEnv, pThis);
+	if (lInstance != NULL) {
+		stopAlertRing(&lInstance->mWatcher.mAlerts);
+		releaseInstance(lInstance);
+	}
+}
+
+/*
+ * Rule type and value are checked by Store.java. The watcher matches keys against the new rules on
+ * its next scan, which is triggered right away.
+ */
+
+JNIEXPORT void JNICALL Java_za_co_technodev_javajni_Store_addRule
+  (JNIEnv* pEnv, jobject pThis, jstring pKeyPattern, jint pRule, jint pLow, jint pHigh, jstring pValue) {
+	StoreInstance* lInstance = getInstance(pEnv, pThis);
+	if (lInstance == NULL) {
+		return;
+	}
+	const char* lPattern = (*pEnv)->GetStringUTFChars(pEnv, pKeyPattern, NULL);
+	if (lPattern == NULL) {
+		releaseInstance(lInstance);
+		return;
+	}
+	const jchar* lValue = NULL;
+	jsize lValueLength = 0;
+	if (pValue != NULL) {
+		lValue = (*pEnv)->GetStringChars(pEnv, pValue, NULL);
+		if (lValue == NULL) {
+			(*pEnv)->ReleaseStringUTFChars(pEnv, pKeyPattern, lPattern);
+			releaseInstance(lInstance);
+			return;
+		}
+		lValueLength = (*pEnv)->GetStringLength(pEnv, pValue);
+	}
+
+	int32_t lAdded = addRule(&lInstance->mWatcher.mRules, (StoreRuleType) pRule, lPattern, pLow, pHigh, lValue, lValueLength);
+	if (lValue != NULL) {
+		(*pEnv)->ReleaseStringChars(pEnv, pValue, lValue);
+	}
+	(*pEnv)->ReleaseStringUTFChars(pEnv, pKeyPattern, lPattern);
+	if (lAdded) {
+		notifyWatcher(&lInstance->mWatcher);
+	} else {
+		throwIllegalStateException(pEnv, "Cannot allocate rule");
+	}
+	releaseInstance(lInstance);
+}
+
+JNIEXPORT void JNICALL Java_za_co_technodev_javajni_Store_clearRules
+  (JNIEnv* pEnv, jobject pThis) {
+	StoreInstance* lInstance = getInstance(pEnv, pThis);
+	if (lInstance != NULL) {
+		clearRules(&lInstance->mWatcher.mRules);
+		releaseInstance(lInstance);
+	}
+}
+
+/*
+ * Returns STORE_STATS_SIZE values laid out as described in StoreStats.h, or null if the library was
+ * built without STORE_STATS.
+ */
+
+JNIEXPORT jlongArray JNICALL Java_za_co_technodev_javajni_Store_getStats
+  (JNIEnv* pEnv, jobject pThis) {
+	StoreInstance* lInstance = getInstance(pEnv, pThis);
+	if (lInstance == NULL) {
+		return NULL;
+	}
+#ifdef STORE_STATS
+	jlong lSnapshot[STORE_STATS_SIZE];
+	snapshotStats(lInstance->mStats, (int64_t*) lSnapshot);
+	releaseInstance(lInstance);
+
+	jlongArray lJavaArray = (*pEnv)->NewLongArray(pEnv, STORE_STATS_SIZE);
+	if (lJavaArray != NULL) {
+		(*pEnv)->SetLongArrayRegion(pEnv, lJavaArray, 0, STORE_STATS_SIZE, lSnapshot);
+	}
+	return lJavaArray;
+#else
+	releaseInstance(lInstance);
+	return NULL;
+#endif
+}
+
+/*
+ * Totals over all shards.
+ */
+
+JNIEXPORT jlongArray JNICALL Java_za_co_technodev_javajni_Store_getAllocatorStats
+  (JNIEnv* pEnv, jobject pThis) {
+	StoreInstance* lInstance = getInstance(pEnv, pThis);
+	if (lInstance == NULL) {
+		return NULL;
+	}
+	jlong lStats[3] = { 0, 0, 0 };
+	int32_t i;
+	for (i = 0; i < lInstance->mShardCount; ++i) {
+		Store* lShard = &lInstance->mShards[i];
+		lockStoreRead(lShard);
+		lStats[0] += lShard->mArena.mLiveBytes;
+		lStats[1] += lShard->mArena.mReservedBytes;
+		lStats[2] += lShard->mArena.mCompactions;
+		unlockStore(lShard);
+	}
+	releaseInstance(lInstance);
+
+	jlongArray lJavaArray = (*pEnv)->NewLongArray(pEnv, 3);
+	if (lJavaArray != NULL) {
+		(*pEnv)->SetLongArrayRegion(pEnv, lJavaArray, 0, 3, lStats);
+	}
+	return lJavaArray;
+}
+
+/*
+ * Natives are bound explicitly when the library is loaded instead of being resolved by symbol name
+ * on first call. JNI descriptors are cached at the same time, see StoreCache.h.
+ */
+
+static JNINativeMethod mNativeMethods[] = {
+	{ "initializeNativeStore", "(Ljava/lang/String;III)V", (void*) Java_za_co_technodev_javajni_Store_initializeNativeStore },
+	{ "finalizeNativeStore", "()V", (void*) Java_za_co_technodev_javajni_Store_finalizeNativeStore },
+	{ "flush", "()V", (void*) Java_za_co_technodev_javajni_Store_flush },
+	{ "getExportSize", "()J", (void*) Java_za_co_technodev_javajni_Store_getExportSize },
+	{ "exportNativeStore", "(Ljava/nio/ByteBuffer;II)I", (void*) Java_za_co_technodev_javajni_Store_exportNativeStore },
+	{ "importNativeStore", "(Ljava/nio/ByteBuffer;II)I", (void*) Java_za_co_technodev_javajni_Store_importNativeStore },
+	{ "resolveKey", "(Ljava/lang/String;)J", (void*) Java_za_co_technodev_javajni_Store_resolveKey },
+	{ "removeKey", "(Ljava/lang/String;)Z", (void*) Java_za_co_technodev_javajni_Store_removeKey },
+	{ "removeKeys", "([Ljava/lang/String;)I", (void*) Java_za_co_technodev_javajni_Store_removeKeys },
+	{ "clearNativeStore", "()V", (void*) Java_za_co_technodev_javajni_Store_clearNativeStore },
+	{ "readKeyPage", "(Ljava/lang/String;ZLjava/lang/String;Ljava/lang/String;[Ljava/lang/String;[I[I[Ljava/lang/Object;)I", (void*) Java_za_co_technodev_javajni_Store_readKeyPage },
+	{ "createSnapshot", "(Ljava/lang/String;)J", (void*) Java_za_co_technodev_javajni_Store_createSnapshot },
+	{ "releaseSnapshot", "(J)V", (void*) Java_za_co_technodev_javajni_Store_releaseSnapshot },
+	{ "getSnapshotInteger", "(JLjava/lang/String;)I", (void*) Java_za_co_technodev_javajni_Store_getSnapshotInteger },
+	{ "getSnapshotString", "(JLjava/lang/String;)Ljava/lang/String;", (void*) Java_za_co_technodev_javajni_Store_getSnapshotString },
+	{ "getSnapshotColor", "(JLjava/lang/String;)Lza/co/technodev/javajni/Color;", (void*) Java_za_co_technodev_javajni_Store_getSnapshotColor },
+	{ "getSnapshotIntegerArray", "(JLjava/lang/String;)[I", (void*) Java_za_co_technodev_javajni_Store_getSnapshotIntegerArray },
+	{ "getSnapshotColorArray", "(JLjava/lang/String;)[Lza/co/technodev/javajni/Color;", (void*) Java_za_co_technodev_javajni_Store_getSnapshotColorArray },
+	{ "getSnapshotKeys", "(J)[Ljava/lang/String;", (void*) Java_za_co_technodev_javajni_Store_getSnapshotKeys },
+	{ "getEntryVersion", "(Ljava/lang/String;)I", (void*) Java_za_co_technodev_javajni_Store_getEntryVersion__Ljava_lang_String_2 },
+	{ "getEntryVersion", "(J)I", (void*) Java_za_co_technodev_javajni_Store_getEntryVersion__J },
+	{ "getVersionBuffer", "()Ljava/nio/ByteBuffer;", (void*) Java_za_co_technodev_javajni_Store_getVersionBuffer },
+	{ "getInteger", "(Ljava/lang/String;)I", (void*) Java_za_co_technodev_javajni_Store_getInteger__Ljava_lang_String_2 },
+	{ "getInteger", "(J)I", (void*) Java_za_co_technodev_javajni_Store_getInteger__J },
+	{ "setInteger", "(Ljava/lang/String;I)V", (void*) Java_za_co_technodev_javajni_Store_setInteger__Ljava_lang_String_2I },
+	{ "setInteger", "(JI)V", (void*) Java_za_co_technodev_javajni_Store_setInteger__JI },
+	{ "getString", "(Ljava/lang/String;)Ljava/lang/String;", (void*) Java_za_co_technodev_javajni_Store_getString__Ljava_lang_String_2 },
+	{ "getString", "(J)Ljava/lang/String;", (void*) Java_za_co_technodev_javajni_Store_getString__J },
+	{ "setString", "(Ljava/lang/String;Ljava/lang/String;)V", (void*) Java_za_co_technodev_javajni_Store_setString__Ljava_lang_String_2Ljava_lang_String_2 },
+	{ "setString", "(JLjava/lang/String;)V", (void*) Java_za_co_technodev_javajni_Store_setString__JLjava_lang_String_2 },
+	{ "getColor", "(Ljava/lang/String;)Lza/co/technodev/javajni/Color;", (void*) Java_za_co_technodev_javajni_Store_getColor__Ljava_lang_String_2 },
+	{ "getColor", "(J)Lza/co/technodev/javajni/Color;", (void*) Java_za_co_technodev_javajni_Store_getColor__J },
+	{ "setColor", "(Ljava/lang/String;Lza/co/technodev/javajni/Color;)V", (void*) Java_za_co_technodev_javajni_Store_setColor__Ljava_lang_String_2Lza_co_technodev_javajni_Color_2 },
+	{ "setColor", "(JLza/co/technodev/javajni/Color;)V", (void*) Java_za_co_technodev_javajni_Store_setColor__JLza_co_technodev_javajni_Color_2 },
+	{ "getIntegerArray", "(Ljava/lang/String;)[I", (void*) Java_za_co_technodev_javajni_Store_getIntegerArray__Ljava_lang_String_2 },
+	{ "getIntegerArray", "(J)[I", (void*) Java_za_co_technodev_javajni_Store_getIntegerArray__J },
+	{ "setIntegerArray", "(Ljava/lang/String;[I)V", (void*) Java_za_co_technodev_javajni_Store_setIntegerArray__Ljava_lang_String_2_3I },
+	{ "setIntegerArray", "(J[I)V", (void*) Java_za_co_technodev_javajni_Store_setIntegerArray__J_3I },
+	{ "getIntegerArrayBuffer", "(Ljava/lang/String;)Ljava/nio/ByteBuffer;", (void*) Java_za_co_technodev_javajni_Store_getIntegerArrayBuffer__Ljava_lang_String_2 },
+	{ "getIntegerArrayBuffer", "(J)Ljava/nio/ByteBuffer;", (void*) Java_za_co_technodev_javajni_Store_getIntegerArrayBuffer__J },
+	{ "appendIntegers", "(Ljava/lang/String;[I)V", (void*) Java_za_co_technodev_javajni_Store_appendIntegers__Ljava_lang_String_2_3I },
+	{ "appendIntegers", "(J[I)V", (void*) Java_za_co_technodev_javajni_Store_appendIntegers__J_3I },
+	{ "getIntegerArrayRegion", "(Ljava/lang/String;II)[I", (void*) Java_za_co_technodev_javajni_Store_getIntegerArrayRegion__Ljava_lang_String_2II },
+	{ "getIntegerArrayRegion", "(JII)[I", (void*) Java_za_co_technodev_javajni_Store_getIntegerArrayRegion__JII },
+	{ "setIntegerArrayRegion", "(Ljava/lang/String;I[I)V", (void*) Java_za_co_technodev_javajni_Store_setIntegerArrayRegion__Ljava_lang_String_2I_3I },
+	{ "setIntegerArrayRegion", "(JI[I)V", (void*) Java_za_co_technodev_javajni_Store_setIntegerArrayRegion__JI_3I },
+	{ "sumIntegerArray", "(Ljava/lang/String;)J", (void*) Java_za_co_technodev_javajni_Store_sumIntegerArray__Ljava_lang_String_2 },
+	{ "sumIntegerArray", "(J)J", (void*) Java_za_co_technodev_javajni_Store_sumIntegerArray__J },
+	{ "minIntegerArray", "(Ljava/lang/String;)I", (void*) Java_za_co_technodev_javajni_Store_minIntegerArray__Ljava_lang_String_2 },
+	{ "minIntegerArray", "(J)I", (void*) Java_za_co_technodev_javajni_Store_minIntegerArray__J },
+	{ "maxIntegerArray", "(Ljava/lang/String;)I", (void*) Java_za_co_technodev_javajni_Store_maxIntegerArray__Ljava_lang_String_2 },
+	{ "maxIntegerArray", "(J)I", (void*) Java_za_co_technodev_javajni_Store_maxIntegerArray__J },
+	{ "countIntegerArray", "(Ljava/lang/String;II)I", (void*) Java_za_co_technodev_javajni_Store_countIntegerArray__Ljava_lang_String_2II },
+	{ "countIntegerArray", "(JII)I", (void*) Java_za_co_technodev_javajni_Store_countIntegerArray__JII },
+	{ "indexOfIntegerArray", "(Ljava/lang/String;I)I", (void*) Java_za_co_technodev_javajni_Store_indexOfIntegerArray__Ljava_lang_String_2I },
+	{ "indexOfIntegerArray", "(JI)I", (void*) Java_za_co_technodev_javajni_Store_indexOfIntegerArray__JI },
+	{ "getIntegerArrayHistogram", "(Ljava/lang/String;III)[I", (void*) Java_za_co_technodev_javajni_Store_getIntegerArrayHistogram__Ljava_lang_String_2III },
+	{ "getIntegerArrayHistogram", "(JIII)[I", (void*) Java_za_co_technodev_javajni_Store_getIntegerArrayHistogram__JIII },
+	{ "getColorArray", "(Ljava/lang/String;)[Lza/co/technodev/javajni/Color;", (void*) Java_za_co_technodev_javajni_Store_getColorArray__Ljava_lang_String_2 },
+	{ "getColorArray", "(J)[Lza/co/technodev/javajni/Color;", (void*) Java_za_co_technodev_javajni_Store_getColorArray__J },
+	{ "setColorArray", "(Ljava/lang/String;[Lza/co/technodev/javajni/Color;)V", (void*) Java_za_co_technodev_javajni_Store_setColorArray__Ljava_lang_String_2_3Lza_co_technodev_javajni_Color_2 },
+	{ "setColorArray", "(J[Lza/co/technodev/javajni/Color;)V", (void*) Java_za_co_technodev_javajni_Store_setColorArray__J_3Lza_co_technodev_javajni_Color_2 },
+	{ "getIntegers", "([Ljava/lang/String;[I[I)V", (void*) Java_za_co_technodev_javajni_Store_getIntegers },
+	{ "setIntegers", "([Ljava/lang/String;[I[I)V", (void*) Java_za_co_technodev_javajni_Store_setIntegers },
+	{ "getStrings", "([Ljava/lang/String;[I)[Ljava/lang/String;", (void*) Java_za_co_technodev_javajni_Store_getStrings },
+	{ "setStrings", "([Ljava/lang/String;[Ljava/lang/String;[I)V", (void*) Java_za_co_technodev_javajni_Store_setStrings },
+	{ "getNativeAlertCounters", "()[J", (void*) Java_za_co_technodev_javajni_Store_getNativeAlertCounters },
+	{ "getAlertBuffer", "()Ljava/nio/ByteBuffer;", (void*) Java_za_co_technodev_javajni_Store_getAlertBuffer },
+	{ "waitAlerts", "(II)I", (void*) Java_za_co_technodev_javajni_Store_waitAlerts },
+	{ "stopAlerts", "()V", (void*) Java_za_co_technodev_javajni_Store_stopAlerts },
+	{ "addRule", "(Ljava/lang/String;IIILjava/lang/String;)V", (void*) Java_za_co_technodev_javajni_Store_addRule },
+	{ "clearRules", "()V", (void*) Java_za_co_technodev_javajni_Store_clearRules },
+	{ "getAllocatorStats", "()[J", (void*) Java_za_co_technodev_javajni_Store_getAllocatorStats },
+	{ "getStats", "()[J", (void*) Java_za_co_technodev_javajni_Store_getStats }
+};
+
+JNIEXPORT jint JNICALL JNI_OnLoad(JavaVM* pJavaVM, void* pReserved) {
+	JNIEnv* lEnv;
+	if ((*pJavaVM)->GetEnv(pJavaVM, (void**) &lEnv, JNI_VERSION_1_6) != JNI_OK) {
+		return JNI_ERR;
+	}
+	if (!initializeCache(lEnv)) {
+		return JNI_ERR;
+	}
+	if ((*lEnv)->RegisterNatives(lEnv, gStoreCache.ClassStore, mNativeMethods,
+			sizeof(mNativeMethods) / sizeof(JNINativeMethod)) != JNI_OK) {
+		releaseCache(lEnv);
+		return JNI_ERR;
+	}
+	return JNI_VERSION_1_6;
+}
+
+JNIEXPORT void JNICALL JNI_OnUnload(JavaVM* pJavaVM, void* pReserved) {
+	JNIEnv* lEnv;
+	if ((*pJavaVM)->GetEnv(pJavaVM, (void**) &lEnv, JNI_VERSION_1_6) != JNI_OK) {
+		return;
+	}
+	if (gStoreCache.ClassStore != NULL) {
+		(*lEnv)->UnregisterNatives(lEnv, gStoreCache.ClassStore);
 	}
-	mStore.mLength = 0;
+	releaseCache(lEnv);
 }
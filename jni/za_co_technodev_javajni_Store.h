@@ -9,18 +9,178 @@ extern "C" {
 #endif
 /*
  * Class:     za_co_technodev_javajni_Store
- * Method:    initializeStore
+ * Method:    initializeNativeStore
+ * Signature: (Ljava/lang/String;III)V
+ */
+JNIEXPORT void JNICALL Java_za_co_technodev_javajni_Store_initializeNativeStore
+  (JNIEnv *, jobject, jstring, jint, jint, jint);
+
+/*
+ * Class:     za_co_technodev_javajni_Store
+ * Method:    finalizeNativeStore
  * Signature: ()V
  */
-JNIEXPORT void JNICALL Java_za_co_technodev_javajni_Store_initializeStore
+JNIEXPORT void JNICALL Java_za_co_technodev_javajni_Store_finalizeNativeStore
   (JNIEnv *, jobject);
 
 /*
  * Class:     za_co_technodev_javajni_Store
- * Method:    finalizeStore
+ * Method:    flush
  * Signature: ()V
  */
-JNIEXPORT void JNICALL Java_za_co_technodev_javajni_Store_finalizeStore
+JNIEXPORT void JNICALL Java_za_co_technodev_javajni_Store_flush
+  (JNIEnv *, jobject);
+
+/*
+ * Class:     za_co_technodev_javajni_Store
+ * Method:    getExportSize
+ * Signature: ()J
+ */
+JNIEXPORT jlong JNICALL Java_za_co_technodev_javajni_Store_getExportSize
+  (JNIEnv *, jobject);
+
+/*
+ * Class:     za_co_technodev_javajni_Store
+ * Method:    exportNativeStore
+ * Signature: (Ljava/nio/ByteBuffer;II)I
+ */
+JNIEXPORT jint JNICALL Java_za_co_technodev_javajni_Store_exportNativeStore
+  (JNIEnv *, jobject, jobject, jint, jint);
+
+/*
+ * Class:     za_co_technodev_javajni_Store
+ * Method:    importNativeStore
+ * Signature: (Ljava/nio/ByteBuffer;II)I
+ */
+JNIEXPORT jint JNICALL Java_za_co_technodev_javajni_Store_importNativeStore
+  (JNIEnv *, jobject, jobject, jint, jint);
+
+/*
+ * Class:     za_co_technodev_javajni_Store
+ * Method:    resolveKey
+ * Signature: (Ljava/lang/String;)J
+ */
+JNIEXPORT jlong JNICALL Java_za_co_technodev_javajni_Store_resolveKey
+  (JNIEnv *, jobject, jstring);
+
+/*
+ * Class:     za_co_technodev_javajni_Store
+ * Method:    removeKey
+ * Signature: (Ljava/lang/String;)Z
+ */
+JNIEXPORT jboolean JNICALL Java_za_co_technodev_javajni_Store_removeKey
+  (JNIEnv *, jobject, jstring);
+
+/*
+ * Class:     za_co_technodev_javajni_Store
+ * Method:    removeKeys
+ * Signature: ([Ljava/lang/String;)I
+ */
+JNIEXPORT jint JNICALL Java_za_co_technodev_javajni_Store_removeKeys
+  (JNIEnv *, jobject, jobjectArray);
+
+/*
+ * Class:     za_co_technodev_javajni_Store
+ * Method:    clearNativeStore
+ * Signature: ()V
+ */
+JNIEXPORT void JNICALL Java_za_co_technodev_javajni_Store_clearNativeStore
+  (JNIEnv *, jobject);
+
+/*
+ * Class:     za_co_technodev_javajni_Store
+ * Method:    readKeyPage
+ * Signature: (Ljava/lang/String;ZLjava/lang/String;Ljava/lang/String;[Ljava/lang/String;[I[I[Ljava/lang/Object;)I
+ */
+JNIEXPORT jint JNICALL Java_za_co_technodev_javajni_Store_readKeyPage
+  (JNIEnv *, jobject, jstring, jboolean, jstring, jstring, jobjectArray, jintArray, jintArray, jobjectArray);
+
+/*
+ * Class:     za_co_technodev_javajni_Store
+ * Method:    createSnapshot
+ * Signature: (Ljava/lang/String;)J
+ */
+JNIEXPORT jlong JNICALL Java_za_co_technodev_javajni_Store_createSnapshot
+  (JNIEnv *, jobject, jstring);
+
+/*
+ * Class:     za_co_technodev_javajni_Store
+ * Method:    releaseSnapshot
+ * Signature: (J)V
+ */
+JNIEXPORT void JNICALL Java_za_co_technodev_javajni_Store_releaseSnapshot
+  (JNIEnv *, jobject, jlong);
+
+/*
+ * Class:     za_co_technodev_javajni_Store
+ * Method:    getSnapshotInteger
+ * Signature: (JLjava/lang/String;)I
+ */
+JNIEXPORT jint JNICALL Java_za_co_technodev_javajni_Store_getSnapshotInteger
+  (JNIEnv *, jobject, jlong, jstring);
+
+/*
+ * Class:     za_co_technodev_javajni_Store
+ * Method:    getSnapshotString
+ * Signature: (JLjava/lang/String;)Ljava/lang/String;
+ */
+JNIEXPORT jstring JNICALL Java_za_co_technodev_javajni_Store_getSnapshotString
+  (JNIEnv *, jobject, jlong, jstring);
+
+/*
+ * Class:     za_co_technodev_javajni_Store
+ * Method:    getSnapshotColor
+ * Signature: (JLjava/lang/String;)Lza/co/technodev/javajni/Color;
+ */
+JNIEXPORT jobject JNICALL Java_za_co_technodev_javajni_Store_getSnapshotColor
+  (JNIEnv *, jobject, jlong, jstring);
+
+/*
+ * Class:     za_co_technodev_javajni_Store
+ * Method:    getSnapshotIntegerArray
+ * Signature: (JLjava/lang/String;)[I
+ */
+JNIEXPORT jintArray JNICALL Java_za_co_technodev_javajni_Store_getSnapshotIntegerArray
+  (JNIEnv *, jobject, jlong, jstring);
+
+/*
+ * Class:     za_co_technodev_javajni_Store
+ * Method:    getSnapshotColorArray
+ * Signature: (JLjava/lang/String;)[Lza/co/technodev/javajni/Color;
+ */
+JNIEXPORT jobjectArray JNICALL Java_za_co_technodev_javajni_Store_getSnapshotColorArray
+  (JNIEnv *, jobject, jlong, jstring);
+
+/*
+ * Class:     za_co_technodev_javajni_Store
+ * Method:    getSnapshotKeys
+ * Signature: (J)[Ljava/lang/String;
+ */
+JNIEXPORT jobjectArray JNICALL Java_za_co_technodev_javajni_Store_getSnapshotKeys
+  (JNIEnv *, jobject, jlong);
+
+/*
+ * Class:     za_co_technodev_javajni_Store
+ * Method:    getEntryVersion
+ * Signature: (Ljava/lang/String;)I
+ */
+JNIEXPORT jint JNICALL Java_za_co_technodev_javajni_Store_getEntryVersion__Ljava_lang_String_2
+  (JNIEnv *, jobject, jstring);
+
+/*
+ * Class:     za_co_technodev_javajni_Store
+ * Method:    getEntryVersion
+ * Signature: (J)I
+ */
+JNIEXPORT jint JNICALL Java_za_co_technodev_javajni_Store_getEntryVersion__J
+  (JNIEnv *, jobject, jlong);
+
+/*
+ * Class:     za_co_technodev_javajni_Store
+ * Method:    getVersionBuffer
+ * Signature: ()Ljava/nio/ByteBuffer;
+ */
+JNIEXPORT jobject JNICALL Java_za_co_technodev_javajni_Store_getVersionBuffer
   (JNIEnv *, jobject);
 
 /*
@@ -28,81 +188,417 @@ JNIEXPORT void JNICALL Java_za_co_technodev_javajni_Store_finalizeStore
  * Method:    getInteger
  * Signature: (Ljava/lang/String;)I
  */
-JNIEXPORT jint JNICALL Java_za_co_technodev_javajni_Store_getInteger
+JNIEXPORT jint JNICALL Java_za_co_technodev_javajni_Store_getInteger__Ljava_lang_String_2
   (JNIEnv *, jobject, jstring);
 
+/*
+ * Class:     za_co_technodev_javajni_Store
+ * Method:    getInteger
+ * Signature: (J)I
+ */
+JNIEXPORT jint JNICALL Java_za_co_technodev_javajni_Store_getInteger__J
+  (JNIEnv *, jobject, jlong);
+
 /*
  * Class:     za_co_technodev_javajni_Store
  * Method:    setInteger
  * Signature: (Ljava/lang/String;I)V
  */
-JNIEXPORT void JNICALL Java_za_co_technodev_javajni_Store_setInteger
+JNIEXPORT void JNICALL Java_za_co_technodev_javajni_Store_setInteger__Ljava_lang_String_2I
   (JNIEnv *, jobject, jstring, jint);
 
+/*
+ * Class:     za_co_technodev_javajni_Store
+ * Method:    setInteger
+ * Signature: (JI)V
+ */
+JNIEXPORT void JNICALL Java_za_co_technodev_javajni_Store_setInteger__JI
+  (JNIEnv *, jobject, jlong, jint);
+
 /*
  * Class:     za_co_technodev_javajni_Store
  * Method:    getString
  * Signature: (Ljava/lang/String;)Ljava/lang/String;
  */
-JNIEXPORT jstring JNICALL Java_za_co_technodev_javajni_Store_getString
+JNIEXPORT jstring JNICALL Java_za_co_technodev_javajni_Store_getString__Ljava_lang_String_2
   (JNIEnv *, jobject, jstring);
 
+/*
+ * Class:     za_co_technodev_javajni_Store
+ * Method:    getString
+ * Signature: (J)Ljava/lang/String;
+ */
+JNIEXPORT jstring JNICALL Java_za_co_technodev_javajni_Store_getString__J
+  (JNIEnv *, jobject, jlong);
+
 /*
  * Class:     za_co_technodev_javajni_Store
  * Method:    setString
  * Signature: (Ljava/lang/String;Ljava/lang/String;)V
  */
-JNIEXPORT void JNICALL Java_za_co_technodev_javajni_Store_setString
+JNIEXPORT void JNICALL Java_za_co_technodev_javajni_Store_setString__Ljava_lang_String_2Ljava_lang_String_2
   (JNIEnv *, jobject, jstring, jstring);
 
+/*
+ * Class:     za_co_technodev_javajni_Store
+ * Method:    setString
+ * Signature: (JLjava/lang/String;)V
+ */
+JNIEXPORT void JNICALL Java_za_co_technodev_javajni_Store_setString__JLjava_lang_String_2
+  (JNIEnv *, jobject, jlong, jstring);
+
 /*
  * Class:     za_co_technodev_javajni_Store
  * Method:    getColor
  * Signature: (Ljava/lang/String;)Lza/co/technodev/javajni/Color;
  */
-JNIEXPORT jobject JNICALL Java_za_co_technodev_javajni_Store_getColor
+JNIEXPORT jobject JNICALL Java_za_co_technodev_javajni_Store_getColor__Ljava_lang_String_2
   (JNIEnv *, jobject, jstring);
 
+/*
+ * Class:     za_co_technodev_javajni_Store
+ * Method:    getColor
+ * Signature: (J)Lza/co/technodev/javajni/Color;
+ */
+JNIEXPORT jobject JNICALL Java_za_co_technodev_javajni_Store_getColor__J
+  (JNIEnv *, jobject, jlong);
+
 /*
  * Class:     za_co_technodev_javajni_Store
  * Method:    setColor
  * Signature: (Ljava/lang/String;Lza/co/technodev/javajni/Color;)V
  */
-JNIEXPORT void JNICALL Java_za_co_technodev_javajni_Store_setColor
+JNIEXPORT void JNICALL Java_za_co_technodev_javajni_Store_setColor__Ljava_lang_String_2Lza_co_technodev_javajni_Color_2
   (JNIEnv *, jobject, jstring, jobject);
 
+/*
+ * Class:     za_co_technodev_javajni_Store
+ * Method:    setColor
+ * Signature: (JLza/co/technodev/javajni/Color;)V
+ */
+JNIEXPORT void JNICALL Java_za_co_technodev_javajni_Store_setColor__JLza_co_technodev_javajni_Color_2
+  (JNIEnv *, jobject, jlong, jobject);
+
 /*
  * Class:     za_co_technodev_javajni_Store
  * Method:    getIntegerArray
  * Signature: (Ljava/lang/String;)[I
  */
-JNIEXPORT jintArray JNICALL Java_za_co_technodev_javajni_Store_getIntegerArray
+JNIEXPORT jintArray JNICALL Java_za_co_technodev_javajni_Store_getIntegerArray__Ljava_lang_String_2
   (JNIEnv *, jobject, jstring);
 
+/*
+ * Class:     za_co_technodev_javajni_Store
+ * Method:    getIntegerArray
+ * Signature: (J)[I
+ */
+JNIEXPORT jintArray JNICALL Java_za_co_technodev_javajni_Store_getIntegerArray__J
+  (JNIEnv *, jobject, jlong);
+
 /*
  * Class:     za_co_technodev_javajni_Store
  * Method:    setIntegerArray
  * Signature: (Ljava/lang/String;[I)V
  */
-JNIEXPORT void JNICALL Java_za_co_technodev_javajni_Store_setIntegerArray
+JNIEXPORT void JNICALL Java_za_co_technodev_javajni_Store_setIntegerArray__Ljava_lang_String_2_3I
+  (JNIEnv *, jobject, jstring, jintArray);
+
+/*
+ * Class:     za_co_technodev_javajni_Store
+ * Method:    setIntegerArray
+ * Signature: (J[I)V
+ */
+JNIEXPORT void JNICALL Java_za_co_technodev_javajni_Store_setIntegerArray__J_3I
+  (JNIEnv *, jobject, jlong, jintArray);
+
+/*
+ * Class:     za_co_technodev_javajni_Store
+ * Method:    getIntegerArrayBuffer
+ * Signature: (Ljava/lang/String;)Ljava/nio/ByteBuffer;
+ */
+JNIEXPORT jobject JNICALL Java_za_co_technodev_javajni_Store_getIntegerArrayBuffer__Ljava_lang_String_2
+  (JNIEnv *, jobject, jstring);
+
+/*
+ * Class:     za_co_technodev_javajni_Store
+ * Method:    getIntegerArrayBuffer
+ * Signature: (J)Ljava/nio/ByteBuffer;
+ */
+JNIEXPORT jobject JNICALL Java_za_co_technodev_javajni_Store_getIntegerArrayBuffer__J
+  (JNIEnv *, jobject, jlong);
+
+/*
+ * Class:     za_co_technodev_javajni_Store
+ * Method:    appendIntegers
+ * Signature: (Ljava/lang/String;[I)V
+ */
+JNIEXPORT void JNICALL Java_za_co_technodev_javajni_Store_appendIntegers__Ljava_lang_String_2_3I
   (JNIEnv *, jobject, jstring, jintArray);
 
+/*
+ * Class:     za_co_technodev_javajni_Store
+ * Method:    appendIntegers
+ * Signature: (J[I)V
+ */
+JNIEXPORT void JNICALL Java_za_co_technodev_javajni_Store_appendIntegers__J_3I
+  (JNIEnv *, jobject, jlong, jintArray);
+
+/*
+ * Class:     za_co_technodev_javajni_Store
+ * Method:    getIntegerArrayRegion
+ * Signature: (Ljava/lang/String;II)[I
+ */
+JNIEXPORT jintArray JNICALL Java_za_co_technodev_javajni_Store_getIntegerArrayRegion__Ljava_lang_String_2II
+  (JNIEnv *, jobject, jstring, jint, jint);
+
+/*
+ * Class:     za_co_technodev_javajni_Store
+ * Method:    getIntegerArrayRegion
+ * Signature: (JII)[I
+ */
+JNIEXPORT jintArray JNICALL Java_za_co_technodev_javajni_Store_getIntegerArrayRegion__JII
+  (JNIEnv *, jobject, jlong, jint, jint);
+
+/*
+ * Class:     za_co_technodev_javajni_Store
+ * Method:    setIntegerArrayRegion
+ * Signature: (Ljava/lang/String;I[I)V
+ */
+JNIEXPORT void JNICALL Java_za_co_technodev_javajni_Store_setIntegerArrayRegion__Ljava_lang_String_2I_3I
+  (JNIEnv *, jobject, jstring, jint, jintArray);
+
+/*
+ * Class:     za_co_technodev_javajni_Store
+ * Method:    setIntegerArrayRegion
+ * Signature: (JI[I)V
+ */
+JNIEXPORT void JNICALL Java_za_co_technodev_javajni_Store_setIntegerArrayRegion__JI_3I
+  (JNIEnv *, jobject, jlong, jint, jintArray);
+
+/*
+ * Class:     za_co_technodev_javajni_Store
+ * Method:    sumIntegerArray
+ * Signature: (Ljava/lang/String;)J
+ */
+JNIEXPORT jlong JNICALL Java_za_co_technodev_javajni_Store_sumIntegerArray__Ljava_lang_String_2
+  (JNIEnv *, jobject, jstring);
+
+/*
+ * Class:     za_co_technodev_javajni_Store
+ * Method:    sumIntegerArray
+ * Signature: (J)J
+ */
+JNIEXPORT jlong JNICALL Java_za_co_technodev_javajni_Store_sumIntegerArray__J
+  (JNIEnv *, jobject, jlong);
+
+/*
+ * Class:     za_co_technodev_javajni_Store
+ * Method:    minIntegerArray
+ * Signature: (Ljava/lang/String;)I
+ */
+JNIEXPORT jint JNICALL Java_za_co_technodev_javajni_Store_minIntegerArray__Ljava_lang_String_2
+  (JNIEnv *, jobject, jstring);
+
+/*
+ * Class:     za_co_technodev_javajni_Store
+ * Method:    minIntegerArray
+ * Signature: (J)I
+ */
+JNIEXPORT jint JNICALL Java_za_co_technodev_javajni_Store_minIntegerArray__J
+  (JNIEnv *, jobject, jlong);
+
+/*
+ * Class:     za_co_technodev_javajni_Store
+ * Method:    maxIntegerArray
+ * Signature: (Ljava/lang/String;)I
+ */
+JNIEXPORT jint JNICALL Java_za_co_technodev_javajni_Store_maxIntegerArray__Ljava_lang_String_2
+  (JNIEnv *, jobject, jstring);
+
+/*
+ * Class:     za_co_technodev_javajni_Store
+ * Method:    maxIntegerArray
+ * Signature: (J)I
+ */
+JNIEXPORT jint JNICALL Java_za_co_technodev_javajni_Store_maxIntegerArray__J
+  (JNIEnv *, jobject, jlong);
+
+/*
+ * Class:     za_co_technodev_javajni_Store
+ * Method:    countIntegerArray
+ * Signature: (Ljava/lang/String;II)I
+ */
+JNIEXPORT jint JNICALL Java_za_co_technodev_javajni_Store_countIntegerArray__Ljava_lang_String_2II
+  (JNIEnv *, jobject, jstring, jint, jint);
+
+/*
+ * Class:     za_co_technodev_javajni_Store
+ * Method:    countIntegerArray
+ * Signature: (JII)I
+ */
+JNIEXPORT jint JNICALL Java_za_co_technodev_javajni_Store_countIntegerArray__JII
+  (JNIEnv *, jobject, jlong, jint, jint);
+
+/*
+ * Class:     za_co_technodev_javajni_Store
+ * Method:    indexOfIntegerArray
+ * Signature: (Ljava/lang/String;I)I
+ */
+JNIEXPORT jint JNICALL Java_za_co_technodev_javajni_Store_indexOfIntegerArray__Ljava_lang_String_2I
+  (JNIEnv *, jobject, jstring, jint);
+
+/*
+ * Class:     za_co_technodev_javajni_Store
+ * Method:    indexOfIntegerArray
+ * Signature: (JI)I
+ */
+JNIEXPORT jint JNICALL Java_za_co_technodev_javajni_Store_indexOfIntegerArray__JI
+  (JNIEnv *, jobject, jlong, jint);
+
+/*
+ * Class:     za_co_technodev_javajni_Store
+ * Method:    getIntegerArrayHistogram
+ * Signature: (Ljava/lang/String;III)[I
+ */
+JNIEXPORT jintArray JNICALL Java_za_co_technodev_javajni_Store_getIntegerArrayHistogram__Ljava_lang_String_2III
+  (JNIEnv *, jobject, jstring, jint, jint, jint);
+
+/*
+ * Class:     za_co_technodev_javajni_Store
+ * Method:    getIntegerArrayHistogram
+ * Signature: (JIII)[I
+ */
+JNIEXPORT jintArray JNICALL Java_za_co_technodev_javajni_Store_getIntegerArrayHistogram__JIII
+  (JNIEnv *, jobject, jlong, jint, jint, jint);
+
 /*
  * Class:     za_co_technodev_javajni_Store
  * Method:    getColorArray
  * Signature: (Ljava/lang/String;)[Lza/co/technodev/javajni/Color;
  */
-JNIEXPORT jobjectArray JNICALL Java_za_co_technodev_javajni_Store_getColorArray
+JNIEXPORT jobjectArray JNICALL Java_za_co_technodev_javajni_Store_getColorArray__Ljava_lang_String_2
   (JNIEnv *, jobject, jstring);
 
+/*
+ * Class:     za_co_technodev_javajni_Store
+ * Method:    getColorArray
+ * Signature: (J)[Lza/co/technodev/javajni/Color;
+ */
+JNIEXPORT jobjectArray JNICALL Java_za_co_technodev_javajni_Store_getColorArray__J
+  (JNIEnv *, jobject, jlong);
+
 /*
  * Class:     za_co_technodev_javajni_Store
  * Method:    setColorArray
  * Signature: (Ljava/lang/String;[Lza/co/technodev/javajni/Color;)V
  */
-JNIEXPORT void JNICALL Java_za_co_technodev_javajni_Store_setColorArray
+JNIEXPORT void JNICALL Java_za_co_technodev_javajni_Store_setColorArray__Ljava_lang_String_2_3Lza_co_technodev_javajni_Color_2
   (JNIEnv *, jobject, jstring, jobjectArray);
 
+/*
+ * Class:     za_co_technodev_javajni_Store
+ * Method:    setColorArray
+ * Signature: (J[Lza/co/technodev/javajni/Color;)V
+ */
+JNIEXPORT void JNICALL Java_za_co_technodev_javajni_Store_setColorArray__J_3Lza_co_technodev_javajni_Color_2
+  (JNIEnv *, jobject, jlong, jobjectArray);
+
+/*
+ * Class:     za_co_technodev_javajni_Store
+ * Method:    getIntegers
+ * Signature: ([Ljava/lang/String;[I[I)V
+ */
+JNIEXPORT void JNICALL Java_za_co_technodev_javajni_Store_getIntegers
+  (JNIEnv *, jobject, jobjectArray, jintArray, jintArray);
+
+/*
+ * Class:     za_co_technodev_javajni_Store
+ * Method:    setIntegers
+ * Signature: ([Ljava/lang/String;[I[I)V
+ */
+JNIEXPORT void JNICALL Java_za_co_technodev_javajni_Store_setIntegers
+  (JNIEnv *, jobject, jobjectArray, jintArray, jintArray);
+
+/*
+ * Class:     za_co_technodev_javajni_Store
+ * Method:    getStrings
+ * Signature: ([Ljava/lang/String;[I)[Ljava/lang/String;
+ */
+JNIEXPORT jobjectArray JNICALL Java_za_co_technodev_javajni_Store_getStrings
+  (JNIEnv *, jobject, jobjectArray, jintArray);
+
+/*
+ * Class:     za_co_technodev_javajni_Store
+ * Method:    setStrings
+ * Signature: ([Ljava/lang/String;[Ljava/lang/String;[I)V
+ */
+JNIEXPORT void JNICALL Java_za_co_technodev_javajni_Store_setStrings
+  (JNIEnv *, jobject, jobjectArray, jobjectArray, jintArray);
+
+/*
+ * Class:     za_co_technodev_javajni_Store
+ * Method:    getNativeAlertCounters
+ * Signature: ()[J
+ */
+JNIEXPORT jlongArray JNICALL Java_za_co_technodev_javajni_Store_getNativeAlertCounters
+  (JNIEnv *, jobject);
+
+/*
+ * Class:     za_co_technodev_javajni_Store
+ * Method:    getAlertBuffer
+ * Signature: ()Ljava/nio/ByteBuffer;
+ */
+JNIEXPORT jobject JNICALL Java_za_co_technodev_javajni_Store_getAlertBuffer
+  (JNIEnv *, jobject);
+
+/*
+ * Class:     za_co_technodev_javajni_Store
+ * Method:    waitAlerts
+ * Signature: (II)I
+ */
+JNIEXPORT jint JNICALL Java_za_co_technodev_javajni_Store_waitAlerts
+  (JNIEnv *, jobject, jint, jint);
+
+/*
+ * Class:     za_co_technodev_javajni_Store
+ * Method:    stopAlerts
+ * Signature: ()V
+ */
+JNIEXPORT void JNICALL Java_za_co_technodev_javajni_Store_stopAlerts
+  (JNIEnv *, jobject);
+
+/*
+ * Class:     za_co_technodev_javajni_Store
+ * Method:    addRule
+ * Signature: (Ljava/lang/String;IIILjava/lang/String;)V
+ */
+JNIEXPORT void JNICALL Java_za_co_technodev_javajni_Store_addRule
+  (JNIEnv *, jobject, jstring, jint, jint, jint, jstring);
+
+/*
+ * Class:     za_co_technodev_javajni_Store
+ * Method:    clearRules
+ * Signature: ()V
+ */
+JNIEXPORT void JNICALL Java_za_co_technodev_javajni_Store_clearRules
+  (JNIEnv *, jobject);
+
+/*
+ * Class:     za_co_technodev_javajni_Store
+ * Method:    getAllocatorStats
+ * Signature: ()[J
+ */
+JNIEXPORT jlongArray JNICALL Java_za_co_technodev_javajni_Store_getAllocatorStats
+  (JNIEnv *, jobject);
+
+/*
+ * Class:     za_co_technodev_javajni_Store
+ * Method:    getStats
+ * Signature: ()[J
+ */
+JNIEXPORT jlongArray JNICALL Java_za_co_technodev_javajni_Store_getStats
+  (JNIEnv *, jobject);
+
 #ifdef __cplusplus
 }
 #endif
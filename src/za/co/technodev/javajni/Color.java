@@ -8,6 +8,21 @@ public class Color {
 		mColor = android.graphics.Color.parseColor(pColor);
 	}
 	
+	/*
+	 * Used by native code, which stores colors as packed ARGB values.
+	 */
+	public Color(int pColor) {
+		super();
+		mColor = pColor;
+	}
+	
+	/*
+	 * Packed ARGB value, as stored by native code.
+	 */
+	int getARGB() {
+		return mColor;
+	}
+	
 	@Override
 	public String toString() {
 		return String.format("#%06X", mColor);
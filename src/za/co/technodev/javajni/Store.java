@@ -1,5 +1,14 @@
 package za.co.technodev.javajni;
 
+import java.io.IOException;
+import java.nio.BufferOverflowException;
+import java.nio.ByteBuffer;
+import java.nio.ByteOrder;
+import java.nio.IntBuffer;
+import java.util.ArrayList;
+import java.util.LinkedHashMap;
+import java.util.Map;
+
 import za.co.technodev.exception.InvalidTypeException;
 import za.co.technodev.exception.NotExistingKeyException;
 import android.os.Handler;
@@ -10,65 +19,640 @@ import android.os.Handler;
  * magically on the initial thread. Handlers are a popular and easy inter=thread communication
  * technique on Android.
  * 
- * Declare a delegate StoreListener to which messages (that is, a method call) received from the
- * watcher thread are going to be posted. This will be the StoreActivity.
+ * Declare a delegate StoreListener to which alerts raised by the watcher thread are going to be
+ * posted. This will be the StoreActivity. The watcher queues alerts in native memory, from which a
+ * StoreAlertConsumer thread drains them and posts each batch with a single message.
  */
 
-public class Store implements StoreListener {
+public class Store {
 	static {
 		System.loadLibrary("store");
 	}
+	
+	/*
+	 * Per-key status filled by batched accessors.
+	 */
+	public static final int STATUS_OK = 0;
+	public static final int STATUS_NOT_EXISTING_KEY = 1;
+	public static final int STATUS_INVALID_TYPE = 2;
+	public static final int STATUS_STORE_FULL = 3;
+	public static final int STATUS_ERROR = 4;
+	
+	/*
+	 * Milliseconds between two watcher scans when nothing is written. Writes wake the watcher up
+	 * right away.
+	 */
+	public static final int DEFAULT_SCAN_INTERVAL = 5000;
+	
+	/*
+	 * An entry is reported once when it enters its alert condition. With a positive rearm interval
+	 * (milliseconds), an entry still in alert is reported again after that interval.
+	 */
+	public static final int NO_REARM = 0;
+	
+	/*
+	 * Watcher rules, see addIntegerRule() and siblings. A rule alerts when an entry of its type
+	 * matches: an integer out of range, a string equal to, different from or starting with a value,
+	 * a color equal to another. A counter rule does not alert, the watcher increments the integer
+	 * once per scan interval instead, however many writes wake it up in between.
+	 */
+	public static final int RULE_INTEGER_OUTSIDE = 0;
+	public static final int RULE_STRING_EQUALS = 1;
+	public static final int RULE_STRING_DIFFERS = 2;
+	public static final int RULE_STRING_PREFIX = 3;
+	public static final int RULE_COLOR_EQUALS = 4;
+	public static final int RULE_COUNTER = 5;
+	
+	/*
+	 * Indexes in the array returned by getAlertCounters().
+	 */
+	public static final int ALERTS_DELIVERED = 0;
+	public static final int ALERTS_SUPPRESSED = 1;
+	public static final int ALERTS_DROPPED = 2;
+	public static final int ALERTS_STALE = 3;
+	public static final int ALERTS_QUEUED = 4;
+
+	/*
+	 * Indexes in the array returned by getAllocatorStats().
+	 */
+	public static final int ALLOCATOR_LIVE_BYTES = 0;
+	public static final int ALLOCATOR_RESERVED_BYTES = 1;
+	public static final int ALLOCATOR_COMPACTIONS = 2;
 
+	/*
+	 * Statistics reported by getStats(), see StoreStats. All are durations in nanoseconds except
+	 * STAT_LOOKUP_PROBES, the number of slots probed per key lookup, and STAT_WATCHER_SCAN_SIZE, the
+	 * number of entries visited per shard scan.
+	 */
+	public static final int STAT_GET_INTEGER = 0;
+	public static final int STAT_SET_INTEGER = 1;
+	public static final int STAT_GET_STRING = 2;
+	public static final int STAT_SET_STRING = 3;
+	public static final int STAT_GET_COLOR = 4;
+	public static final int STAT_SET_COLOR = 5;
+	public static final int STAT_GET_INTEGER_ARRAY = 6;
+	public static final int STAT_SET_INTEGER_ARRAY = 7;
+	public static final int STAT_AGGREGATE_INTEGER_ARRAY = 8;
+	public static final int STAT_GET_COLOR_ARRAY = 9;
+	public static final int STAT_SET_COLOR_ARRAY = 10;
+	public static final int STAT_GET_BATCH = 11;
+	public static final int STAT_SET_BATCH = 12;
+	public static final int STAT_RESOLVE_KEY = 13;
+	public static final int STAT_ENTRY_VERSION = 14;
+	public static final int STAT_LOOKUP_PROBES = 15;
+	public static final int STAT_WATCHER_SCAN = 16;
+	public static final int STAT_WATCHER_LOCK_WAIT = 17;
+	public static final int STAT_WATCHER_LOCK_HOLD = 18;
+	public static final int STAT_WATCHER_CALLBACK = 19;
+	public static final int STAT_WATCHER_SCAN_SIZE = 20;
+	public static final int STAT_COUNT = 21;
+	public static final int STATS_BUCKETS = 32;
+	public static final int STATS_STRIDE = 2 + STATS_BUCKETS;
+
+	/*
+	 * Keys are spread over independently locked shards by hash, so that writers to different keys
+	 * rarely contend. Counts are rounded down to a power of two.
+	 */
+	public static final int DEFAULT_SHARD_COUNT = 1;
+	public static final int MAX_SHARD_COUNT = 64;
+
+	//Native state owned by this instance, 0 until initializeStore()
+	private long mNativeStore;
+	//Store version maintained by native code, null when the store is not initialized
+	private volatile ByteBuffer mVersionBuffer;
+	//In access order, the least recently read key is evicted past READ_CACHE_SIZE keys
+	private final LinkedHashMap<String, CachedValue> mReadCache = new LinkedHashMap<String, CachedValue>(16, 0.75f, true) {
+		@Override
+		protected boolean removeEldestEntry(Map.Entry<String, CachedValue> pEldest) {
+			return size() > READ_CACHE_SIZE;
+		}
+	};
 	private Handler mHandler;
 	private StoreListener mDelegateListener;
+	//Running between initializeStore() and finalizeStore(), unless the watcher could not start
+	private StoreAlertConsumer mAlertConsumer;
 
 	public Store(StoreListener pListener) {
 		mHandler = new Handler();
 		mDelegateListener = pListener;
 	}
 	
-	@Override
-	public void onAlert(final int pValue) {
-		mHandler.post(new Runnable() {
-			public void run() {
-				mDelegateListener.onAlert(pValue);
+	/*
+	 * Each Store owns its native data and watcher, several instances do not share keys. Accessors
+	 * are thread-safe without being synchronized: each shard is protected by a reader-writer lock,
+	 * so that getters called from several threads run in parallel. Accessors throw
+	 * IllegalStateException before initializeStore() and after finalizeStore().
+	 */
+	public void initializeStore() {
+		initializeStore(DEFAULT_SCAN_INTERVAL, NO_REARM);
+	}
+	
+	public void initializeStore(int pScanInterval) {
+		initializeStore(pScanInterval, NO_REARM);
+	}
+	
+	public void initializeStore(int pScanInterval, int pRearmInterval) {
+		initializeStore(null, DEFAULT_SHARD_COUNT, pScanInterval, pRearmInterval);
+	}
+	
+	/*
+	 * A file-backed store starts from the image previously saved at pPath, if any, and is written
+	 * back there atomically by flush() and finalizeStore(). Loading maps the image in memory, values
+	 * are only read from the file when accessed. An unreadable image is ignored and replaced on
+	 * next save. With several shards, shard i > 0 is saved next to pPath as "pPath.i".
+	 */
+	public void initializeStore(String pPath) {
+		initializeStore(pPath, DEFAULT_SHARD_COUNT, DEFAULT_SCAN_INTERVAL, NO_REARM);
+	}
+	
+	public void initializeStore(String pPath, int pShardCount) {
+		initializeStore(pPath, pShardCount, DEFAULT_SCAN_INTERVAL, NO_REARM);
+	}
+	
+	public void initializeStore(String pPath, int pShardCount, int pScanInterval, int pRearmInterval) {
+		initializeNativeStore(pPath, pShardCount, pScanInterval, pRearmInterval);
+		clearReadCache();
+		mVersionBuffer = getVersionBuffer().order(ByteOrder.nativeOrder());
+		ByteBuffer lAlertBuffer = getAlertBuffer();
+		if (lAlertBuffer != null) {
+			mAlertConsumer = new StoreAlertConsumer(this, lAlertBuffer.order(ByteOrder.nativeOrder()), mHandler, mDelegateListener);
+			mAlertConsumer.start();
+		}
+	}
+	
+	private native void initializeNativeStore(String pPath, int pShardCount, int pScanInterval, int pRearmInterval);
+	
+	/*
+	 * Saves a file-backed store, does nothing otherwise. finalizeStore() saves too but ignores
+	 * errors.
+	 */
+	public native void flush() throws IOException;
+	public void finalizeStore() {
+		//The version buffer stays readable, but the version of a finalized store is meaningless
+		mVersionBuffer = null;
+		stopAlertConsumer();
+		clearReadCache();
+		finalizeNativeStore();
+	}
+	
+	private void stopAlertConsumer() {
+		if (mAlertConsumer == null) {
+			return;
+		}
+		stopAlerts();
+		boolean lInterrupted = false;
+		while (true) {
+			try {
+				mAlertConsumer.join();
+				break;
+			} catch (InterruptedException e) {
+				lInterrupted = true;
+			}
+		}
+		if (lInterrupted) {
+			Thread.currentThread().interrupt();
+		}
+		mAlertConsumer = null;
+	}
+	
+	private native void finalizeNativeStore();
+	
+	/*
+	 * Copies the whole store in or out of a direct buffer in a single native call, in a compact
+	 * binary format documented in StoreExport.h. An export can be imported into any store, whatever
+	 * its shard count. exportTo() writes a consistent copy of the store at the position of the buffer
+	 * and moves the position past it. It throws BufferOverflowException, and writes nothing, if the
+	 * remaining room is too small: getExportSize() tells how much an export needs, unless the store
+	 * grows in between. importFrom() sets every key of the export read at the position of the buffer,
+	 * other keys being kept, and moves the position past it. It throws IllegalArgumentException, and
+	 * imports nothing, if the buffer does not hold a valid export. Both return the export size.
+	 */
+	public native long getExportSize();
+	
+	public int exportTo(ByteBuffer pBuffer) {
+		checkDirectBuffer(pBuffer);
+		int lSize = exportNativeStore(pBuffer, pBuffer.position(), pBuffer.remaining());
+		if (lSize < 0) {
+			throw new BufferOverflowException();
+		}
+		pBuffer.position(pBuffer.position() + lSize);
+		return lSize;
+	}
+	
+	public int importFrom(ByteBuffer pBuffer) {
+		checkDirectBuffer(pBuffer);
+		int lSize = importNativeStore(pBuffer, pBuffer.position(), pBuffer.remaining());
+		if (lSize < 0) {
+			throw new IllegalArgumentException("Invalid store export");
+		}
+		pBuffer.position(pBuffer.position() + lSize);
+		return lSize;
+	}
+	
+	private void checkDirectBuffer(ByteBuffer pBuffer) {
+		if (!pBuffer.isDirect()) {
+			throw new IllegalArgumentException("Buffer must be direct");
+		}
+	}
+	
+	private native int exportNativeStore(ByteBuffer pBuffer, int pOffset, int pLength);
+	private native int importNativeStore(ByteBuffer pBuffer, int pOffset, int pLength);
+	
+	/*
+	 * A handle identifies a key without converting and looking it up again on each call. Resolving a
+	 * key which is not in the store yet reserves it: reading it throws NotExistingKeyException until
+	 * a value is set. A handle remains valid until its key is removed. From then on, it behaves as a
+	 * key which is not in the store, even if the key is added again: the key must be resolved again.
+	 */
+	public native long resolveKey(String pKey);
+	
+	/*
+	 * Removed keys release their value at once, their native memory is reused by keys added later.
+	 * remove() returns whether the key had a value, removeAll() how many keys had one. Keys reserved
+	 * through a handle are removed too. The watcher drops removed keys on its next scan.
+	 */
+	public boolean remove(String pKey) {
+		boolean lRemoved = removeKey(pKey);
+		synchronized (mReadCache) {
+			mReadCache.remove(pKey);
+		}
+		return lRemoved;
+	}
+	
+	public int removeAll(String[] pKeys) {
+		int lRemoved = removeKeys(pKeys);
+		synchronized (mReadCache) {
+			for (String lKey : pKeys) {
+				mReadCache.remove(lKey);
 			}
-		});
+		}
+		return lRemoved;
 	}
 	
-	@Override
-	public void onAlert(final String pValue) {
-		mHandler.post(new Runnable() {
-			public void run() {
-				mDelegateListener.onAlert(pValue);
+	public void clear() {
+		clearNativeStore();
+		clearReadCache();
+	}
+	
+	private native boolean removeKey(String pKey);
+	private native int removeKeys(String[] pKeys);
+	private native void clearNativeStore();
+	
+	/*
+	 * Keys are kept ordered natively, in the order of String.compareTo() except for '\u0000' which
+	 * sorts between '\u007F' and '\u0080'. keysWithPrefix() lists the keys starting with pPrefix,
+	 * keysInRange() those from pFrom included to pTo excluded, a null bound leaving the range open.
+	 * Keys reserved through a handle are only listed once they have a value. Both read KEY_PAGE_SIZE
+	 * keys per native call, each page being consistent on its own: a key written while a long list
+	 * is read may or may not be in it. A cursor reads the values along with the keys, a page at a time.
+	 */
+	public static final int KEY_PAGE_SIZE = 256;
+	
+	public String[] keysWithPrefix(String pPrefix) {
+		return readKeys(new StoreCursor(this, pPrefix, null, pPrefix, KEY_PAGE_SIZE, false));
+	}
+	
+	public String[] keysInRange(String pFrom, String pTo) {
+		return readKeys(new StoreCursor(this, pFrom, pTo, null, KEY_PAGE_SIZE, false));
+	}
+	
+	public StoreCursor openCursor(String pFrom, String pTo, int pPageSize) {
+		return new StoreCursor(this, pFrom, pTo, null, pPageSize, true);
+	}
+	
+	public StoreCursor openPrefixCursor(String pPrefix, int pPageSize) {
+		return new StoreCursor(this, pPrefix, null, pPrefix, pPageSize, true);
+	}
+	
+	private String[] readKeys(StoreCursor pCursor) {
+		ArrayList<String> lKeys = new ArrayList<String>();
+		while (pCursor.next()) {
+			for (int i = 0; i < pCursor.getLength(); ++i) {
+				lKeys.add(pCursor.getKey(i));
 			}
-		});
+		}
+		return lKeys.toArray(new String[lKeys.size()]);
+	}
+	
+	native int readKeyPage(String pFrom, boolean pInclusive, String pTo, String pPrefix,
+			String[] pKeys, int[] pTypes, int[] pIntegers, Object[] pObjects);
+
+	/*
+	 * A snapshot is a read-only view of the store, or of the keys starting with pPrefix, as it was at
+	 * a single point in time across all keys. Writes keep the versions snapshots may still read, so
+	 * taking a snapshot copies nothing and costs the same whatever the store size. Reading a snapshot
+	 * takes no lock, writers never wait for it. It keeps its versions, even past finalizeStore(),
+	 * until release(): holding a snapshot holds the values overwritten since.
+	 */
+	public StoreSnapshot snapshot() {
+		return snapshot(null);
+	}
+
+	public StoreSnapshot snapshot(String pPrefix) {
+		return new StoreSnapshot(this, createSnapshot(pPrefix));
+	}
+
+	private native long createSnapshot(String pPrefix);
+	native void releaseSnapshot(long pSnapshot);
+	native int getSnapshotInteger(long pSnapshot, String pKey) throws NotExistingKeyException, InvalidTypeException;
+	native String getSnapshotString(long pSnapshot, String pKey) throws NotExistingKeyException, InvalidTypeException;
+	native Color getSnapshotColor(long pSnapshot, String pKey) throws NotExistingKeyException, InvalidTypeException;
+	native int[] getSnapshotIntegerArray(long pSnapshot, String pKey) throws NotExistingKeyException, InvalidTypeException;
+	native Color[] getSnapshotColorArray(long pSnapshot, String pKey) throws NotExistingKeyException, InvalidTypeException;
+	native String[] getSnapshotKeys(long pSnapshot);
+
+	/*
+	 * Cached getters return the object materialized by the previous call for the same key as long as
+	 * the store has not been written in between, without any native call or allocation. After a
+	 * write anywhere in the store, the modification counter of the entry is checked natively and the
+	 * value is only fetched again if the entry itself changed. Returned objects are shared between
+	 * callers: arrays must not be modified. A write performed by another thread is seen once its
+	 * store version is visible to the calling thread. Writes through getIntegerArrayView() are not
+	 * versioned: a cached array does not see them until the entry is written through a setter, or
+	 * the cache is cleared by clearReadCache(). At most READ_CACHE_SIZE keys are cached, the least
+	 * recently read ones being evicted first.
+	 */
+	public static final int READ_CACHE_SIZE = 1024;
+	
+	public String getCachedString(String pKey) throws NotExistingKeyException, InvalidTypeException {
+		return (String) getCachedValue(pKey, CachedValue.TYPE_STRING);
+	}
+	
+	public Color getCachedColor(String pKey) throws NotExistingKeyException, InvalidTypeException {
+		return (Color) getCachedValue(pKey, CachedValue.TYPE_COLOR);
+	}
+	
+	public int[] getCachedIntegerArray(String pKey) throws NotExistingKeyException, InvalidTypeException {
+		return (int[]) getCachedValue(pKey, CachedValue.TYPE_INTEGER_ARRAY);
+	}
+	
+	public void clearReadCache() {
+		synchronized (mReadCache) {
+			mReadCache.clear();
+		}
+	}
+	
+	private static class CachedValue {
+		static final int TYPE_STRING = 0;
+		static final int TYPE_COLOR = 1;
+		static final int TYPE_INTEGER_ARRAY = 2;
+		
+		int mType;
+		Object mValue;
+		int mEntryVersion;
+		int mStoreVersion;
 	}
 	
-	@Override
-	public void onAlert(final Color pValue) {
-		mHandler.post(new Runnable() {
-			public void run() {
-				mDelegateListener.onAlert(pValue);
+	private Object getCachedValue(String pKey, int pType) throws NotExistingKeyException, InvalidTypeException {
+		ByteBuffer lVersionBuffer = mVersionBuffer;
+		if (lVersionBuffer == null) {
+			throw new IllegalStateException("Store is not initialized");
+		}
+		int lStoreVersion = lVersionBuffer.getInt(0);
+		CachedValue lCachedValue;
+		synchronized (mReadCache) {
+			lCachedValue = mReadCache.get(pKey);
+			if ((lCachedValue != null) && (lCachedValue.mType == pType)) {
+				if (lCachedValue.mStoreVersion == lStoreVersion) {
+					return lCachedValue.mValue;
+				}
+			} else {
+				lCachedValue = null;
+			}
+		}
+		
+		//Version is read before the value: a write in between only causes a useless refresh later
+		int lEntryVersion = getEntryVersion(pKey);
+		if ((lCachedValue != null) && (lCachedValue.mEntryVersion == lEntryVersion)) {
+			synchronized (mReadCache) {
+				lCachedValue.mStoreVersion = lStoreVersion;
 			}
-		});
-	}	
+			return lCachedValue.mValue;
+		}
+		
+		lCachedValue = new CachedValue();
+		lCachedValue.mType = pType;
+		lCachedValue.mEntryVersion = lEntryVersion;
+		lCachedValue.mStoreVersion = lStoreVersion;
+		switch (pType) {
+		case CachedValue.TYPE_STRING:
+			lCachedValue.mValue = getString(pKey);
+			break;
+		case CachedValue.TYPE_COLOR:
+			lCachedValue.mValue = getColor(pKey);
+			break;
+		default:
+			lCachedValue.mValue = getIntegerArray(pKey);
+			break;
+		}
+		synchronized (mReadCache) {
+			mReadCache.put(pKey, lCachedValue);
+		}
+		return lCachedValue.mValue;
+	}
+	
+	/*
+	 * Modification counter of an entry, -1 if the key is not in the store.
+	 */
+	public native int getEntryVersion(String pKey);
+	public native int getEntryVersion(long pHandle);
+	private native ByteBuffer getVersionBuffer();
+	
+	public native int getInteger(String pKey) throws NotExistingKeyException, InvalidTypeException;
+	public native int getInteger(long pHandle) throws NotExistingKeyException, InvalidTypeException;
+	public native void setInteger(String pKey, int pInt);
+	public native void setInteger(long pHandle, int pInt) throws NotExistingKeyException;
+	
+	public native String getString(String pKey) throws NotExistingKeyException, InvalidTypeException;
+	public native String getString(long pHandle) throws NotExistingKeyException, InvalidTypeException;
+	public native void setString(String pKey, String pString);
+	public native void setString(long pHandle, String pString) throws NotExistingKeyException;
+	
+	public native Color getColor(String pKey) throws NotExistingKeyException, InvalidTypeException;
+	public native Color getColor(long pHandle) throws NotExistingKeyException, InvalidTypeException;
+	public native void setColor(String pKey, Color pColor);
+	public native void setColor(long pHandle, Color pColor) throws NotExistingKeyException;
+	
+	public native int[] getIntegerArray(String pKey) throws NotExistingKeyException;
+	public native int[] getIntegerArray(long pHandle) throws NotExistingKeyException;
+	public native void setIntegerArray(String pKey, int[] pIntArray);
+	public native void setIntegerArray(long pHandle, int[] pIntArray) throws NotExistingKeyException;
+	
+	/*
+	 * Appends pIntArray at the end of an IntegerArray entry, which is created if the key has no
+	 * value. Native storage grows geometrically, so appending k values costs O(k) on average.
+	 * Regions read or overwrite pLength elements (the length of pIntArray) starting at pOffset, and
+	 * throw ArrayIndexOutOfBoundsException if they do not fit in the current array.
+	 */
+	public native void appendIntegers(String pKey, int[] pIntArray) throws InvalidTypeException;
+	public native void appendIntegers(long pHandle, int[] pIntArray) throws NotExistingKeyException, InvalidTypeException;
+	
+	public native int[] getIntegerArrayRegion(String pKey, int pOffset, int pLength) throws NotExistingKeyException, InvalidTypeException;
+	public native int[] getIntegerArrayRegion(long pHandle, int pOffset, int pLength) throws NotExistingKeyException, InvalidTypeException;
+	public native void setIntegerArrayRegion(String pKey, int pOffset, int[] pIntArray) throws NotExistingKeyException, InvalidTypeException;
+	public native void setIntegerArrayRegion(long pHandle, int pOffset, int[] pIntArray) throws NotExistingKeyException, InvalidTypeException;
+	
+	/*
+	 * Zero-copy view on the native content of an IntegerArray entry. The view reflects later writes
+	 * of an array with the same length and region updates, which are performed in place. It becomes
+	 * invalid, and must not be used anymore, as soon as the entry is written with a different length
+	 * or another type, appended to, removed by remove() or removeAll(), overwritten by importFrom(),
+	 * or when the store is cleared by clear() or finalized. Accesses through the view bypass the
+	 * shard locks, and writes through it change neither the store nor the entry version, see
+	 * getCachedIntegerArray().
+	 */
+	public IntBuffer getIntegerArrayView(String pKey) throws NotExistingKeyException, InvalidTypeException {
+		return getIntegerArrayBuffer(pKey).order(ByteOrder.nativeOrder()).asIntBuffer();
+	}
+	
+	public IntBuffer getIntegerArrayView(long pHandle) throws NotExistingKeyException, InvalidTypeException {
+		return getIntegerArrayBuffer(pHandle).order(ByteOrder.nativeOrder()).asIntBuffer();
+	}
+	
+	private native ByteBuffer getIntegerArrayBuffer(String pKey) throws NotExistingKeyException, InvalidTypeException;
+	private native ByteBuffer getIntegerArrayBuffer(long pHandle) throws NotExistingKeyException, InvalidTypeException;
+	
+	/*
+	 * Aggregates computed natively over an IntegerArray entry, without copying it to Java. The sum
+	 * is computed on 64 bits and cannot overflow. An empty array has Integer.MAX_VALUE as minimum
+	 * and Integer.MIN_VALUE as maximum. countIntegerArray() counts values between pLow and pHigh
+	 * included, indexOfIntegerArray() returns -1 if pValue is not found.
+	 */
+	public native long sumIntegerArray(String pKey) throws NotExistingKeyException, InvalidTypeException;
+	public native long sumIntegerArray(long pHandle) throws NotExistingKeyException, InvalidTypeException;
+	public native int minIntegerArray(String pKey) throws NotExistingKeyException, InvalidTypeException;
+	public native int minIntegerArray(long pHandle) throws NotExistingKeyException, InvalidTypeException;
+	public native int maxIntegerArray(String pKey) throws NotExistingKeyException, InvalidTypeException;
+	public native int maxIntegerArray(long pHandle) throws NotExistingKeyException, InvalidTypeException;
+	public native int countIntegerArray(String pKey, int pLow, int pHigh) throws NotExistingKeyException, InvalidTypeException;
+	public native int countIntegerArray(long pHandle, int pLow, int pHigh) throws NotExistingKeyException, InvalidTypeException;
+	public native int indexOfIntegerArray(String pKey, int pValue) throws NotExistingKeyException, InvalidTypeException;
+	public native int indexOfIntegerArray(long pHandle, int pValue) throws NotExistingKeyException, InvalidTypeException;
+	
+	/*
+	 * Splits [pLow, pHigh] into pBucketCount buckets of equal width and returns how many values of
+	 * the IntegerArray entry fall in each of them. Values outside the range are not counted.
+	 */
+	public int[] histogramIntegerArray(String pKey, int pLow, int pHigh, int pBucketCount) throws NotExistingKeyException, InvalidTypeException {
+		checkHistogram(pLow, pHigh, pBucketCount);
+		return getIntegerArrayHistogram(pKey, pLow, pHigh, pBucketCount);
+	}
+	
+	public int[] histogramIntegerArray(long pHandle, int pLow, int pHigh, int pBucketCount) throws NotExistingKeyException, InvalidTypeException {
+		checkHistogram(pLow, pHigh, pBucketCount);
+		return getIntegerArrayHistogram(pHandle, pLow, pHigh, pBucketCount);
+	}
+	
+	private void checkHistogram(int pLow, int pHigh, int pBucketCount) {
+		if ((pLow > pHigh) || (pBucketCount <= 0)) {
+			throw new IllegalArgumentException("Invalid histogram range or bucket count");
+		}
+	}
+	
+	private native int[] getIntegerArrayHistogram(String pKey, int pLow, int pHigh, int pBucketCount) throws NotExistingKeyException, InvalidTypeException;
+	private native int[] getIntegerArrayHistogram(long pHandle, int pLow, int pHigh, int pBucketCount) throws NotExistingKeyException, InvalidTypeException;
+	
+	public native Color[] getColorArray(String pKey) throws NotExistingKeyException;
+	public native Color[] getColorArray(long pHandle) throws NotExistingKeyException;
+	public native void setColorArray(String pKey, Color[] pColorArray);
+	public native void setColorArray(long pHandle, Color[] pColorArray) throws NotExistingKeyException;
 	
-	public native void initializeStore();
-	public native void finalizeStore();
+	/*
+	 * Batched accessors handle a whole set of keys in one native call, consecutive keys of the same
+	 * shard sharing one lock acquisition. They do not throw on a missing key or a wrong type: the
+	 * outcome for each key is written in pStatus (STATUS_*), which may be null if the caller does
+	 * not care.
+	 */
+	public native void getIntegers(String[] pKeys, int[] pIntegers, int[] pStatus);
+	public native void setIntegers(String[] pKeys, int[] pIntegers, int[] pStatus);
 	
-	public native synchronized int getInteger(String pKey) throws NotExistingKeyException, InvalidTypeException;
-	public native synchronized void setInteger(String pKey, int pInt);
+	public native String[] getStrings(String[] pKeys, int[] pStatus);
+	public native void setStrings(String[] pKeys, String[] pStrings, int[] pStatus);
 	
-	public native synchronized String getString(String pKey) throws NotExistingKeyException, InvalidTypeException;
-	public native synchronized void setString(String pKey, String pString);
+	/*
+	 * The watcher only looks at entries with a rule attached. A key pattern is either a key or a
+	 * prefix followed by '*', "*" alone matching every key. Each entry follows its most specific
+	 * rule: a key wins over prefixes and a longer prefix over a shorter one. Rules last until
+	 * clearRules() or finalizeStore().
+	 */
+	public void addIntegerRule(String pKeyPattern, int pLow, int pHigh) {
+		checkKeyPattern(pKeyPattern);
+		if (pLow > pHigh) {
+			throw new IllegalArgumentException("Invalid integer range");
+		}
+		addRule(pKeyPattern, RULE_INTEGER_OUTSIDE, pLow, pHigh, null);
+	}
+	
+	public void addStringRule(String pKeyPattern, int pRule, String pValue) {
+		checkKeyPattern(pKeyPattern);
+		if (((pRule != RULE_STRING_EQUALS) && (pRule != RULE_STRING_DIFFERS) && (pRule != RULE_STRING_PREFIX))
+				|| (pValue == null)) {
+			throw new IllegalArgumentException("Invalid string rule");
+		}
+		addRule(pKeyPattern, pRule, 0, 0, pValue);
+	}
 	
-	public native synchronized Color getColor(String pKey) throws NotExistingKeyException, InvalidTypeException;
-	public native synchronized void setColor(String pKey, Color pColor);
+	public void addColorRule(String pKeyPattern, Color pColor) {
+		checkKeyPattern(pKeyPattern);
+		if (pColor == null) {
+			throw new IllegalArgumentException("Invalid color rule");
+		}
+		addRule(pKeyPattern, RULE_COLOR_EQUALS, pColor.getARGB(), 0, null);
+	}
 	
-	public native synchronized int[] getIntegerArray(String pKey) throws NotExistingKeyException;
-	public native synchronized void setIntegerArray(String pKey, int[] pIntArray);
+	public void addCounterRule(String pKeyPattern) {
+		checkKeyPattern(pKeyPattern);
+		addRule(pKeyPattern, RULE_COUNTER, 0, 0, null);
+	}
+	
+	private void checkKeyPattern(String pKeyPattern) {
+		if (pKeyPattern == null) {
+			throw new IllegalArgumentException("Invalid key pattern");
+		}
+	}
 	
-	public native synchronized Color[] getColorArray(String pKey) throws NotExistingKeyException;
-	public native synchronized void setColorArray(String pKey, Color[] pColorArray);
+	private native void addRule(String pKeyPattern, int pRule, int pLow, int pHigh, String pValue);
+	public native void clearRules();
+	
+	/*
+	 * Number of alerts since initializeStore(): delivered to the listener, suppressed as duplicates,
+	 * dropped because the listener fell too far behind, and stale, string alerts whose entry changed
+	 * before they were drained, see StoreAlertConsumer. Alerts are counted as queued when the watcher
+	 * fires them and as delivered only once the listener ran, those still queued or posted to the
+	 * handler being neither stale nor delivered yet.
+	 */
+	public long[] getAlertCounters() {
+		long[] lNativeCounters = getNativeAlertCounters();
+		long[] lCounters = new long[5];
+		lCounters[ALERTS_QUEUED] = lNativeCounters[0];
+		lCounters[ALERTS_SUPPRESSED] = lNativeCounters[1];
+		lCounters[ALERTS_DROPPED] = lNativeCounters[2];
+		StoreAlertConsumer lAlertConsumer = mAlertConsumer;
+		if (lAlertConsumer != null) {
+			lCounters[ALERTS_DELIVERED] = lAlertConsumer.getDelivered();
+			lCounters[ALERTS_STALE] = lAlertConsumer.getStale();
+		}
+		return lCounters;
+	}
+	
+	//Queued, suppressed and dropped
+	private native long[] getNativeAlertCounters();
+	
+	private native ByteBuffer getAlertBuffer();
+	native int waitAlerts(int pTail, int pTimeout);
+	private native void stopAlerts();
+
+	/*
+	 * Keys and strings are allocated from a native arena which is compacted when most of it is
+	 * dead. Reports bytes held by live keys and strings, bytes reserved from the system and the
+	 * number of compactions so far.
+	 */
+	public native long[] getAllocatorStats();
+
+	/*
+	 * Compact snapshot of the native instrumentation since initializeStore(): for each STAT_*,
+	 * STATS_STRIDE values (count, sum, then STATS_BUCKETS log2 buckets), best read through
+	 * StoreStats. Returns null unless libstore was built with "ndk-build STORE_STATS=1".
+	 */
+	public native long[] getStats();
 }
\ No newline at end of file
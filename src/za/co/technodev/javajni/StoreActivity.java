@@ -65,6 +65,10 @@ public class StoreActivity extends Activity implements StoreListener{
 	protected void onStart() {
 		super.onStart();
 		mStore.initializeStore();
+		mStore.addIntegerRule("*", -1000, 1000);
+		mStore.addStringRule("*", Store.RULE_STRING_DIFFERS, "apple");
+		mStore.addColorRule("*", new Color("white"));
+		mStore.addCounterRule("watcherCounter");
 		mStore.setInteger("watcherCounter", 0);
 	}
 	
@@ -0,0 +1,128 @@
+package za.co.technodev.javajni;
+
+import java.nio.ByteBuffer;
+import java.util.concurrent.atomic.AtomicLong;
+
+import za.co.technodev.exception.InvalidTypeException;
+import za.co.technodev.exception.NotExistingKeyException;
+import android.os.Handler;
+
+/*
+ * Drains the ring in which the watcher queues alerts, see StoreAlerts.h, and posts each batch to
+ * the listener with a single Runnable. Records are read straight from native memory, the only
+ * native call per batch being waitAlerts(), which gives the slots read back and waits for the next
+ * ones. A string alert carries the handle of its key and the version of the entry it fired on. The
+ * string is read here rather than on the thread of the handler, and only delivered if the entry is
+ * still at that version: an alert whose key was written, removed or retyped since is dropped, the
+ * listener never gets a string the rule did not fire on. Such alerts are counted as stale, and the
+ * others as delivered once the listener ran, see Store.getAlertCounters().
+ */
+
+class StoreAlertConsumer extends Thread {
+	//Layout of StoreAlertBuffer and StoreAlertRecord
+	private static final int CAPACITY_OFFSET = 8;
+	private static final int RECORDS_OFFSET = 16;
+	private static final int RECORD_SIZE = 16;
+	private static final int HANDLE_OFFSET = 0;
+	private static final int TYPE_OFFSET = 8;
+	private static final int VALUE_OFFSET = 12;
+	//Milliseconds, waitAlerts() returns as soon as alerts are published or the ring is stopped
+	private static final int WAIT_TIMEOUT = 1000;
+
+	private static final int TYPE_INTEGER = StoreType.Integer.ordinal();
+	private static final int TYPE_STRING = StoreType.String.ordinal();
+
+	private final Store mStore;
+	private final ByteBuffer mBuffer;
+	private final Handler mHandler;
+	private final StoreListener mListener;
+	private final AtomicLong mDelivered = new AtomicLong();
+	private final AtomicLong mStale = new AtomicLong();
+
+	StoreAlertConsumer(Store pStore, ByteBuffer pBuffer, Handler pHandler, StoreListener pListener) {
+		super("StoreAlertConsumer");
+		mStore = pStore;
+		mBuffer = pBuffer;
+		mHandler = pHandler;
+		mListener = pListener;
+	}
+
+	@Override
+	public void run() {
+		int lMask = mBuffer.getInt(CAPACITY_OFFSET) - 1;
+		int lTail = 0;
+		int lCount;
+		while ((lCount = mStore.waitAlerts(lTail, WAIT_TIMEOUT)) >= 0) {
+			if (lCount == 0) {
+				continue;
+			}
+			int[] lTypes = new int[lCount];
+			int[] lValues = new int[lCount];
+			Object[] lObjects = new Object[lCount];
+			int lLength = 0;
+			for (int i = 0; i < lCount; ++i, ++lTail) {
+				int lOffset = RECORDS_OFFSET + (lTail & lMask) * RECORD_SIZE;
+				int lType = mBuffer.getInt(lOffset + TYPE_OFFSET);
+				int lValue = mBuffer.getInt(lOffset + VALUE_OFFSET);
+				if (lType == TYPE_STRING) {
+					lObjects[lLength] = readString(mBuffer.getLong(lOffset + HANDLE_OFFSET), lValue);
+					if (lObjects[lLength] == null) {
+						mStale.incrementAndGet();
+						continue;
+					}
+				} else if (lType != TYPE_INTEGER) {
+					lObjects[lLength] = new Color(lValue);
+				}
+				lTypes[lLength] = lType;
+				lValues[lLength] = lValue;
+				++lLength;
+			}
+			post(lTypes, lValues, lObjects, lLength);
+		}
+	}
+
+	long getDelivered() {
+		return mDelivered.get();
+	}
+
+	long getStale() {
+		return mStale.get();
+	}
+
+	/*
+	 * Returns null unless the entry is at pVersion both before and after its string is read.
+	 */
+	private String readString(long pHandle, int pVersion) {
+		try {
+			if (mStore.getEntryVersion(pHandle) != pVersion) {
+				return null;
+			}
+			String lString = mStore.getString(pHandle);
+			return (mStore.getEntryVersion(pHandle) == pVersion) ? lString : null;
+		} catch (NotExistingKeyException e) {
+			return null;
+		} catch (InvalidTypeException e) {
+			return null;
+		}
+	}
+
+	private void post(final int[] pTypes, final int[] pValues, final Object[] pObjects, final int pLength) {
+		if (pLength == 0) {
+			return;
+		}
+		mHandler.post(new Runnable() {
+			public void run() {
+				for (int i = 0; i < pLength; ++i) {
+					if (pTypes[i] == TYPE_INTEGER) {
+						mListener.onAlert(pValues[i]);
+					} else if (pTypes[i] == TYPE_STRING) {
+						mListener.onAlert((String) pObjects[i]);
+					} else {
+						mListener.onAlert((Color) pObjects[i]);
+					}
+				}
+				mDelivered.addAndGet(pLength);
+			}
+		});
+	}
+}
@@ -0,0 +1,859 @@
+package za.co.technodev.javajni;
+
+import java.io.File;
+import java.io.FileWriter;
+import java.io.IOException;
+import java.util.ArrayList;
+import java.util.Random;
+import java.util.concurrent.CountDownLatch;
+import java.util.concurrent.TimeUnit;
+
+import za.co.technodev.exception.InvalidTypeException;
+import za.co.technodev.exception.NotExistingKeyException;
+import za.co.technodev.exception.StoreFullException;
+import android.util.Log;
+
+/*
+ * Rough timings of the native store, written to logcat. Must run on a Store which has been
+ * initialized. Each benchmark populates its own keys, prefixed with "bench.", before measuring.
+ *
+ * Every measurement is also recorded as a CSV row (see RESULTS_HEADER), logged under RESULTS_TAG
+ * and saved by saveResults(), so that runs of two libstore builds can be compared by a script:
+ * adb logcat -s StoreBenchmarkResults.
+ */
+
+public class StoreBenchmark {
+	private static final String TAG = "StoreBenchmark";
+	private static final String RESULTS_TAG = "StoreBenchmarkResults";
+	public static final String RESULTS_HEADER = "benchmark,operations,total_ns,ns_per_op";
+
+	private Store mStore;
+	private ArrayList<String> mResults = new ArrayList<String>();
+
+	public StoreBenchmark(Store pStore) {
+		mStore = pStore;
+	}
+
+	private String[] makeKeys(String pPrefix, int pCount) {
+		String[] lKeys = new String[pCount];
+		for (int i = 0; i < pCount; ++i) {
+			lKeys[i] = pPrefix + i;
+		}
+		return lKeys;
+	}
+
+	private long report(String pName, long pStartTime, int pOperations) {
+		long lElapsed = System.nanoTime() - pStartTime;
+		Log.i(TAG, String.format("%s: %d ops in %d us, %d ns/op",
+				pName, pOperations, lElapsed / 1000, lElapsed / pOperations));
+		String lResult = String.format("%s,%d,%d,%d", pName.replace(',', ';'), pOperations, lElapsed, lElapsed / pOperations);
+		mResults.add(lResult);
+		Log.i(RESULTS_TAG, lResult);
+		return lElapsed;
+	}
+
+	public void clearResults() {
+		mResults.clear();
+	}
+
+	/*
+	 * Writes the results recorded so far as CSV, header included.
+	 */
+	public void saveResults(String pPath) throws IOException {
+		FileWriter lWriter = new FileWriter(pPath);
+		try {
+			lWriter.write(RESULTS_HEADER + "\n");
+			for (String lResult : mResults) {
+				lWriter.write(lResult + "\n");
+			}
+		} finally {
+			lWriter.close();
+		}
+	}
+
+	/*
+	 * Runs every benchmark with default sizes and saves the results at pResultPath. pImagePath is
+	 * used by the image benchmark. The store is finalized and reinitialized several times, so this
+	 * must not run while other code uses it.
+	 */
+	public void runSuite(String pImagePath, String pResultPath) throws IOException {
+		clearResults();
+		runAccessorBenchmark(1000, 100);
+		runKeyScalingBenchmark(new int[] { 100, 1000, 10000, 100000 }, 200000);
+		runArraySizeBenchmark(new int[] { 1, 10, 100, 1000, 10000, 100000, 1000000 }, 4000000);
+		runExceptionBenchmark(10000);
+		runBatchBenchmark(1000, 100);
+		runThreadScalingBenchmark(1000, 200000, 4);
+		runAggregateBenchmark(100000, 100);
+		runReadCacheBenchmark(1000, 100);
+		runSnapshotBenchmark(100000, 200000, 2, 50);
+		runImageBenchmark(pImagePath, 20000);
+		runStoreFullBenchmark(4096);
+		saveResults(pResultPath);
+	}
+
+	/*
+	 * Get and set of each value type, by key and by handle, on pKeyCount keys repeated pIterations
+	 * times. Arrays hold 16 elements.
+	 */
+	public void runAccessorBenchmark(int pKeyCount, int pIterations) {
+		String[] lKeys = makeKeys("bench.accessor.", pKeyCount);
+		long[] lHandles = new long[pKeyCount];
+		for (int i = 0; i < pKeyCount; ++i) {
+			lHandles[i] = mStore.resolveKey(lKeys[i]);
+		}
+		int lOperations = pKeyCount * pIterations;
+		Color lColor = new Color(0xFF336699);
+		int[] lIntegerArray = new int[16];
+		Color[] lColorArray = new Color[16];
+		for (int i = 0; i < lColorArray.length; ++i) {
+			lColorArray[i] = lColor;
+		}
+
+		try {
+			long lStart = System.nanoTime();
+			for (int i = 0; i < pIterations; ++i) {
+				for (int j = 0; j < pKeyCount; ++j) {
+					mStore.setInteger(lKeys[j], i);
+				}
+			}
+			report("setInteger(key)", lStart, lOperations);
+			lStart = System.nanoTime();
+			for (int i = 0; i < pIterations; ++i) {
+				for (int j = 0; j < pKeyCount; ++j) {
+					mStore.setInteger(lHandles[j], i);
+				}
+			}
+			report("setInteger(handle)", lStart, lOperations);
+			lStart = System.nanoTime();
+			for (int i = 0; i < pIterations; ++i) {
+				for (int j = 0; j < pKeyCount; ++j) {
+					mStore.getInteger(lKeys[j]);
+				}
+			}
+			report("getInteger(key)", lStart, lOperations);
+			lStart = System.nanoTime();
+			for (int i = 0; i < pIterations; ++i) {
+				for (int j = 0; j < pKeyCount; ++j) {
+					mStore.getInteger(lHandles[j]);
+				}
+			}
+			report("getInteger(handle)", lStart, lOperations);
+
+			lStart = System.nanoTime();
+			for (int i = 0; i < pIterations; ++i) {
+				for (int j = 0; j < pKeyCount; ++j) {
+					mStore.setString(lKeys[j], lKeys[j]);
+				}
+			}
+			report("setString(key)", lStart, lOperations);
+			lStart = System.nanoTime();
+			for (int i = 0; i < pIterations; ++i) {
+				for (int j = 0; j < pKeyCount; ++j) {
+					mStore.setString(lHandles[j], lKeys[j]);
+				}
+			}
+			report("setString(handle)", lStart, lOperations);
+			lStart = System.nanoTime();
+			for (int i = 0; i < pIterations; ++i) {
+				for (int j = 0; j < pKeyCount; ++j) {
+					mStore.getString(lKeys[j]);
+				}
+			}
+			report("getString(key)", lStart, lOperations);
+			lStart = System.nanoTime();
+			for (int i = 0; i < pIterations; ++i) {
+				for (int j = 0; j < pKeyCount; ++j) {
+					mStore.getString(lHandles[j]);
+				}
+			}
+			report("getString(handle)", lStart, lOperations);
+
+			lStart = System.nanoTime();
+			for (int i = 0; i < pIterations; ++i) {
+				for (int j = 0; j < pKeyCount; ++j) {
+					mStore.setColor(lKeys[j], lColor);
+				}
+			}
+			report("setColor(key)", lStart, lOperations);
+			lStart = System.nanoTime();
+			for (int i = 0; i < pIterations; ++i) {
+				for (int j = 0; j < pKeyCount; ++j) {
+					mStore.setColor(lHandles[j], lColor);
+				}
+			}
+			report("setColor(handle)", lStart, lOperations);
+			lStart = System.nanoTime();
+			for (int i = 0; i < pIterations; ++i) {
+				for (int j = 0; j < pKeyCount; ++j) {
+					mStore.getColor(lKeys[j]);
+				}
+			}
+			report("getColor(key)", lStart, lOperations);
+			lStart = System.nanoTime();
+			for (int i = 0; i < pIterations; ++i) {
+				for (int j = 0; j < pKeyCount; ++j) {
+					mStore.getColor(lHandles[j]);
+				}
+			}
+			report("getColor(handle)", lStart, lOperations);
+
+			lStart = System.nanoTime();
+			for (int i = 0; i < pIterations; ++i) {
+				for (int j = 0; j < pKeyCount; ++j) {
+					mStore.setIntegerArray(lKeys[j], lIntegerArray);
+				}
+			}
+			report("setIntegerArray(key)[16]", lStart, lOperations);
+			lStart = System.nanoTime();
+			for (int i = 0; i < pIterations; ++i) {
+				for (int j = 0; j < pKeyCount; ++j) {
+					mStore.setIntegerArray(lHandles[j], lIntegerArray);
+				}
+			}
+			report("setIntegerArray(handle)[16]", lStart, lOperations);
+			lStart = System.nanoTime();
+			for (int i = 0; i < pIterations; ++i) {
+				for (int j = 0; j < pKeyCount; ++j) {
+					mStore.getIntegerArray(lKeys[j]);
+				}
+			}
+			report("getIntegerArray(key)[16]", lStart, lOperations);
+			lStart = System.nanoTime();
+			for (int i = 0; i < pIterations; ++i) {
+				for (int j = 0; j < pKeyCount; ++j) {
+					mStore.getIntegerArray(lHandles[j]);
+				}
+			}
+			report("getIntegerArray(handle)[16]", lStart, lOperations);
+
+			lStart = System.nanoTime();
+			for (int i = 0; i < pIterations; ++i) {
+				for (int j = 0; j < pKeyCount; ++j) {
+					mStore.setColorArray(lKeys[j], lColorArray);
+				}
+			}
+			report("setColorArray(key)[16]", lStart, lOperations);
+			lStart = System.nanoTime();
+			for (int i = 0; i < pIterations; ++i) {
+				for (int j = 0; j < pKeyCount; ++j) {
+					mStore.setColorArray(lHandles[j], lColorArray);
+				}
+			}
+			report("setColorArray(handle)[16]", lStart, lOperations);
+			lStart = System.nanoTime();
+			for (int i = 0; i < pIterations; ++i) {
+				for (int j = 0; j < pKeyCount; ++j) {
+					mStore.getColorArray(lKeys[j]);
+				}
+			}
+			report("getColorArray(key)[16]", lStart, lOperations);
+			lStart = System.nanoTime();
+			for (int i = 0; i < pIterations; ++i) {
+				for (int j = 0; j < pKeyCount; ++j) {
+					mStore.getColorArray(lHandles[j]);
+				}
+			}
+			report("getColorArray(handle)[16]", lStart, lOperations);
+		} catch (NotExistingKeyException eNotExistingKeyException) {
+			Log.e(TAG, "Benchmark key missing", eNotExistingKeyException);
+		} catch (InvalidTypeException eInvalidTypeException) {
+			Log.e(TAG, "Benchmark key has wrong type", eInvalidTypeException);
+		}
+	}
+
+	/*
+	 * pOperations getInteger calls spread over a growing number of keys, to expose the cost of
+	 * larger tables (cache misses, longer probes).
+	 */
+	public void runKeyScalingBenchmark(int[] pKeyCounts, int pOperations) {
+		try {
+			for (int lKeyCount : pKeyCounts) {
+				String[] lKeys = makeKeys("bench.scaling." + lKeyCount + ".", lKeyCount);
+				mStore.setIntegers(lKeys, new int[lKeyCount], null);
+
+				long lStart = System.nanoTime();
+				for (int i = 0; i < pOperations; ++i) {
+					//Stride through the keys so that consecutive lookups hit unrelated slots
+					mStore.getInteger(lKeys[(int) ((i * 7919L) % lKeyCount)]);
+				}
+				report("getInteger with " + lKeyCount + " keys", lStart, pOperations);
+			}
+		} catch (NotExistingKeyException eNotExistingKeyException) {
+			Log.e(TAG, "Benchmark key missing", eNotExistingKeyException);
+		} catch (InvalidTypeException eInvalidTypeException) {
+			Log.e(TAG, "Benchmark key has wrong type", eInvalidTypeException);
+		}
+	}
+
+	/*
+	 * Set, get, view and sum of IntegerArray entries of each size in pSizes. Each size is repeated so
+	 * that about pElements elements are transferred, at least once.
+	 */
+	public void runArraySizeBenchmark(int[] pSizes, int pElements) {
+		String lKey = "bench.arraysize";
+		try {
+			for (int lSize : pSizes) {
+				int[] lArray = new int[lSize];
+				int lIterations = Math.max(1, pElements / lSize);
+				mStore.setIntegerArray(lKey, new int[0]);
+
+				long lStart = System.nanoTime();
+				for (int i = 0; i < lIterations; ++i) {
+					//Alternates lengths so that the buffer is reallocated as by a first write
+					mStore.setIntegerArray(lKey, (i % 2 == 0) ? lArray : new int[0]);
+				}
+				report("setIntegerArray[" + lSize + "] new buffer", lStart, lIterations);
+
+				mStore.setIntegerArray(lKey, lArray);
+				lStart = System.nanoTime();
+				for (int i = 0; i < lIterations; ++i) {
+					mStore.setIntegerArray(lKey, lArray);
+				}
+				report("setIntegerArray[" + lSize + "] in place", lStart, lIterations);
+
+				lStart = System.nanoTime();
+				for (int i = 0; i < lIterations; ++i) {
+					mStore.getIntegerArray(lKey);
+				}
+				report("getIntegerArray[" + lSize + "]", lStart, lIterations);
+
+				lStart = System.nanoTime();
+				for (int i = 0; i < lIterations; ++i) {
+					mStore.getIntegerArrayView(lKey);
+				}
+				report("getIntegerArrayView[" + lSize + "]", lStart, lIterations);
+
+				lStart = System.nanoTime();
+				for (int i = 0; i < lIterations; ++i) {
+					mStore.sumIntegerArray(lKey);
+				}
+				report("sumIntegerArray[" + lSize + "]", lStart, lIterations);
+			}
+		} catch (NotExistingKeyException eNotExistingKeyException) {
+			Log.e(TAG, "Benchmark key missing", eNotExistingKeyException);
+		} catch (InvalidTypeException eInvalidTypeException) {
+			Log.e(TAG, "Benchmark key has wrong type", eInvalidTypeException);
+		}
+	}
+
+	/*
+	 * Cost of failed reads, which throw from native code, compared with the batched status path.
+	 */
+	public void runExceptionBenchmark(int pOperations) {
+		String lMissingKey = "bench.exception.missing";
+		String lStringKey = "bench.exception.string";
+		mStore.setString(lStringKey, lStringKey);
+		int lFailures = 0;
+
+		long lStart = System.nanoTime();
+		for (int i = 0; i < pOperations; ++i) {
+			try {
+				mStore.getInteger(lMissingKey);
+			} catch (NotExistingKeyException eNotExistingKeyException) {
+				++lFailures;
+			} catch (InvalidTypeException eInvalidTypeException) {
+				Log.e(TAG, "Unexpected exception", eInvalidTypeException);
+			}
+		}
+		report("getInteger missing key", lStart, pOperations);
+
+		lStart = System.nanoTime();
+		for (int i = 0; i < pOperations; ++i) {
+			try {
+				mStore.getInteger(lStringKey);
+			} catch (NotExistingKeyException eNotExistingKeyException) {
+				Log.e(TAG, "Unexpected exception", eNotExistingKeyException);
+			} catch (InvalidTypeException eInvalidTypeException) {
+				++lFailures;
+			}
+		}
+		report("getInteger wrong type", lStart, pOperations);
+
+		String[] lKeys = new String[] { lMissingKey };
+		int[] lValues = new int[1];
+		int[] lStatus = new int[1];
+		lStart = System.nanoTime();
+		for (int i = 0; i < pOperations; ++i) {
+			mStore.getIntegers(lKeys, lValues, lStatus);
+		}
+		report("getIntegers[1] missing key status", lStart, pOperations);
+		Log.d(TAG, "exception failures " + lFailures);
+	}
+
+	/*
+	 * Fills a single-shard store up to its capacity with batches of pBatchSize keys, then measures
+	 * writes of new keys rejected with StoreFullException or STATUS_STORE_FULL. The store is
+	 * finalized and reinitialized empty around the benchmark, so this must not run while other code
+	 * uses it.
+	 */
+	public void runStoreFullBenchmark(int pBatchSize) {
+		mStore.finalizeStore();
+		mStore.initializeStore();
+
+		int lStored = 0;
+		int[] lValues = new int[pBatchSize];
+		int[] lStatus = new int[pBatchSize];
+		long lStart = System.nanoTime();
+		boolean lFull = false;
+		while (!lFull) {
+			String[] lKeys = makeKeys("bench.full." + lStored + ".", pBatchSize);
+			mStore.setIntegers(lKeys, lValues, lStatus);
+			for (int i = 0; i < pBatchSize; ++i) {
+				if (lStatus[i] == Store.STATUS_OK) {
+					++lStored;
+				} else {
+					lFull = true;
+				}
+			}
+		}
+		report("setIntegers until full (" + lStored + " keys)", lStart, lStored);
+
+		int lOperations = 1000;
+		lStart = System.nanoTime();
+		for (int i = 0; i < lOperations; ++i) {
+			try {
+				mStore.setInteger("bench.full.rejected", i);
+			} catch (StoreFullException eStoreFullException) {
+				//Expected
+			}
+		}
+		report("setInteger on full store", lStart, lOperations);
+
+		String[] lKeys = makeKeys("bench.full.rejected.", pBatchSize);
+		lStart = System.nanoTime();
+		mStore.setIntegers(lKeys, lValues, lStatus);
+		report("setIntegers[" + pBatchSize + "] on full store", lStart, pBatchSize);
+
+		mStore.finalizeStore();
+		mStore.initializeStore();
+	}
+
+	/*
+	 * Compares pKeyCount single get/set calls against one batched call, repeated pIterations times.
+	 */
+	public void runBatchBenchmark(int pKeyCount, int pIterations) {
+		String[] lKeys = makeKeys("bench.batch.", pKeyCount);
+		int[] lValues = new int[pKeyCount];
+		int[] lStatus = new int[pKeyCount];
+		int lOperations = pKeyCount * pIterations;
+		mStore.setIntegers(lKeys, lValues, lStatus);
+
+		try {
+			long lStart = System.nanoTime();
+			for (int i = 0; i < pIterations; ++i) {
+				for (int j = 0; j < pKeyCount; ++j) {
+					mStore.setInteger(lKeys[j], i);
+				}
+			}
+			long lSingle = report("setInteger x" + pKeyCount, lStart, lOperations);
+
+			lStart = System.nanoTime();
+			for (int i = 0; i < pIterations; ++i) {
+				mStore.setIntegers(lKeys, lValues, lStatus);
+			}
+			long lBatched = report("setIntegers[" + pKeyCount + "]", lStart, lOperations);
+			Log.i(TAG, String.format("set speedup: %.1fx", (double) lSingle / lBatched));
+
+			lStart = System.nanoTime();
+			for (int i = 0; i < pIterations; ++i) {
+				for (int j = 0; j < pKeyCount; ++j) {
+					lValues[j] = mStore.getInteger(lKeys[j]);
+				}
+			}
+			lSingle = report("getInteger x" + pKeyCount, lStart, lOperations);
+
+			lStart = System.nanoTime();
+			for (int i = 0; i < pIterations; ++i) {
+				mStore.getIntegers(lKeys, lValues, lStatus);
+			}
+			lBatched = report("getIntegers[" + pKeyCount + "]", lStart, lOperations);
+			Log.i(TAG, String.format("get speedup: %.1fx", (double) lSingle / lBatched));
+		} catch (NotExistingKeyException eNotExistingKeyException) {
+			Log.e(TAG, "Benchmark key missing", eNotExistingKeyException);
+		} catch (InvalidTypeException eInvalidTypeException) {
+			Log.e(TAG, "Benchmark key has wrong type", eInvalidTypeException);
+		}
+	}
+
+	/*
+	 * Measures read throughput with 1 to pMaxThreads threads reading the same pKeyCount keys
+	 * concurrently, each thread performing pOperations gets.
+	 */
+	public void runThreadScalingBenchmark(int pKeyCount, final int pOperations, int pMaxThreads) {
+		final String[] lKeys = makeKeys("bench.threads.", pKeyCount);
+		mStore.setIntegers(lKeys, new int[pKeyCount], null);
+
+		for (int lThreadCount = 1; lThreadCount <= pMaxThreads; ++lThreadCount) {
+			final CountDownLatch lStartLatch = new CountDownLatch(1);
+			final CountDownLatch lEndLatch = new CountDownLatch(lThreadCount);
+			for (int i = 0; i < lThreadCount; ++i) {
+				new Thread(new Runnable() {
+					public void run() {
+						try {
+							lStartLatch.await();
+							for (int j = 0; j < pOperations; ++j) {
+								mStore.getInteger(lKeys[j % lKeys.length]);
+							}
+						} catch (InterruptedException eInterruptedException) {
+							Thread.currentThread().interrupt();
+						} catch (NotExistingKeyException eNotExistingKeyException) {
+							Log.e(TAG, "Benchmark key missing", eNotExistingKeyException);
+						} catch (InvalidTypeException eInvalidTypeException) {
+							Log.e(TAG, "Benchmark key has wrong type", eInvalidTypeException);
+						} finally {
+							lEndLatch.countDown();
+						}
+					}
+				}).start();
+			}
+
+			long lStart = System.nanoTime();
+			lStartLatch.countDown();
+			try {
+				lEndLatch.await();
+			} catch (InterruptedException eInterruptedException) {
+				Thread.currentThread().interrupt();
+				return;
+			}
+			long lElapsed = System.nanoTime() - lStart;
+			Log.i(TAG, String.format("getInteger with %d threads: %d ops/s", lThreadCount,
+					(long) lThreadCount * pOperations * 1000000000L / lElapsed));
+		}
+	}
+
+	/*
+	 * Compares populating pKeyCount keys one set at a time, as done on a cold start, against loading
+	 * the same keys from a store image at pPath. The store is finalized and reinitialized from the
+	 * image, so this must not run while other code uses it.
+	 */
+	public void runImageBenchmark(String pPath, int pKeyCount) {
+		String[] lKeys = makeKeys("bench.image.", pKeyCount);
+		new File(pPath).delete();
+		mStore.finalizeStore();
+		mStore.initializeStore(pPath);
+
+		long lStart = System.nanoTime();
+		for (int i = 0; i < pKeyCount; ++i) {
+			mStore.setString(lKeys[i], lKeys[i]);
+		}
+		long lRebuild = report("cold rebuild", lStart, pKeyCount);
+
+		try {
+			lStart = System.nanoTime();
+			mStore.flush();
+			report("flush", lStart, pKeyCount);
+
+			mStore.finalizeStore();
+			lStart = System.nanoTime();
+			mStore.initializeStore(pPath);
+			long lLoad = report("image load", lStart, pKeyCount);
+			Log.i(TAG, String.format("load speedup: %.1fx", (double) lRebuild / lLoad));
+
+			lStart = System.nanoTime();
+			for (int i = 0; i < pKeyCount; ++i) {
+				mStore.getString(lKeys[i]);
+			}
+			report("first reads after load", lStart, pKeyCount);
+		} catch (IOException eIOException) {
+			Log.e(TAG, "Cannot save store image", eIOException);
+		} catch (NotExistingKeyException eNotExistingKeyException) {
+			Log.e(TAG, "Benchmark key missing", eNotExistingKeyException);
+		} catch (InvalidTypeException eInvalidTypeException) {
+			Log.e(TAG, "Benchmark key has wrong type", eInvalidTypeException);
+		}
+	}
+
+	/*
+	 * Compares native aggregates over an IntegerArray of pLength random values against copying the
+	 * array with getIntegerArray() and looping in Java, repeated pIterations times.
+	 */
+	public void runAggregateBenchmark(int pLength, int pIterations) {
+		String lKey = "bench.aggregate";
+		int[] lArray = new int[pLength];
+		Random lRandom = new Random(pLength);
+		for (int i = 0; i < pLength; ++i) {
+			lArray[i] = lRandom.nextInt(1000);
+		}
+		mStore.setIntegerArray(lKey, lArray);
+		long lHandle = mStore.resolveKey(lKey);
+		//Keeps results alive so that loops are not optimized away
+		long lSink = 0;
+
+		try {
+			long lStart = System.nanoTime();
+			for (int i = 0; i < pIterations; ++i) {
+				int[] lCopy = mStore.getIntegerArray(lHandle);
+				long lSum = 0;
+				for (int j = 0; j < lCopy.length; ++j) {
+					lSum += lCopy[j];
+				}
+				lSink += lSum;
+			}
+			long lCopied = report("copy and sum[" + pLength + "]", lStart, pIterations);
+
+			lStart = System.nanoTime();
+			for (int i = 0; i < pIterations; ++i) {
+				lSink += mStore.sumIntegerArray(lHandle);
+			}
+			long lNative = report("sumIntegerArray[" + pLength + "]", lStart, pIterations);
+			Log.i(TAG, String.format("sum speedup: %.1fx", (double) lCopied / lNative));
+
+			lStart = System.nanoTime();
+			for (int i = 0; i < pIterations; ++i) {
+				int[] lCopy = mStore.getIntegerArray(lHandle);
+				int lCount = 0;
+				for (int j = 0; j < lCopy.length; ++j) {
+					if ((lCopy[j] >= 250) && (lCopy[j] <= 750)) {
+						++lCount;
+					}
+				}
+				lSink += lCount;
+			}
+			lCopied = report("copy and count[" + pLength + "]", lStart, pIterations);
+
+			lStart = System.nanoTime();
+			for (int i = 0; i < pIterations; ++i) {
+				lSink += mStore.countIntegerArray(lHandle, 250, 750);
+			}
+			lNative = report("countIntegerArray[" + pLength + "]", lStart, pIterations);
+			Log.i(TAG, String.format("count speedup: %.1fx", (double) lCopied / lNative));
+
+			lStart = System.nanoTime();
+			for (int i = 0; i < pIterations; ++i) {
+				lSink += mStore.minIntegerArray(lHandle) + mStore.maxIntegerArray(lHandle)
+						+ mStore.indexOfIntegerArray(lHandle, -1);
+			}
+			report("min, max and indexOf[" + pLength + "]", lStart, pIterations);
+		} catch (NotExistingKeyException eNotExistingKeyException) {
+			Log.e(TAG, "Benchmark key missing", eNotExistingKeyException);
+		} catch (InvalidTypeException eInvalidTypeException) {
+			Log.e(TAG, "Benchmark key has wrong type", eInvalidTypeException);
+		}
+		Log.d(TAG, "aggregate checksum " + lSink);
+	}
+
+	/*
+	 * Compares repeated getString() calls on pKeyCount unchanged keys with getCachedString(), as a UI
+	 * refreshing the same data would do, then the cached path right after each write.
+	 */
+	public void runReadCacheBenchmark(int pKeyCount, int pIterations) {
+		String[] lKeys = makeKeys("bench.cache.", pKeyCount);
+		mStore.setStrings(lKeys, lKeys, null);
+		int lOperations = pKeyCount * pIterations;
+
+		try {
+			long lStart = System.nanoTime();
+			for (int i = 0; i < pIterations; ++i) {
+				for (int j = 0; j < pKeyCount; ++j) {
+					mStore.getString(lKeys[j]);
+				}
+			}
+			long lUncached = report("getString x" + pKeyCount, lStart, lOperations);
+
+			lStart = System.nanoTime();
+			for (int i = 0; i < pIterations; ++i) {
+				for (int j = 0; j < pKeyCount; ++j) {
+					mStore.getCachedString(lKeys[j]);
+				}
+			}
+			long lCached = report("getCachedString x" + pKeyCount, lStart, lOperations);
+			Log.i(TAG, String.format("cache speedup: %.1fx", (double) lUncached / lCached));
+
+			lStart = System.nanoTime();
+			for (int i = 0; i < pIterations; ++i) {
+				mStore.setString(lKeys[0], lKeys[i % pKeyCount]);
+				for (int j = 0; j < pKeyCount; ++j) {
+					mStore.getCachedString(lKeys[j]);
+				}
+			}
+			report("getCachedString x" + pKeyCount + " after a write", lStart, lOperations);
+		} catch (NotExistingKeyException eNotExistingKeyException) {
+			Log.e(TAG, "Benchmark key missing", eNotExistingKeyException);
+		} catch (InvalidTypeException eInvalidTypeException) {
+			Log.e(TAG, "Benchmark key has wrong type", eInvalidTypeException);
+		}
+	}
+
+	/*
+	 * Write throughput of pWriterCount threads, each performing pOperations pairs of setInteger(),
+	 * alone then while another thread keeps taking a snapshot of pKeyCount keys along with the pairs,
+	 * reading it whole and waiting pHoldTime milliseconds, then again while one more snapshot stays
+	 * held through the whole run. Each writer sets the first key of its pair then the second one, so
+	 * that no snapshot may see the second ahead of the first. The longest pair write of each run is
+	 * reported, along with the pairs written while a snapshot was being taken or read and the longest
+	 * of them: writers never wait for snapshots, so they keep writing meanwhile and their longest pair
+	 * stays in line with the run without snapshots, whatever pKeyCount.
+	 */
+	public void runSnapshotBenchmark(int pKeyCount, int pOperations, int pWriterCount, int pHoldTime) {
+		final String lPrefix = "bench.snapshot.";
+		mStore.setIntegers(makeKeys(lPrefix + "key.", pKeyCount), new int[pKeyCount], null);
+		for (int i = 0; i < pWriterCount; ++i) {
+			mStore.setIntegers(new String[] { lPrefix + "pair." + i + ".first", lPrefix + "pair." + i + ".second" },
+					new int[2], null);
+		}
+		runSnapshotWriters(lPrefix, 0, pOperations, pWriterCount, null, "setInteger x" + pWriterCount + " threads");
+		runSnapshotReader(lPrefix, pKeyCount, pOperations, pOperations, pWriterCount, pHoldTime,
+				"setInteger x" + pWriterCount + " threads with snapshots");
+
+		StoreSnapshot lHeld = mStore.snapshot(lPrefix);
+		try {
+			runSnapshotReader(lPrefix, pKeyCount, 2 * pOperations, pOperations, pWriterCount, pHoldTime,
+					"setInteger x" + pWriterCount + " threads with snapshots and one held");
+			for (int i = 0; i < pWriterCount; ++i) {
+				if (lHeld.getInteger(lPrefix + "pair." + i + ".second") != 2 * pOperations) {
+					Log.e(TAG, "Held snapshot sees later writes");
+				}
+			}
+		} catch (NotExistingKeyException eNotExistingKeyException) {
+			Log.e(TAG, "Benchmark key missing", eNotExistingKeyException);
+		} catch (InvalidTypeException eInvalidTypeException) {
+			Log.e(TAG, "Benchmark key has wrong type", eInvalidTypeException);
+		} finally {
+			lHeld.release();
+		}
+	}
+
+	/*
+	 * Takes snapshots in a loop while writers run. mReading is set while a snapshot is being taken or
+	 * read, for writers to tell which of their pairs overlapped one.
+	 */
+	private class SnapshotReader implements Runnable {
+		private final String mPrefix;
+		private final int mWriterCount;
+		private final int mHoldTime;
+		final CountDownLatch mStopLatch = new CountDownLatch(1);
+		volatile boolean mReading;
+		//Read once the thread is joined
+		long mSnapshotTime;
+		int mSnapshotCount;
+		int mInconsistentCount;
+
+		SnapshotReader(String pPrefix, int pWriterCount, int pHoldTime) {
+			mPrefix = pPrefix;
+			mWriterCount = pWriterCount;
+			mHoldTime = pHoldTime;
+		}
+
+		public void run() {
+			try {
+				do {
+					mReading = true;
+					long lStart = System.nanoTime();
+					StoreSnapshot lSnapshot = mStore.snapshot(mPrefix);
+					mSnapshotTime += System.nanoTime() - lStart;
+					++mSnapshotCount;
+					try {
+						for (String lKey : lSnapshot.getKeys()) {
+							lSnapshot.getInteger(lKey);
+						}
+						for (int i = 0; i < mWriterCount; ++i) {
+							int lFirst = lSnapshot.getInteger(mPrefix + "pair." + i + ".first");
+							int lSecond = lSnapshot.getInteger(mPrefix + "pair." + i + ".second");
+							if ((lFirst != lSecond) && (lFirst != lSecond + 1)) {
+								++mInconsistentCount;
+							}
+						}
+					} finally {
+						lSnapshot.release();
+						mReading = false;
+					}
+				} while (!mStopLatch.await(mHoldTime, TimeUnit.MILLISECONDS));
+			} catch (InterruptedException eInterruptedException) {
+				Thread.currentThread().interrupt();
+			} catch (NotExistingKeyException eNotExistingKeyException) {
+				Log.e(TAG, "Benchmark key missing", eNotExistingKeyException);
+			} catch (InvalidTypeException eInvalidTypeException) {
+				Log.e(TAG, "Benchmark key has wrong type", eInvalidTypeException);
+			}
+		}
+	}
+
+	private void runSnapshotReader(String pPrefix, int pKeyCount, int pFrom, int pOperations, int pWriterCount,
+			int pHoldTime, String pName) {
+		SnapshotReader lReader = new SnapshotReader(pPrefix, pWriterCount, pHoldTime);
+		Thread lThread = new Thread(lReader);
+		lThread.start();
+		runSnapshotWriters(pPrefix, pFrom, pOperations, pWriterCount, lReader, pName);
+		lReader.mStopLatch.countDown();
+		try {
+			lThread.join();
+		} catch (InterruptedException eInterruptedException) {
+			Thread.currentThread().interrupt();
+			return;
+		}
+		if (lReader.mSnapshotCount > 0) {
+			report("snapshot(" + (pKeyCount + 2 * pWriterCount) + " keys)", System.nanoTime() - lReader.mSnapshotTime,
+					lReader.mSnapshotCount);
+		}
+		if (lReader.mInconsistentCount > 0) {
+			Log.e(TAG, lReader.mInconsistentCount + " inconsistent snapshot pairs");
+		}
+	}
+
+	/*
+	 * Values go on from pFrom, so that the pairs stay ordered from one run to the next. Pairs written
+	 * while pReader was taking or reading a snapshot are reported apart.
+	 */
+	private void runSnapshotWriters(final String pPrefix, final int pFrom, final int pOperations, int pWriterCount,
+			final SnapshotReader pReader, String pName) {
+		final CountDownLatch lStartLatch = new CountDownLatch(1);
+		final CountDownLatch lEndLatch = new CountDownLatch(pWriterCount);
+		final long[] lStalls = new long[pWriterCount];
+		final long[] lOverlapStalls = new long[pWriterCount];
+		final int[] lOverlapCounts = new int[pWriterCount];
+		for (int i = 0; i < pWriterCount; ++i) {
+			final int lWriter = i;
+			final String lFirst = pPrefix + "pair." + i + ".first";
+			final String lSecond = pPrefix + "pair." + i + ".second";
+			new Thread(new Runnable() {
+				public void run() {
+					try {
+						lStartLatch.await();
+						for (int j = pFrom + 1; j <= pFrom + pOperations; ++j) {
+							boolean lReading = (pReader != null) && pReader.mReading;
+							long lStart = System.nanoTime();
+							mStore.setInteger(lFirst, j);
+							mStore.setInteger(lSecond, j);
+							long lElapsed = System.nanoTime() - lStart;
+							lStalls[lWriter] = Math.max(lStalls[lWriter], lElapsed);
+							if (lReading || ((pReader != null) && pReader.mReading)) {
+								lOverlapStalls[lWriter] = Math.max(lOverlapStalls[lWriter], lElapsed);
+								++lOverlapCounts[lWriter];
+							}
+						}
+					} catch (InterruptedException eInterruptedException) {
+						Thread.currentThread().interrupt();
+					} finally {
+						lEndLatch.countDown();
+					}
+				}
+			}).start();
+		}
+
+		long lStart = System.nanoTime();
+		lStartLatch.countDown();
+		try {
+			lEndLatch.await();
+		} catch (InterruptedException eInterruptedException) {
+			Thread.currentThread().interrupt();
+			return;
+		}
+		report(pName, lStart, 2 * pOperations * pWriterCount);
+		long lStall = 0;
+		long lOverlapStall = 0;
+		int lOverlapCount = 0;
+		for (int i = 0; i < pWriterCount; ++i) {
+			lStall = Math.max(lStall, lStalls[i]);
+			lOverlapStall = Math.max(lOverlapStall, lOverlapStalls[i]);
+			lOverlapCount += lOverlapCounts[i];
+		}
+		report(pName + " longest pair", System.nanoTime() - lStall, 1);
+		if (lOverlapCount > 0) {
+			Log.i(TAG, String.format("%s: %d pairs written while a snapshot was taken or read", pName, lOverlapCount));
+			report(pName + " longest pair during a snapshot", System.nanoTime() - lOverlapStall, 1);
+		} else if (pReader != null) {
+			Log.e(TAG, pName + ": no pair written while a snapshot was taken or read");
+		}
+	}
+}
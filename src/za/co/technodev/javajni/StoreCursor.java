@@ -0,0 +1,98 @@
+package za.co.technodev.javajni;
+
+import za.co.technodev.exception.InvalidTypeException;
+
+/*
+ * Reads keys in order with their values, a page per native call, from Store.openCursor() or
+ * Store.openPrefixCursor(). next() replaces the current page with the following keys. Each page is
+ * read at once and stays as it was read, whatever is written to the store afterwards. A cursor is
+ * not thread safe, and array values are copies that the caller may keep.
+ */
+
+public class StoreCursor {
+	private Store mStore;
+	private String mFrom;
+	private boolean mInclusive;
+	private String mTo;
+	private String mPrefix;
+	private String[] mKeys;
+	private int[] mTypes;
+	private int[] mIntegers;
+	private Object[] mObjects;
+	private int mLength;
+	private boolean mEnd;
+
+	StoreCursor(Store pStore, String pFrom, String pTo, String pPrefix, int pPageSize, boolean pValues) {
+		if (pPageSize <= 0) {
+			throw new IllegalArgumentException("Invalid page size");
+		}
+		mStore = pStore;
+		mFrom = pFrom;
+		mInclusive = true;
+		mTo = pTo;
+		mPrefix = pPrefix;
+		mKeys = new String[pPageSize];
+		if (pValues) {
+			mTypes = new int[pPageSize];
+			mIntegers = new int[pPageSize];
+			mObjects = new Object[pPageSize];
+		}
+	}
+
+	/*
+	 * Reads the next page. Returns false, with an empty page, once every key was read. A short page
+	 * is the last one.
+	 */
+	public boolean next() {
+		if (mEnd) {
+			mLength = 0;
+			return false;
+		}
+		mLength = mStore.readKeyPage(mFrom, mInclusive, mTo, mPrefix, mKeys, mTypes, mIntegers, mObjects);
+		if (mLength < mKeys.length) {
+			mEnd = true;
+		}
+		if (mLength > 0) {
+			mFrom = mKeys[mLength - 1];
+			mInclusive = false;
+		}
+		return mLength > 0;
+	}
+
+	public int getLength() {
+		return mLength;
+	}
+
+	public String getKey(int pIndex) {
+		checkIndex(pIndex);
+		return mKeys[pIndex];
+	}
+
+	public StoreType getType(int pIndex) {
+		checkIndex(pIndex);
+		return StoreType.values()[mTypes[pIndex]];
+	}
+
+	public int getInteger(int pIndex) throws InvalidTypeException {
+		if (getType(pIndex) != StoreType.Integer) {
+			throw new InvalidTypeException("Not an integer");
+		}
+		return mIntegers[pIndex];
+	}
+
+	/*
+	 * Value of any type: an Integer, a String, a Color, an int[] or a Color[].
+	 */
+	public Object getValue(int pIndex) {
+		if (getType(pIndex) == StoreType.Integer) {
+			return Integer.valueOf(mIntegers[pIndex]);
+		}
+		return mObjects[pIndex];
+	}
+
+	private void checkIndex(int pIndex) {
+		if ((pIndex < 0) || (pIndex >= mLength)) {
+			throw new IndexOutOfBoundsException();
+		}
+	}
+}
@@ -0,0 +1,63 @@
+package za.co.technodev.javajni;
+
+import za.co.technodev.exception.InvalidTypeException;
+import za.co.technodev.exception.NotExistingKeyException;
+
+/*
+ * Read-only view of a Store at the time Store.snapshot() was called, see StoreSnapshot.h. Getters
+ * behave as those of the store at that time: a key that was not there throws
+ * NotExistingKeyException. They throw IllegalStateException if the store ran out of memory to keep
+ * a value the snapshot should see. A snapshot may be read from several threads, but must be released
+ * once, when no thread reads it anymore. The values it keeps are not reclaimed otherwise.
+ */
+
+public class StoreSnapshot {
+	private final Store mStore;
+	private long mNativeSnapshot;
+
+	StoreSnapshot(Store pStore, long pNativeSnapshot) {
+		mStore = pStore;
+		mNativeSnapshot = pNativeSnapshot;
+	}
+
+	public int getInteger(String pKey) throws NotExistingKeyException, InvalidTypeException {
+		return mStore.getSnapshotInteger(getNativeSnapshot(), pKey);
+	}
+
+	public String getString(String pKey) throws NotExistingKeyException, InvalidTypeException {
+		return mStore.getSnapshotString(getNativeSnapshot(), pKey);
+	}
+
+	public Color getColor(String pKey) throws NotExistingKeyException, InvalidTypeException {
+		return mStore.getSnapshotColor(getNativeSnapshot(), pKey);
+	}
+
+	public int[] getIntegerArray(String pKey) throws NotExistingKeyException, InvalidTypeException {
+		return mStore.getSnapshotIntegerArray(getNativeSnapshot(), pKey);
+	}
+
+	public Color[] getColorArray(String pKey) throws NotExistingKeyException, InvalidTypeException {
+		return mStore.getSnapshotColorArray(getNativeSnapshot(), pKey);
+	}
+
+	/*
+	 * Keys with a value in the snapshot, in the order of Store.keysInRange().
+	 */
+	public String[] getKeys() {
+		return mStore.getSnapshotKeys(getNativeSnapshot());
+	}
+
+	public synchronized void release() {
+		if (mNativeSnapshot != 0) {
+			mStore.releaseSnapshot(mNativeSnapshot);
+			mNativeSnapshot = 0;
+		}
+	}
+
+	private synchronized long getNativeSnapshot() {
+		if (mNativeSnapshot == 0) {
+			throw new IllegalStateException("Snapshot is released");
+		}
+		return mNativeSnapshot;
+	}
+}
@@ -0,0 +1,63 @@
+package za.co.technodev.javajni;
+
+/*
+ * Read-only view on a snapshot returned by Store.getStats(). Each statistic is a histogram whose
+ * bucket 0 counts zero values and bucket i values in [2^(i-1), 2^i[. Percentiles are therefore
+ * upper bounds, accurate within a factor of two.
+ */
+
+public class StoreStats {
+	private long[] mSnapshot;
+
+	public StoreStats(long[] pSnapshot) {
+		mSnapshot = pSnapshot;
+	}
+
+	public long getCount(int pStat) {
+		return mSnapshot[pStat * Store.STATS_STRIDE];
+	}
+
+	public long getSum(int pStat) {
+		return mSnapshot[pStat * Store.STATS_STRIDE + 1];
+	}
+
+	public long getBucket(int pStat, int pBucket) {
+		return mSnapshot[pStat * Store.STATS_STRIDE + 2 + pBucket];
+	}
+
+	public double getMean(int pStat) {
+		long lCount = getCount(pStat);
+		return (lCount > 0) ? (double) getSum(pStat) / lCount : 0.0;
+	}
+
+	/*
+	 * Upper bound of the bucket holding the pPercentile (0 to 100) value, 0 if nothing was recorded.
+	 */
+	public long getPercentile(int pStat, double pPercentile) {
+		long lCount = getCount(pStat);
+		long lRank = (long) Math.ceil(lCount * pPercentile / 100.0);
+		long lSeen = 0;
+		for (int i = 0; i < Store.STATS_BUCKETS; ++i) {
+			lSeen += getBucket(pStat, i);
+			if ((lSeen >= lRank) && (lSeen > 0)) {
+				return (i == 0) ? 0 : (1L << i) - 1;
+			}
+		}
+		return 0;
+	}
+
+	/*
+	 * One line per statistic which recorded anything: count, mean, median and 99th percentile.
+	 */
+	@Override
+	public String toString() {
+		StringBuilder lBuilder = new StringBuilder();
+		for (int i = 0; i < Store.STAT_COUNT; ++i) {
+			if (getCount(i) > 0) {
+				lBuilder.append(String.format("stat %d: count=%d mean=%.0f p50<=%d p99<=%d\n",
+						i, getCount(i), getMean(i), getPercentile(i, 50), getPercentile(i, 99)));
+			}
+		}
+		return lBuilder.toString();
+	}
+}